@@ -0,0 +1,33 @@
+// fillRect, drawLine and clear throughput on ArrayBuffer Graphics for each bpp
+// ./bin/espruino benchmark/graphics_arraybuffer.js
+var W = 120, H = 64, N = 200;
+
+function time(fn) {
+  var t = getTime();
+  fn();
+  return Math.round((getTime()-t)*1000);
+}
+
+[1,2,4,8,16].forEach(function(bpp) {
+  [{},{msb:true},{interleavex:true}].forEach(function(opts) {
+    if (opts.interleavex && bpp>4) return;
+    var g = Graphics.createArrayBuffer(W,H,bpp,opts);
+    var flat = E.getAddressOf(g.buffer,true)!=0;
+    var tFill = time(function() {
+      for (var i=0;i<N;i++)
+        g.setColor(i).fillRect(i%17,i%13,W-1-(i%11),H-1-(i%7));
+    });
+    var tLine = time(function() {
+      for (var i=0;i<N;i++)
+        g.setColor(i).drawLine(0,i%H,W-1,(i*7)%H).drawLine(i%W,0,(i*5)%W,H-1);
+    });
+    var tClear = time(function() {
+      for (var i=0;i<N;i++)
+        g.setBgColor(i).clear();
+    });
+    print(bpp+"bpp "+JSON.stringify(opts)+(flat?"":" (not flat)")+
+          " fillRect "+tFill+"ms, drawLine "+tLine+"ms, clear "+tClear+"ms");
+    g = undefined;
+  });
+});
+quit();
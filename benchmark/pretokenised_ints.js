@@ -0,0 +1,24 @@
+// Loops full of small integer literals, as source code and pretokenised
+// ./bin/espruino benchmark/pretokenised_ints.js
+function source() {
+  var s = 0;
+  for (var i=0;i<50000;i++) s = (s + i*3 + 100 - 2 + 1000) & 65535;
+  return s;
+}
+function pretokenised() {
+  "ram";
+  var s = 0;
+  for (var i=0;i<50000;i++) s = (s + i*3 + 100 - 2 + 1000) & 65535;
+  return s;
+}
+[["source",source], ["pretokenised",pretokenised]].forEach(function(test) {
+  var f = test[1];
+  var best = 1e9;
+  for (var r=0;r<5;r++) {
+    var t = getTime();
+    f();
+    best = Math.min(best, getTime()-t);
+  }
+  print(test[0]+" "+Math.round(best*1000)+"ms");
+});
+quit();
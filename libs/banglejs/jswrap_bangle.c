@@ -1090,12 +1090,8 @@ void graphicsInternalFlip() {
 /// Flip buffer contents with the screen.
 void lcd_flip(JsVar *parent, bool all) {
 #ifdef LCD_WIDTH
-  if (all) {
-    graphicsInternal.data.modMinX = 0;
-    graphicsInternal.data.modMinY = 0;
-    graphicsInternal.data.modMaxX = LCD_WIDTH-1;
-    graphicsInternal.data.modMaxY = LCD_HEIGHT-1;
-  }
+  if (all)
+    graphicsSetModified(&graphicsInternal, 0, 0, LCD_WIDTH-1, LCD_HEIGHT-1);
   graphicsInternalFlip();
 #endif
 }
@@ -2499,10 +2495,7 @@ void jswrap_banglejs_setLCDOverlay(JsVar *imgVar, JsVar *xv, int y, JsVar *optio
 #endif
   // set all as modified
   // TODO: Could look at old vs new overlay state and update only lines that had changed?
-  graphicsInternal.data.modMinX = 0;
-  graphicsInternal.data.modMinY = 0;
-  graphicsInternal.data.modMaxX = LCD_WIDTH-1;
-  graphicsInternal.data.modMaxY = LCD_HEIGHT-1;
+  graphicsSetModified(&graphicsInternal, 0, 0, LCD_WIDTH-1, LCD_HEIGHT-1);
 }
 
 /*JSON{
@@ -0,0 +1,341 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2024 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Cache of rasterised font glyphs
+ *
+ * Glyphs are stored as bitmaps in one fixed block of memory. When it's full
+ * the least recently used glyphs are removed and the remaining bitmaps are
+ * moved down to fill the gap.
+ *
+ * Vector font glyphs are stored as 1bpp masks in *device* coordinates (so
+ * there's a separate entry for each rotation) and drawn as runs of pixels
+ * with graphicsFillRectDevice, so we end up with exactly the same pixels as
+ * if graphicsFillPoly had been called. PBF glyphs are stored unscaled, as
+ * they are in the font file. Once a font is freed or moved, a different font
+ * can end up at the same address, so PBF glyphs also store a checksum of the
+ * glyph's bytes in the font, which is checked each time they are used.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "glyph_cache.h"
+#ifndef ESPR_NO_GLYPH_CACHE
+#include "jsparse.h"
+#ifndef NO_VECTOR_FONT
+#include "vector_font.h"
+#endif
+
+// The bigger cache is ~5kb of RAM, so only use it on watches with RAM to spare (not 64kb ones like DTNO1_F5)
+#if defined(LINUX) || (defined(BANGLEJS) && RAM_TOTAL>=128*1024)
+#define GLYPH_CACHE_LARGE
+#endif
+#ifndef GLYPH_CACHE_SIZE
+#ifdef GLYPH_CACHE_LARGE
+#define GLYPH_CACHE_SIZE 4096 ///< Bytes of glyph bitmaps we can store
+#else
+#define GLYPH_CACHE_SIZE 1024 ///< Bytes of glyph bitmaps we can store
+#endif
+#endif
+#ifndef GLYPH_CACHE_ENTRIES
+#ifdef GLYPH_CACHE_LARGE
+#define GLYPH_CACHE_ENTRIES 48 ///< Maximum number of glyphs we can store
+#else
+#define GLYPH_CACHE_ENTRIES 16 ///< Maximum number of glyphs we can store
+#endif
+#endif
+
+typedef enum {
+  GCF_VECTOR = 0,
+  GCF_PBF = 1,
+  GCF_ORIENTATION_SHIFT = 1, ///< For Vector fonts, JSGRAPHICSFLAGS_MAPPEDXY from the Graphics' flags is stored above this
+} GlyphCacheFlags;
+
+typedef struct {
+  size_t font; ///< Vector: sizex<<16 | sizey, PBF: font's address in memory
+  uint32_t fontLen; ///< Vector: 0, PBF: font's length in bytes
+  uint32_t ch; ///< Character code
+  uint32_t lastUsed; ///< glyphCacheTime when this was last drawn
+  uint16_t offset; ///< Where the bitmap is in glyphCacheData
+  uint8_t flags; ///< GlyphCacheFlags
+  uint8_t width, height, bpp; ///< Bitmap size. Each row starts on a byte boundary, leftmost pixel in the MSB
+  int16_t x, y; ///< Vector: offset of the bitmap from where we draw in user coordinates, PBF: offset in glyph pixels
+  int8_t advance; ///< PBF: how far to move right after drawing (unscaled)
+  uint32_t pbfOffset; ///< PBF: where the glyph (starting with its header) is in the font
+  uint32_t pbfCheck; ///< PBF: checksum of the glyph's bytes in the font (see glyphCachePbfCheck)
+} GlyphCacheEntry;
+
+static unsigned char glyphCacheData[GLYPH_CACHE_SIZE];
+static GlyphCacheEntry glyphCacheEntries[GLYPH_CACHE_ENTRIES];
+static unsigned int glyphCacheEntryCount = 0;
+static unsigned int glyphCacheUsed = 0; ///< Bytes of glyphCacheData in use
+static uint32_t glyphCacheTime = 0; ///< Incremented every time a glyph is used
+static unsigned int glyphCacheHits = 0, glyphCacheMisses = 0;
+
+void glyphCacheGetInfo(GlyphCacheInfo *info) {
+  info->hits = glyphCacheHits;
+  info->misses = glyphCacheMisses;
+  info->entries = glyphCacheEntryCount;
+  info->used = glyphCacheUsed;
+  info->size = GLYPH_CACHE_SIZE;
+}
+
+void glyphCacheClear() {
+  glyphCacheEntryCount = 0;
+  glyphCacheUsed = 0;
+  glyphCacheTime = 0;
+  glyphCacheHits = 0;
+  glyphCacheMisses = 0;
+}
+
+static unsigned int glyphCacheStride(const GlyphCacheEntry *e) {
+  return ((unsigned int)e->width*e->bpp + 7) >> 3;
+}
+
+static GlyphCacheEntry *glyphCacheFind(uint8_t flags, size_t font, uint32_t fontLen, uint32_t ch) {
+  for (unsigned int i=0;i<glyphCacheEntryCount;i++) {
+    GlyphCacheEntry *e = &glyphCacheEntries[i];
+    if (e->ch==ch && e->font==font && e->fontLen==fontLen && e->flags==flags) {
+      e->lastUsed = ++glyphCacheTime;
+      glyphCacheHits++;
+      return e;
+    }
+  }
+  glyphCacheMisses++;
+  return 0;
+}
+
+/// Remove an entry and move the bitmaps after it down to fill the gap
+static void glyphCacheRemove(GlyphCacheEntry *e) {
+  unsigned int offset = e->offset;
+  unsigned int size = glyphCacheStride(e) * e->height;
+  memmove(&glyphCacheData[offset], &glyphCacheData[offset+size], glyphCacheUsed - (offset+size));
+  glyphCacheUsed -= size;
+  *e = glyphCacheEntries[--glyphCacheEntryCount];
+  for (unsigned int i=0;i<glyphCacheEntryCount;i++)
+    if (glyphCacheEntries[i].offset > offset)
+      glyphCacheEntries[i].offset = (uint16_t)(glyphCacheEntries[i].offset - size);
+}
+
+/** Add an entry with a cleared bitmap, removing the least recently used glyphs to make space.
+ * Returns 0 if the glyph is too big to cache */
+static GlyphCacheEntry *glyphCacheAdd(uint8_t flags, size_t font, uint32_t fontLen, uint32_t ch, int width, int height, int bpp) {
+  if (width<0 || width>255 || height<0 || height>255) return 0;
+  unsigned int size = (((unsigned int)(width*bpp) + 7) >> 3) * (unsigned int)height;
+  if (size > GLYPH_CACHE_SIZE/4) return 0; // would push too many other glyphs out
+  while (glyphCacheEntryCount>=GLYPH_CACHE_ENTRIES || glyphCacheUsed+size>GLYPH_CACHE_SIZE) {
+    GlyphCacheEntry *oldest = &glyphCacheEntries[0];
+    for (unsigned int i=1;i<glyphCacheEntryCount;i++)
+      if (glyphCacheEntries[i].lastUsed < oldest->lastUsed)
+        oldest = &glyphCacheEntries[i];
+    glyphCacheRemove(oldest);
+  }
+  GlyphCacheEntry *e = &glyphCacheEntries[glyphCacheEntryCount++];
+  memset(e, 0, sizeof(GlyphCacheEntry));
+  e->font = font;
+  e->fontLen = fontLen;
+  e->ch = ch;
+  e->flags = flags;
+  e->lastUsed = ++glyphCacheTime;
+  e->offset = (uint16_t)glyphCacheUsed;
+  e->width = (uint8_t)width;
+  e->height = (uint8_t)height;
+  e->bpp = (uint8_t)bpp;
+  memset(&glyphCacheData[glyphCacheUsed], 0, size);
+  glyphCacheUsed += size;
+  return e;
+}
+
+#ifndef NO_VECTOR_FONT
+typedef struct {
+  int x1,y1,x2,y2;
+} GlyphCacheBounds;
+
+/// graphicsPolyCallback that just works out the area covered by a glyph's polygons
+static void glyphCacheVectorBounds(void *data, int points, short *vertices) {
+  GlyphCacheBounds *b = (GlyphCacheBounds*)data;
+  for (int i=0;i<points;i++) {
+    int x = vertices[i*2], y = vertices[i*2+1];
+    if (x<b->x1) b->x1=x;
+    if (y<b->y1) b->y1=y;
+    if (x>b->x2) b->x2=x;
+    if (y>b->y2) b->y2=y;
+  }
+}
+
+/// fillRect for the Graphics we rasterise glyphs with - sets bits in the entry's 1bpp bitmap
+static void glyphCacheFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
+  NOT_USED(col);
+  unsigned char *bitmap = (unsigned char*)gfx->backendData;
+  unsigned int stride = ((unsigned int)gfx->data.width + 7) >> 3;
+  for (int y=y1;y<=y2;y++)
+    for (int x=x1;x<=x2;x++)
+      bitmap[(unsigned int)y*stride + (unsigned int)(x>>3)] |= (unsigned char)(0x80>>(x&7));
+}
+
+static void glyphCacheSetPixel(JsGraphics *gfx, int x, int y, unsigned int col) {
+  glyphCacheFillRect(gfx, x, y, x, y, col);
+}
+
+/// Do graphicsToDeviceCoordinates swap X and Y?
+static bool glyphCacheSwapXY(JsGraphics *gfx) {
+#ifdef DICKENS // graphicsToDeviceCoordinates doesn't rotate
+  NOT_USED(gfx);
+  return false;
+#else
+  return (gfx->data.flags & JSGRAPHICSFLAGS_SWAP_XY) != 0;
+#endif
+}
+
+bool glyphCacheDrawVectorChar(JsGraphics *gfx, int x, int y, int sizex, int sizey, char ch) {
+  bool swap = glyphCacheSwapXY(gfx);
+  uint8_t flags = (uint8_t)(GCF_VECTOR | (((gfx->data.flags & JSGRAPHICSFLAGS_MAPPEDXY) / JSGRAPHICSFLAGS_SWAP_XY) << GCF_ORIENTATION_SHIFT));
+  size_t font = ((size_t)(sizex&0xFFFF)<<16) | (size_t)(sizey&0xFFFF);
+  GlyphCacheEntry *e = glyphCacheFind(flags, font, 0, (unsigned char)ch);
+  if (!e) {
+    // Work out which pixels the glyph covers (with a pixel spare each side)
+    GlyphCacheBounds b = { 0x7FFF, 0x7FFF, -0x8000, -0x8000 };
+    graphicsGetVectorChar(glyphCacheVectorBounds, &b, 0, 0, sizex, sizey, ch);
+    if (b.x1 > b.x2) return true; // no polygons (eg. space)
+    int ux1 = (b.x1>>4)-1, uy1 = (b.y1>>4)-1;
+    int uw = (b.x2>>4)+2-ux1, uh = (b.y2>>4)+2-uy1;
+    e = glyphCacheAdd(flags, font, 0, (unsigned char)ch, swap?uh:uw, swap?uw:uh, 1);
+    if (!e) return false;
+    e->x = (int16_t)ux1;
+    e->y = (int16_t)uy1;
+    // Rasterise with a Graphics the size of the bitmap and the same rotation
+    JsGraphics raster;
+    memset(&raster, 0, sizeof(raster));
+    raster.data.type = JSGRAPHICSTYPE_ARRAYBUFFER;
+    graphicsStructInit(&raster, e->width, e->height, 1);
+    raster.data.flags = gfx->data.flags & JSGRAPHICSFLAGS_MAPPEDXY;
+    raster.backendData = &glyphCacheData[e->offset];
+    raster.setPixel = glyphCacheSetPixel;
+    raster.fillRect = glyphCacheFillRect;
+    graphicsGetVectorChar((graphicsPolyCallback)graphicsFillPoly, &raster, -ux1, -uy1, sizex, sizey, ch);
+    if (jspIsInterrupted()) { // the bitmap may not be complete
+      glyphCacheRemove(e);
+      return true;
+    }
+  }
+  // Work out where the bitmap goes on the device
+  int uw = swap ? e->height : e->width;
+  int uh = swap ? e->width : e->height;
+  int x1 = x+e->x, y1 = y+e->y;
+  int x2 = x1+uw-1, y2 = y1+uh-1;
+  graphicsToDeviceCoordinates(gfx, &x1, &y1);
+  graphicsToDeviceCoordinates(gfx, &x2, &y2);
+  if (x2<x1) x1 = x2;
+  if (y2<y1) y1 = y2;
+  // Draw each run of set pixels
+  const unsigned char *row = &glyphCacheData[e->offset];
+  unsigned int stride = glyphCacheStride(e);
+  for (int cy=0;cy<e->height;cy++,row+=stride) {
+    int cx = 0;
+    while (cx<e->width) {
+      if (!(cx&7) && !row[cx>>3]) { // skip empty bytes
+        cx += 8;
+        continue;
+      }
+      if (!(row[cx>>3] & (0x80>>(cx&7)))) {
+        cx++;
+        continue;
+      }
+      int start = cx;
+      while (cx<e->width && (row[cx>>3] & (0x80>>(cx&7)))) cx++;
+      graphicsFillRectDevice(gfx, x1+start, y1+cy, x1+cx-1, y1+cy, gfx->data.fgColor);
+    }
+  }
+  return true;
+}
+#endif // NO_VECTOR_FONT
+
+#ifdef ESPR_PBF_FONTS
+#define GLYPH_CACHE_PBF_HEADER 5 ///< Bytes before each glyph's pixels in a PBF font (w,h,x,y,advance)
+
+/** Checksum of the header and pixels of the glyph for this entry in a PBF
+ * font. Returns 0 if the glyph doesn't fit in the font */
+static uint32_t glyphCachePbfCheck(const GlyphCacheEntry *e, const char *ptr, size_t len) {
+  size_t size = GLYPH_CACHE_PBF_HEADER + (((size_t)e->width*e->height*e->bpp + 7) >> 3);
+  if (e->pbfOffset+size > len) return 0;
+  const unsigned char *p = (const unsigned char *)&ptr[e->pbfOffset];
+  uint32_t check = 1;
+  for (size_t i=0;i<size;i++)
+    check = check*31 + p[i];
+  return check ? check : 1;
+}
+
+bool glyphCacheDrawPbfChar(JsGraphics *gfx, PbfFontLoaderInfo *font, int codepoint, int x, int y, bool solidBackground, int scalex, int scaley, int *advance) {
+  size_t len;
+  char *ptr = jsvGetDataPointer(font->var, &len);
+  GlyphCacheEntry *e = ptr ? glyphCacheFind(GCF_PBF, (size_t)ptr, (uint32_t)len, (uint32_t)codepoint) : 0;
+  if (e && glyphCachePbfCheck(e, ptr, len)!=e->pbfCheck) {
+    // a different font is at the same address now
+    glyphCacheRemove(e);
+    glyphCacheHits--;
+    glyphCacheMisses++;
+    e = 0;
+  }
+  if (!e) {
+    PbfFontLoaderGlyph glyph;
+    if (!jspbfFontFindGlyph(font, codepoint, &glyph)) return false;
+    // We can only tell fonts apart if they're in one flat area of memory
+    if (ptr) e = glyphCacheAdd(GCF_PBF, (size_t)ptr, (uint32_t)len, (uint32_t)codepoint, glyph.w, glyph.h, glyph.bpp);
+    if (!e) {
+      jspbfFontRenderGlyph(font, &glyph, gfx, x+glyph.x*scalex, y+glyph.y*scaley, solidBackground, scalex, scaley);
+      *advance = glyph.advance;
+      return true;
+    }
+    e->x = glyph.x;
+    e->y = glyph.y;
+    e->advance = glyph.advance;
+    // jspbfFontFindGlyph leaves the iterator at the glyph's pixels
+    e->pbfOffset = (uint32_t)(jsvStringIteratorGetIndex(&font->it) - GLYPH_CACHE_PBF_HEADER);
+    e->pbfCheck = glyphCachePbfCheck(e, ptr, len);
+    // The font stores pixels one after the other, least significant bits first
+    unsigned char *row = &glyphCacheData[e->offset];
+    unsigned int stride = glyphCacheStride(e);
+    int bpp = glyph.bpp, bppRange = (1<<bpp)-1;
+    int bits = 0, data = 0;
+    for (int cy=0;cy<glyph.h;cy++,row+=stride) {
+      for (int cx=0;cx<glyph.w;cx++) {
+        if (!bits) {
+          data = (unsigned char)jsvStringIteratorGetCharAndNext(&font->it);
+          bits = 8;
+        }
+        int bit = cx*bpp;
+        row[bit>>3] |= (unsigned char)((data & bppRange) << (8-bpp-(bit&7)));
+        data >>= bpp;
+        bits -= bpp;
+      }
+    }
+  }
+  // Draw each run of identical pixels
+  x += e->x*scalex;
+  y += e->y*scaley;
+  const unsigned char *row = &glyphCacheData[e->offset];
+  unsigned int stride = glyphCacheStride(e);
+  int bpp = e->bpp, bppRange = (1<<bpp)-1;
+#define GLYPH_CACHE_PIXEL(CX) ((row[((CX)*bpp)>>3] >> (8-bpp-(((CX)*bpp)&7))) & bppRange)
+  for (int cy=0;cy<e->height;cy++,row+=stride) {
+    int cx = 0;
+    while (cx<e->width) {
+      int col = GLYPH_CACHE_PIXEL(cx);
+      int start = cx;
+      while (cx<e->width && GLYPH_CACHE_PIXEL(cx)==col) cx++;
+      if (solidBackground || col)
+        graphicsFillRect(gfx, x+start*scalex, y+cy*scaley, x+cx*scalex-1, y+cy*scaley+scaley-1, graphicsBlendGfxColor(gfx, 256*col/bppRange));
+    }
+  }
+#undef GLYPH_CACHE_PIXEL
+  *advance = e->advance;
+  return true;
+}
+#endif // ESPR_PBF_FONTS
+
+#endif // ESPR_NO_GLYPH_CACHE
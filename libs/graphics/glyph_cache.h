@@ -0,0 +1,49 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2024 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Cache of rasterised font glyphs
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef ESPR_NO_GLYPH_CACHE
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include "graphics.h"
+#ifdef ESPR_PBF_FONTS
+#include "pbf_font.h"
+#endif
+
+typedef struct {
+  unsigned int hits, misses; ///< How many glyphs were/weren't found in the cache
+  unsigned int entries; ///< How many glyphs are in the cache
+  unsigned int used, size; ///< Bytes of bitmap data used, and available
+} GlyphCacheInfo;
+
+/// Get information on how well the cache is working
+void glyphCacheGetInfo(GlyphCacheInfo *info);
+/// Remove everything from the cache and reset the hit/miss counters
+void glyphCacheClear();
+
+#ifndef NO_VECTOR_FONT
+/** Draw a Vector font character (as graphicsGetVectorChar would with graphicsFillPoly), rasterising
+ * it into the cache first if it isn't there already. Returns false if it is too big to cache,
+ * in which case it hasn't been drawn */
+bool glyphCacheDrawVectorChar(JsGraphics *gfx, int x, int y, int sizex, int sizey, char ch);
+#endif
+
+#ifdef ESPR_PBF_FONTS
+/** Draw a character from a PBF font (as jspbfFontFindGlyph+jspbfFontRenderGlyph would) using the cache.
+ * Returns false if the character isn't in the font, or sets advance to how far to move along (unscaled) */
+bool glyphCacheDrawPbfChar(JsGraphics *gfx, PbfFontLoaderInfo *font, int codepoint, int x, int y, bool solidBackground, int scalex, int scaley, int *advance);
+#endif
+
+#endif // GLYPH_CACHE_H
+#endif // ESPR_NO_GLYPH_CACHE
@@ -77,10 +77,21 @@ void graphicsFallbackFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, u
 }
 
 void graphicsFallbackBlit(JsGraphics *gfx, int x1, int y1, int w, int h, int x2, int y2) {
-  for (int y=0;y<h;y++)
-    for (int x=0;x<w;x++)
+  // copy in the direction that doesn't overwrite pixels we have yet to read
+  bool up = y2>y1 || (y2==y1 && x2>x1);
+  for (int j=0;j<h;j++) {
+    int y = up ? h-1-j : j;
+    for (int i=0;i<w;i++) {
+      int x = up ? w-1-i : i;
       gfx->setPixel(gfx, (int)(x+x2),(int)(y+y2),
         gfx->getPixel(gfx, (int)(x+x1),(int)(y+y1)));
+    }
+  }
+}
+
+void graphicsFallbackBlitRow(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+  for (int i=0;i<w;i++)
+    gfx->setPixel(gfx, x+i, y, cols[i]);
 }
 
 void graphicsFallbackScrollX(JsGraphics *gfx, int xdir, int yfrom, int yto, int x1, int x2) {
@@ -149,12 +160,7 @@ void graphicsStructInit(JsGraphics *gfx, int width, int height, int bpp) {
   gfx->data.height = (unsigned short)height;
   gfx->data.bpp = (unsigned char)bpp;
   graphicsStructResetState(gfx);
-#ifndef NO_MODIFIED_AREA
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
-#endif
+  graphicsClearModified(gfx);
 }
 
 /// Set up the callbacks for this graphics instance (usually done by graphicsGetFromVar)
@@ -163,6 +169,7 @@ bool graphicsSetCallbacks(JsGraphics *gfx) {
   gfx->getPixel = graphicsFallbackGetPixel;
   gfx->fillRect = graphicsFallbackFillRect;
   gfx->blit = graphicsFallbackBlit;
+  gfx->blitRow = graphicsFallbackBlitRow;
   gfx->scroll = graphicsFallbackScroll;
 #ifdef USE_LCD_SDL
   if (gfx->data.type == JSGRAPHICSTYPE_SDL) {
@@ -304,6 +311,19 @@ unsigned short graphicsGetHeight(const JsGraphics *gfx) {
   return (gfx->data.flags & JSGRAPHICSFLAGS_SWAP_XY) ? gfx->data.width : gfx->data.height;
 }
 
+#ifndef ESPR_NO_MODIFIED_BANDS
+/// Mark the bands containing rows y1..y2 as modified
+static ALWAYS_INLINE void graphicsSetModifiedBands(JsGraphics *gfx, int y1, int y2) {
+  if (y2<y1 || y2<0) return; // nothing on screen (eg. drawn entirely above it)
+  int b1 = y1>>GRAPHICS_MODIFIED_BAND_SHIFT, b2 = y2>>GRAPHICS_MODIFIED_BAND_SHIFT;
+  if (b1<0) b1 = 0;
+  if (b1>31) b1 = 31;
+  if (b2<0) b2 = 0;
+  if (b2>31) b2 = 31;
+  gfx->data.modBands |= (uint32_t)((2UL<<b2)-1) & ~(uint32_t)((1UL<<b1)-1);
+}
+#endif
+
 // Set the area modified by a draw command and also clip to the screen/clipping bounds. Returns true if clipped. If coordsRotatedAlready we assume the coordinates have gone through deviceToGraphicsCoordinates already
 bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int *y2, bool coordsRotatedAlready) {
   bool modified = false;
@@ -333,6 +353,9 @@ bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int
   if (*x2 > gfx->data.modMaxX) { gfx->data.modMaxX=(short)*x2; modified = true; }
   if (*y1 < gfx->data.modMinY) { gfx->data.modMinY=(short)*y1; modified = true; }
   if (*y2 > gfx->data.modMaxY) { gfx->data.modMaxY=(short)*y2; modified = true; }
+#ifndef ESPR_NO_MODIFIED_BANDS
+  graphicsSetModifiedBands(gfx, *y1, *y2);
+#endif
 #endif
   return modified;
 }
@@ -344,6 +367,59 @@ void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2) {
   if (x2 > gfx->data.modMaxX) { gfx->data.modMaxX=(short)x2; }
   if (y1 < gfx->data.modMinY) { gfx->data.modMinY=(short)y1; }
   if (y2 > gfx->data.modMaxY) { gfx->data.modMaxY=(short)y2; }
+#ifndef ESPR_NO_MODIFIED_BANDS
+  graphicsSetModifiedBands(gfx, y1, y2);
+#endif
+#endif
+}
+
+// Reset the modified area (eg. after the screen has been updated)
+void graphicsClearModified(JsGraphics *gfx) {
+#ifndef NO_MODIFIED_AREA
+  gfx->data.modMaxX = -32768;
+  gfx->data.modMaxY = -32768;
+  gfx->data.modMinX = 32767;
+  gfx->data.modMinY = 32767;
+#ifndef ESPR_NO_MODIFIED_BANDS
+  gfx->data.modBands = 0;
+#endif
+#endif
+}
+
+/* Find the next run of modified rows, starting at row *y1. Returns false if there are no more, or sets y1/y2 to
+the first and last row of the run (inclusive) */
+bool graphicsGetModifiedRows(JsGraphics *gfx, int *y1, int *y2) {
+#ifndef NO_MODIFIED_AREA
+  int y = *y1;
+  if (y < gfx->data.modMinY) y = gfx->data.modMinY;
+  if (y > gfx->data.modMaxY) return false;
+  int end = gfx->data.modMaxY;
+#ifndef ESPR_NO_MODIFIED_BANDS
+  int band = y>>GRAPHICS_MODIFIED_BAND_SHIFT;
+  if (band>31) band = 31;
+  uint32_t bands = gfx->data.modBands >> band;
+  if (!bands) return false;
+  while (!(bands&1)) { // skip unmodified bands
+    bands >>= 1;
+    band++;
+  }
+  if (y < (band<<GRAPHICS_MODIFIED_BAND_SHIFT)) y = band<<GRAPHICS_MODIFIED_BAND_SHIFT;
+  if (y > end) return false;
+  while (bands&1) { // find the end of this run of bands
+    bands >>= 1;
+    band++;
+  }
+  if (band<32 && end >= (band<<GRAPHICS_MODIFIED_BAND_SHIFT))
+    end = (band<<GRAPHICS_MODIFIED_BAND_SHIFT)-1;
+#endif
+  *y1 = y;
+  *y2 = end;
+  return true;
+#else
+  NOT_USED(gfx);
+  *y1 = 0;
+  *y2 = 0;
+  return false;
 #endif
 }
 
@@ -434,6 +510,9 @@ static void graphicsSetPixelDevice(JsGraphics *gfx, int x, int y, unsigned int c
   if (x > gfx->data.modMaxX) gfx->data.modMaxX=(short)x;
   if (y < gfx->data.modMinY) gfx->data.modMinY=(short)y;
   if (y > gfx->data.modMaxY) gfx->data.modMaxY=(short)y;
+#ifndef ESPR_NO_MODIFIED_BANDS
+  graphicsSetModifiedBands(gfx, y, y);
+#endif
 #else
   if (x<0 || y<0 || x>=gfx->data.width || y>=gfx->data.height) return;
 #endif
@@ -480,6 +559,9 @@ void graphicsFillRectDevice(JsGraphics *gfx, int x1, int y1, int x2, int y2, uns
   if (x2 > gfx->data.modMaxX) gfx->data.modMaxX=(short)x2;
   if (y1 < gfx->data.modMinY) gfx->data.modMinY=(short)y1;
   if (y2 > gfx->data.modMaxY) gfx->data.modMaxY=(short)y2;
+#ifndef ESPR_NO_MODIFIED_BANDS
+  graphicsSetModifiedBands(gfx, y1, y2);
+#endif
 #endif
   if (x1==x2 && y1==y2) {
     gfx->setPixel(gfx,(int)x1,(int)y1,col);
@@ -655,11 +737,18 @@ void graphicsDrawLine(JsGraphics *gfx, int x1, int y1, int x2, int y2) {
     }
     int pos = (y1<<8) + 128; // rounding!
     int step = ((y2-y1)<<8) / xl;
-    int x;
+    // draw each horizontal run as one fill so backends can write whole words at once
+    unsigned int col = gfx->data.fgColor & (unsigned int)((1L<<gfx->data.bpp)-1);
+    int x, runX = x1, runY = pos>>8;
     for (x=x1;x<=x2;x++) {
-      graphicsSetPixelDevice(gfx, x, pos>>8, gfx->data.fgColor);
+      if ((pos>>8) != runY) {
+        graphicsFillRectDevice(gfx, runX, runY, x-1, runY, col);
+        runX = x;
+        runY = pos>>8;
+      }
       pos += step;
     }
+    graphicsFillRectDevice(gfx, runX, runY, x2, runY, col);
   } else {
     if (y1>y2) {
       int t;
@@ -785,28 +874,119 @@ void graphicsDrawCircleAA(JsGraphics *gfx, int x0, int y0, int r){
 
 #endif
 
-// Fill poly - each member of vertices is 1/16th pixel
-void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices) {
-  typedef struct {
-    short x,y;
-  } VertXY;
-  VertXY *v = (VertXY*)vertices;
-
-  int i,j,y;
-  int miny = (int)(gfx->data.height-1);
-  int maxy = 0;
+/// An edge of a polygon being filled, in device coordinates (1/16th pixels)
+typedef struct {
+  short x, y; ///< The vertex we work out crossings from
+  short y1, y2; ///< This edge crosses scanlines from y1 up to but not including y2
+  int dx, dy; ///< Offset to the other vertex (dy is never 0)
+  short cross; ///< Where this edge crosses the current scanline
+  unsigned short idx; ///< Edge number, so crossings at the same X are always handled in the same order
+} GraphicsPolyEdge;
+
+/// Called for each span of a polygon that should be filled, with y and x1/x2 in 1/16th pixels
+typedef void (*GraphicsPolySpanCallback)(JsGraphics *gfx, int y, int x1, int x2, void *data);
+
+/** Scan convert a polygon that is already in device coordinates (1/16th pixels), from scanline y1 to y2 (inclusive)
+ * in steps of ystep. Rather than checking every edge on every scanline, edges are sorted by their top Y, and
+ * moved to an 'active' list (kept sorted by X) when we get to them. */
+static void graphicsScanPoly(JsGraphics *gfx, int points, const short *vertices, int y1, int y2, int ystep, GraphicsPolySpanCallback spanCallback, void *data) {
+  size_t edgesSize = (size_t)points*(sizeof(GraphicsPolyEdge) + sizeof(GraphicsPolyEdge*));
+  if (edgesSize+256 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "Not enough stack memory for polygon");
+    return;
+  }
+  GraphicsPolyEdge *edges = (GraphicsPolyEdge*)alloca((size_t)points*sizeof(GraphicsPolyEdge));
+  GraphicsPolyEdge **active = (GraphicsPolyEdge**)alloca((size_t)points*sizeof(GraphicsPolyEdge*));
+  // Make the edge table, sorted by the first scanline each edge crosses
+  int i, j, edgeCount = 0;
+  j = points-1;
   for (i=0;i<points;i++) {
-    // convert into device coordinates...
-    int vx = v[i].x;
-    int vy = v[i].y;
+    int l = vertices[j*2+1] - vertices[i*2+1];
+    if (l) { // don't do horiz lines - rely on the ends of the lines that join onto them
+      GraphicsPolyEdge e;
+      e.x = vertices[i*2];
+      e.y = vertices[i*2+1];
+      e.dx = vertices[j*2] - e.x;
+      e.dy = l;
+      e.y1 = (l>0) ? e.y : vertices[j*2+1];
+      e.y2 = (l>0) ? vertices[j*2+1] : e.y;
+      e.cross = 0;
+      e.idx = (unsigned short)i;
+      int k = edgeCount++;
+      while (k>0 && edges[k-1].y1 > e.y1) {
+        edges[k] = edges[k-1];
+        k--;
+      }
+      edges[k] = e;
+    }
+    j = i;
+  }
+
+  int activeCount = 0, nextEdge = 0;
+  for (int y=y1;y<=y2;y+=ystep) {
+    // remove edges we've gone past, and add the ones we've reached
+    int n = 0;
+    for (i=0;i<activeCount;i++)
+      if (active[i]->y2 > y) active[n++] = active[i];
+    activeCount = n;
+    while (nextEdge<edgeCount && edges[nextEdge].y1<=y) {
+      if (edges[nextEdge].y2 > y) active[activeCount++] = &edges[nextEdge];
+      nextEdge++;
+    }
+    // work out where edges cross the scanline and sort them (they'll usually be in order from the last scanline)
+    for (i=0;i<activeCount;i++) {
+      GraphicsPolyEdge *e = active[i];
+      e->cross = (short)(e->x + ((y - e->y) * e->dx) / e->dy);
+      for (j=i;j>0 && (active[j-1]->cross > e->cross ||
+                       (active[j-1]->cross == e->cross && active[j-1]->idx > e->idx));j--)
+        active[j] = active[j-1];
+      active[j] = e;
+    }
+    // Output the spans between crossings
+    int x = 0,s = 0;
+    for (i=0;i<activeCount;i++) {
+      GraphicsPolyEdge *e = active[i];
+      if (s==0) x=e->cross;
+      if (e->dy>1) s++; else s--;
+      if (!s || i==activeCount-1)
+        spanCallback(gfx, y, x, e->cross, data);
+    }
+    if (jspIsInterrupted()) break;
+  }
+}
+
+/// Convert a polygon's vertices to device coordinates, and return the area they cover
+static void graphicsPolyToDevice(JsGraphics *gfx, int points, short *vertices, int *minx, int *miny, int *maxx, int *maxy) {
+  *minx = *miny = 0x7FFF;
+  *maxx = *maxy = -0x8000;
+  for (int i=0;i<points;i++) {
+    int vx = vertices[i*2];
+    int vy = vertices[i*2+1];
     graphicsToDeviceCoordinates16x(gfx, &vx, &vy);
-    v[i].x = (short)vx;
-    v[i].y = (short)vy;
-    // work out min and max
-    short y = v[i].y>>4;
-    if (y<miny) miny=y;
-    if (y>maxy) maxy=y;
+    vertices[i*2] = (short)vx;
+    vertices[i*2+1] = (short)vy;
+    vx = vertices[i*2];
+    vy = vertices[i*2+1];
+    if (vx<*minx) *minx=vx;
+    if (vy<*miny) *miny=vy;
+    if (vx>*maxx) *maxx=vx;
+    if (vy>*maxy) *maxy=vy;
   }
+}
+
+static void graphicsFillPolySpan(JsGraphics *gfx, int y, int x1, int x2, void *data) {
+  NOT_USED(data);
+  x1 = (x1+15)>>4;
+  x2 = (x2+15)>>4;
+  if (x2>x1) graphicsFillRectDevice(gfx,x1,y>>4,x2-1,y>>4,gfx->data.fgColor);
+}
+
+// Fill poly - each member of vertices is 1/16th pixel
+void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices) {
+  int minx, miny, maxx, maxy;
+  graphicsPolyToDevice(gfx, points, vertices, &minx, &miny, &maxx, &maxy);
+  miny >>= 4;
+  maxy >>= 4;
 #ifndef SAVE_ON_FLASH
   if (miny < gfx->data.clipRect.y1) miny=gfx->data.clipRect.y1;
   if (maxy > gfx->data.clipRect.y2) maxy=gfx->data.clipRect.y2;
@@ -814,58 +994,85 @@ void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices) {
   if (miny<0) miny=0;
   if (maxy>=gfx->data.height) maxy=(int)(gfx->data.height-1);
 #endif
+  graphicsScanPoly(gfx, points, vertices, miny<<4, maxy<<4, 16, graphicsFillPolySpan, 0);
+}
 
-  const int MAX_CROSSES = 64;
-
-  // for each scanline
-  for (y=miny<<4;y<=maxy<<4;y+=16) {
-    int yl = y>>4;
-    short cross[MAX_CROSSES];
-    bool slopes[MAX_CROSSES];
-    int crosscnt = 0;
-    // work out all the times lines cross the scanline
-    j = points-1;
-    for (i=0;i<points;i++) {
-      if ((v[i].y<=y && v[j].y>y) || (v[j].y<=y && v[i].y>y)) {
-        if (crosscnt < MAX_CROSSES) {
-          int l = v[j].y - v[i].y;
-          if (l) { // don't do horiz lines - rely on the ends of the lines that join onto them
-            cross[crosscnt] = (short)(v[i].x + ((y - v[i].y) * (v[j].x-v[i].x)) / l);
-            slopes[crosscnt] = (l>1)?1:0;
-            crosscnt++;
-          }
-        }
-      }
-      j = i;
-    }
+#ifdef GRAPHICS_ANTIALIAS
+typedef struct {
+  int x1, x2; ///< The pixels we have coverage for
+  int y; ///< The row we're working out coverage for
+  unsigned char *coverage; ///< How much of each pixel is covered, 0..64 (16 steps across, 4 scanlines down)
+} GraphicsPolyCoverage;
+
+/// Draw the row of pixels we have coverage for, and clear it ready for the next row
+static void graphicsFillPolyAAFlush(JsGraphics *gfx, GraphicsPolyCoverage *cov) {
+  for (int x=cov->x1;x<=cov->x2;x++) {
+    int c = cov->coverage[x-cov->x1];
+    if (c>=64) { // fill runs of completely covered pixels in one go
+      int start = x;
+      while (x<cov->x2 && cov->coverage[x+1-cov->x1]>=64) x++;
+      graphicsFillRectDevice(gfx, start, cov->y, x, cov->y, gfx->data.fgColor);
+    } else if (c)
+      graphicsSetPixelDeviceBlended(gfx, x, cov->y, c*4);
+  }
+  memset(cov->coverage, 0, (size_t)(cov->x2+1-cov->x1));
+}
 
-    // bubble sort
-    for (i=0;i<crosscnt-1;) {
-      if (cross[i]>cross[i+1]) {
-        short t=cross[i];
-        cross[i]=cross[i+1];
-        cross[i+1]=t;
-        bool ts=slopes[i];
-        slopes[i]=slopes[i+1];
-        slopes[i+1]=ts;
-        if (i) i--;
-      } else i++;
-    }
+static void graphicsFillPolyAASpan(JsGraphics *gfx, int y, int x1, int x2, void *data) {
+  GraphicsPolyCoverage *cov = (GraphicsPolyCoverage*)data;
+  if ((y>>4) != cov->y) {
+    graphicsFillPolyAAFlush(gfx, cov);
+    cov->y = y>>4;
+  }
+  if (x1 < cov->x1*16) x1 = cov->x1*16;
+  if (x2 > cov->x2*16+16) x2 = cov->x2*16+16;
+  if (x2<=x1) return;
+  unsigned char *c = cov->coverage;
+  int p1 = (x1>>4)-cov->x1, p2 = ((x2-1)>>4)-cov->x1;
+  if (p1==p2) {
+    c[p1] = (unsigned char)(c[p1] + x2 - x1);
+  } else {
+    c[p1] = (unsigned char)(c[p1] + 16 - (x1&15));
+    for (int p=p1+1;p<p2;p++) c[p] = (unsigned char)(c[p] + 16);
+    c[p2] = (unsigned char)(c[p2] + ((x2-1)&15) + 1);
+  }
+}
 
-    //  Fill the pixels between node pairs.
-    int x = 0,s = 0;
-    for (i=0;i<crosscnt;i++) {
-      if (s==0) x=cross[i];
-      if (slopes[i]) s++; else s--;
-      if (!s || i==crosscnt-1) {
-        int x1 = (x+15)>>4;
-        int x2 = (cross[i]+15)>>4;
-        if (x2>x1) graphicsFillRectDevice(gfx,x1,yl,x2-1,yl,gfx->data.fgColor);
-      }
-      if (jspIsInterrupted()) break;
-    }
+// Antialiased fill poly - each member of vertices is 1/16th pixel
+void graphicsFillPolyAA(JsGraphics *gfx, int points, short *vertices) {
+  int minx, miny, maxx, maxy;
+  graphicsPolyToDevice(gfx, points, vertices, &minx, &miny, &maxx, &maxy);
+  // pixel x,y covers x*16..x*16+15, y*16..y*16+15 - the same as graphicsFillPoly when fully covered
+  GraphicsPolyCoverage cov;
+  cov.x1 = minx>>4;
+  cov.x2 = maxx>>4;
+  miny >>= 4;
+  maxy >>= 4;
+#ifndef SAVE_ON_FLASH
+  if (cov.x1 < gfx->data.clipRect.x1) cov.x1=gfx->data.clipRect.x1;
+  if (cov.x2 > gfx->data.clipRect.x2) cov.x2=gfx->data.clipRect.x2;
+  if (miny < gfx->data.clipRect.y1) miny=gfx->data.clipRect.y1;
+  if (maxy > gfx->data.clipRect.y2) maxy=gfx->data.clipRect.y2;
+#else
+  if (cov.x1<0) cov.x1=0;
+  if (cov.x2>=gfx->data.width) cov.x2=(int)(gfx->data.width-1);
+  if (miny<0) miny=0;
+  if (maxy>=gfx->data.height) maxy=(int)(gfx->data.height-1);
+#endif
+  if (cov.x1>cov.x2 || miny>maxy) return;
+  size_t coverageSize = (size_t)(cov.x2+1-cov.x1);
+  if (coverageSize+256 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "Not enough stack memory for polygon");
+    return;
   }
+  cov.coverage = (unsigned char*)alloca(coverageSize);
+  memset(cov.coverage, 0, coverageSize);
+  cov.y = miny;
+  // 4 scanlines per pixel
+  graphicsScanPoly(gfx, points, vertices, (miny<<4)+2, (maxy<<4)+14, 4, graphicsFillPolyAASpan, &cov);
+  graphicsFillPolyAAFlush(gfx, &cov);
 }
+#endif
 
 /// Draw a simple 1bpp image in foreground colour
 void graphicsDrawImage1bpp(JsGraphics *gfx, int x1, int y1, int width, int height, const unsigned char *pixelData) {
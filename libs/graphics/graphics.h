@@ -30,6 +30,13 @@
 #endif
 #endif
 
+#if defined(NO_MODIFIED_AREA) && !defined(ESPR_NO_MODIFIED_BANDS)
+  #define ESPR_NO_MODIFIED_BANDS 1
+#endif
+#ifndef ESPR_NO_MODIFIED_BANDS
+  #define GRAPHICS_MODIFIED_BAND_SHIFT 3 ///< Rows are tracked in bands of 1<<GRAPHICS_MODIFIED_BAND_SHIFT for modBands
+#endif
+
 #if defined(LINUX) || defined(BANGLEJS)
 #define GRAPHICS_FAST_PATHS // execute more optimised code when no rotation/etc
 #endif
@@ -122,6 +129,9 @@ typedef struct {
 #ifndef NO_MODIFIED_AREA
   JsGraphicsClipRect clipRect;
   short modMinX, modMinY, modMaxX, modMaxY; ///< area that has been modified
+#ifndef ESPR_NO_MODIFIED_BANDS
+  uint32_t modBands; ///< bit N set if rows in band N (see GRAPHICS_MODIFIED_BAND_SHIFT) were modified - the last band covers all rows after it
+#endif
 #endif
 } PACKED_FLAGS JsGraphicsData;
 
@@ -134,6 +144,7 @@ typedef struct JsGraphics {
   void (*fillRect)(struct JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col); ///< x/y guaranteed to be in range
   unsigned int (*getPixel)(struct JsGraphics *gfx, int x, int y); ///< x/y guaranteed to be in range
   void (*blit)(struct JsGraphics *gfx, int x1, int y1, int w, int h, int x2, int y2); ///< blit a WxH area of x1y1 to x2y2 - all guaranteed to be in range
+  void (*blitRow)(struct JsGraphics *gfx, int x, int y, int w, const unsigned int *cols); ///< set w pixels of a row starting at x,y to the colors in cols - all guaranteed to be in range
   void (*scroll)(struct JsGraphics *gfx, int xdir, int ydir,  int x1, int y1, int x2, int y2); ///< scroll - leave unscrolled area undefined (all values guaranteed to be in range)
 } PACKED_FLAGS JsGraphics;
 typedef void (*JsGraphicsSetPixelFn)(struct JsGraphics *gfx, int x, int y, unsigned int col);
@@ -197,6 +208,12 @@ unsigned short graphicsGetHeight(const JsGraphics *gfx);
 bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int *y2, bool coordsRotatedAlready);
 // Set the area modified by a draw command
 void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2);
+// Reset the modified area (eg. after the screen has been updated)
+void graphicsClearModified(JsGraphics *gfx);
+/* Find the next run of modified rows, starting at row *y1. Returns false if there are no more, or sets y1/y2 to
+the first and last row of the run (inclusive). This skips bands of rows that weren't modified so a flip can send
+just the rows that changed (with ESPR_NO_MODIFIED_BANDS there's only ever one run, modMinY..modMaxY) */
+bool graphicsGetModifiedRows(JsGraphics *gfx, int *y1, int *y2);
 /// Get a setPixel function (assuming coordinates already clipped with graphicsSetModifiedAndClip) - if all is ok it can choose a faster draw function
 JsGraphicsSetPixelFn graphicsGetSetPixelFn(JsGraphics *gfx);
 /// Get a setPixel function and set modified area (assuming no clipping) (inclusive of x2,y2) - if all is ok it can choose a faster draw function
@@ -214,6 +231,7 @@ void         graphicsFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, u
 void graphicsFallbackFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col); // Simple fillrect - doesn't call device-specific FR
 void graphicsFillRectDevice(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col); // fillrect using device coordinates
 void graphicsFallbackScroll(JsGraphics *gfx, int xdir, int ydir, int x1, int y1, int x2, int y2);
+void graphicsFallbackBlitRow(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols); // Simple blitRow - calls setPixel for each pixel
 void graphicsDrawRect(JsGraphics *gfx, int x1, int y1, int x2, int y2);
 void graphicsDrawEllipse(JsGraphics *gfx, int x, int y, int x2, int y2);
 void graphicsFillEllipse(JsGraphics *gfx, int x, int y, int x2, int y2);
@@ -222,6 +240,7 @@ void graphicsDrawLine(JsGraphics *gfx, int x1, int y1, int x2, int y2);
 void graphicsDrawLineAA(JsGraphics *gfx, int ix1, int iy1, int ix2, int iy2); ///< antialiased drawline. each pixel is 1/16th
 void graphicsDrawCircleAA(JsGraphics *gfx, int x, int y, int r);
 void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices); ///< each pixel is 1/16th a pixel may overwrite vertices...
+void graphicsFillPolyAA(JsGraphics *gfx, int points, short *vertices); ///< antialiased fillPoly. each pixel is 1/16th a pixel may overwrite vertices...
 /// Draw a simple 1bpp image in foreground colour
 void graphicsDrawImage1bpp(JsGraphics *gfx, int x1, int y1, int width, int height, const unsigned char *pixelData);
 /// Scroll the graphics device (in user coords). X>0 = to right, Y >0 = down
@@ -47,6 +47,9 @@
 #ifdef ESPR_LINE_FONTS
 #include "line_font.h"
 #endif
+#ifndef ESPR_NO_GLYPH_CACHE
+#include "glyph_cache.h"
+#endif
 
 
 #ifdef GRAPHICS_PALETTED_IMAGES
@@ -395,6 +398,18 @@ NO_INLINE void _jswrap_drawImageLayerNextY(GfxDrawImageLayer *l) {
   }
 }
 
+#ifndef SAVE_ON_FLASH
+/// Get the next byte of image data (images drawn inline in a String may be UTF8 encoded)
+static ALWAYS_INLINE unsigned char _jswrap_drawImageNextByte(JsvStringIterator *it) {
+#ifdef ESPR_UNICODE_SUPPORT
+  if (it->isUTF8) return (unsigned char)jsvStringIteratorGetUTF8CharAndNext(it);
+#endif
+  unsigned char c = (unsigned char)jsvStringIteratorGetChar(it);
+  jsvStringIteratorNextInline(it);
+  return c;
+}
+#endif
+
 /* Draw an image 1:1 at xPos,yPos. If parseFullImage=true we ensure
 we leave the StringIterator pointing right at the end of the image. If not
 we can optimise if the image is clipped/offscreen. */
@@ -420,21 +435,61 @@ NO_INLINE void _jswrap_drawImageSimple(JsGraphics *gfx, int xPos, int yPos, GfxD
   } else // onscreen. y1!=yPos if clipped - ensure we skip enough bytes
     bits = -(y1-yPos)*img->bpp*img->width;
 #endif
-  JsGraphicsSetPixelFn setPixel = graphicsGetSetPixelUnclippedFn(gfx, xPos, y1, xPos+img->width-1, y2, true);
-  for (int y=y1;y<=y2;y++) {
-    for (int x=xPos;x<xPos+img->width;x++) {
-      // Get the data we need...
-      while (bits < img->bpp) {
-        colData = (colData<<8) | ((unsigned char)jsvStringIteratorGetUTF8CharAndNext(it));
-        bits += 8;
+#ifndef SAVE_ON_FLASH
+  if (!(gfx->data.flags & JSGRAPHICSFLAGS_MAPPEDXY)) {
+    /* Decode each row into a buffer a span at a time, and then send runs
+    of non-transparent pixels that are onscreen to the backend in one go */
+    unsigned int cols[DRAWIMAGE_SPAN_SIZE];
+    int xEnd = xPos+img->width;
+    for (int y=y1;y<=y2;y++) {
+      for (int x=xPos;x<xEnd;x+=DRAWIMAGE_SPAN_SIZE) {
+        int n = xEnd-x;
+        if (n>DRAWIMAGE_SPAN_SIZE) n=DRAWIMAGE_SPAN_SIZE;
+        for (int i=0;i<n;i++) {
+          while (bits < img->bpp) {
+            colData = (colData<<8) | _jswrap_drawImageNextByte(it);
+            bits += 8;
+          }
+          cols[i] = (colData>>(bits-img->bpp))&img->bitMask;
+          bits -= img->bpp;
+        }
+        int i = (x<x1) ? x1-x : 0;
+        int end = (x+n>x2) ? x2+1-x : n;
+        while (i<end) {
+          if (cols[i]==img->transparentCol) {
+            i++;
+            continue;
+          }
+          int start = i;
+          if (img->palettePtr) {
+            for (;i<end && cols[i]!=img->transparentCol;i++)
+              cols[i] = img->palettePtr[cols[i]&img->paletteMask];
+          } else {
+            while (i<end && cols[i]!=img->transparentCol) i++;
+          }
+          gfx->blitRow(gfx, x+start, y, i-start, &cols[start]);
+        }
       }
-      // extract just the bits we want
-      unsigned int col = (colData>>(bits-img->bpp))&img->bitMask;
-      bits -= img->bpp;
-      // Try and write pixel!
-      if (img->transparentCol!=col) {
-        if (img->palettePtr) col = img->palettePtr[col&img->paletteMask];
-        setPixel(gfx, x, y, col);
+    }
+  } else
+#endif
+  {
+    JsGraphicsSetPixelFn setPixel = graphicsGetSetPixelUnclippedFn(gfx, xPos, y1, xPos+img->width-1, y2, true);
+    for (int y=y1;y<=y2;y++) {
+      for (int x=xPos;x<xPos+img->width;x++) {
+        // Get the data we need...
+        while (bits < img->bpp) {
+          colData = (colData<<8) | ((unsigned char)jsvStringIteratorGetUTF8CharAndNext(it));
+          bits += 8;
+        }
+        // extract just the bits we want
+        unsigned int col = (colData>>(bits-img->bpp))&img->bitMask;
+        bits -= img->bpp;
+        // Try and write pixel!
+        if (img->transparentCol!=col) {
+          if (img->palettePtr) col = img->palettePtr[col&img->paletteMask];
+          setPixel(gfx, x, y, col);
+        }
       }
     }
   }
@@ -564,6 +619,10 @@ void jswrap_graphics_init() {
   graphicsTheme.bgH = (JsGraphicsThemeColor)0;
   graphicsTheme.dark = true;
 #endif
+#ifndef ESPR_NO_GLYPH_CACHE
+  // PBF fonts are identified by address, and memory will now be reused
+  glyphCacheClear();
+#endif
 }
 
 /*JSON{
@@ -2100,6 +2159,43 @@ JsVar *jswrap_graphics_getFonts(JsVar *parent) {
 #endif
 }
 
+/*JSON{
+  "type" : "staticmethod",
+  "class" : "Graphics",
+  "name" : "getGlyphCacheInfo",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_GLYPH_CACHE)",
+  "generate" : "jswrap_graphics_getGlyphCacheInfo",
+  "params" : [
+    ["reset","bool","Whether to empty the cache and reset the counters"]
+  ],
+  "return" : ["JsVar","An object `{hits,misses,entries,used,size}`"],
+  "typescript" : "getGlyphCacheInfo(reset?: boolean): { hits: number, misses: number, entries: number, used: number, size: number };"
+}
+When characters from Vector and PBF fonts are drawn with `drawString` they are
+rasterised into a cache shared between all Graphics instances, so that drawing
+the same characters again (for instance the digits of a clock) is faster. The
+least recently used characters are removed when the cache fills up.
+
+This returns how many characters were (`hits`) and weren't (`misses`) found in
+the cache, how many characters it holds (`entries`), and how many bytes of
+bitmap data are `used` out of `size`.
+*/
+#ifndef ESPR_NO_GLYPH_CACHE
+JsVar *jswrap_graphics_getGlyphCacheInfo(bool reset) {
+  GlyphCacheInfo info;
+  glyphCacheGetInfo(&info);
+  if (reset) glyphCacheClear();
+  JsVar *obj = jsvNewObject();
+  if (!obj) return 0;
+  jsvObjectSetChildAndUnLock(obj, "hits", jsvNewFromInteger((JsVarInt)info.hits));
+  jsvObjectSetChildAndUnLock(obj, "misses", jsvNewFromInteger((JsVarInt)info.misses));
+  jsvObjectSetChildAndUnLock(obj, "entries", jsvNewFromInteger((JsVarInt)info.entries));
+  jsvObjectSetChildAndUnLock(obj, "used", jsvNewFromInteger((JsVarInt)info.used));
+  jsvObjectSetChildAndUnLock(obj, "size", jsvNewFromInteger((JsVarInt)info.size));
+  return obj;
+}
+#endif
+
 typedef struct {
   JsGraphicsFontSize font;
   unsigned short scale;
@@ -2679,6 +2775,9 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
       if (x>minX-w && x<maxX  && y>minY-fontHeight && y<=maxY) {
         if (solidBackground)
           graphicsFillRect(&gfx,x,y,x+w-1,y+fontHeight-1, gfx.data.bgColor);
+#ifndef ESPR_NO_GLYPH_CACHE
+        if (!glyphCacheDrawVectorChar(&gfx, x, y, info.scalex, info.scaley, (char)ch))
+#endif
         graphicsGetVectorChar((graphicsPolyCallback)graphicsFillPoly, &gfx, x, y, info.scalex, info.scaley, (char)ch);
       }
       x+=w;
@@ -2696,6 +2795,11 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
 #ifndef SAVE_ON_FLASH
 #ifdef ESPR_PBF_FONTS
     } else if ((info.font & JSGRAPHICS_FONTSIZE_FONT_MASK)==JSGRAPHICS_FONTSIZE_CUSTOM_PBF) {
+#ifndef ESPR_NO_GLYPH_CACHE
+      int advance;
+      if (glyphCacheDrawPbfChar(&gfx, &info.pbfInfo, ch, x, y, solidBackground, info.scalex, info.scaley, &advance))
+        x+=advance*info.scalex;
+#else
       PbfFontLoaderGlyph glyph;
       if (jspbfFontFindGlyph(&info.pbfInfo, ch, &glyph)) {
         jspbfFontRenderGlyph(&info.pbfInfo, &glyph, &gfx,
@@ -2703,6 +2807,7 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
                 solidBackground, info.scalex, info.scaley);
         x+=glyph.advance*info.scalex;
       }
+#endif
 #endif
     } else if ((info.font & JSGRAPHICS_FONTSIZE_CUSTOM_BIT) && (ch<256)) {
       int customBPPRange = (1<<customBPP)-1;
@@ -3133,7 +3238,6 @@ but not including* the bottom right. When placed together polygons will align
 perfectly without overdraw - but this will not fill the same pixels as
 `drawPoly` (drawing a line around the edge of the polygon).
 
-**Note:** there is a limit of 64 points (128 XY elements) for polygons
 */
 /*JSON{
   "type" : "method",
@@ -3165,40 +3269,33 @@ but not including* the bottom right. When placed together polygons will align
 perfectly without overdraw - but this will not fill the same pixels as
 `drawPoly` (drawing a line around the edge of the polygon).
 
-**Note:** there is a limit of 64 points (128 XY elements) for polygons
+Edges are antialiased by working out how much of each pixel the polygon
+covers, so pixels that are completely covered are the same as with `fillPoly`.
 */
 JsVar *jswrap_graphics_fillPoly_X(JsVar *parent, JsVar *poly, bool antiAlias) {
   JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return 0;
   if (!jsvIsIterable(poly)) return 0;
-  const int maxVerts = 128;
-  short verts[maxVerts];
+  size_t maxVerts = (size_t)jsvGetLength(poly);
+  if (maxVerts*sizeof(short)+256 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "Not enough stack memory for polygon");
+    return 0;
+  }
+  short *verts = (short*)alloca(maxVerts*sizeof(short));
   int idx = 0;
   JsvIterator it;
   jsvIteratorNew(&it, poly, JSIF_EVERY_ARRAY_ELEMENT);
-  while (jsvIteratorHasElement(&it) && idx<maxVerts) {
+  while (jsvIteratorHasElement(&it) && idx<(int)maxVerts) {
     int v = (int)(0.5 + jsvIteratorGetFloatValue(&it)*16);
     if (v<-32768) v=-32768;
     if (v>32767) v=32767;
     verts[idx++] = (short)v;
     jsvIteratorNext(&it);
   }
-  if (jsvIteratorHasElement(&it))
-    jsExceptionHere(JSET_ERROR, "Maximum number of points (%d) exceeded for fillPoly", maxVerts/2);
   jsvIteratorFree(&it);
 #ifdef GRAPHICS_ANTIALIAS
-  // For antialiased fillPoly the easiest solution is just to draw AA lines
-  // around the edge first, then fill solidly
-  if (antiAlias) {
-    int lx = verts[idx-2];
-    int ly = verts[idx-1];
-    for (int i=0;i<idx;i+=2) {
-      int vx = verts[i];
-      int vy = verts[i+1];
-      graphicsDrawLineAA(&gfx, vx,vy, lx,ly);
-      lx = vx;
-      ly = vy;
-    }
-  }
+  if (antiAlias)
+    graphicsFillPolyAA(&gfx, idx/2, verts);
+  else
 #endif
   graphicsFillPoly(&gfx, idx/2, verts);
 
@@ -3911,13 +4008,20 @@ JsVar *jswrap_graphics_asImage(JsVar *parent, JsVar *imgType) {
     ["reset","bool","Whether to reset the modified area or not"]
   ],
   "return" : ["JsVar","An object {x1,y1,x2,y2} containing the modified area, or undefined if not modified"],
-  "typescript" : "getModified(reset?: boolean): { x1: number, y1: number, x2: number, y2: number };"
+  "typescript" : "getModified(reset?: boolean): { x1: number, y1: number, x2: number, y2: number, rows?: [number, number][] };"
 }
 Return the area of the Graphics canvas that has been modified, and optionally
 clear the modified area to 0.
 
 For instance if `g.setPixel(10,20)` was called, this would return `{x1:10,
 y1:20, x2:10, y2:20}`
+
+Graphics also keeps track of which bands of 8 rows have been modified. If rows
+between `y1` and `y2` weren't modified (for instance something was drawn at the
+top and bottom of the screen) the object also contains `rows`, an array of
+`[y1,y2]` ranges of rows that were, so that only those need sending to a
+display. For example `g.setPixel(0,0);g.setPixel(0,20)` would return `{x1:0,
+y1:0, x2:0, y2:20, rows:[[0,7],[16,20]]}`
 */
 JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset) {
 #ifndef NO_MODIFIED_AREA
@@ -3930,13 +4034,25 @@ JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset) {
       jsvObjectSetChildAndUnLock(obj, "y1", jsvNewFromInteger(gfx.data.modMinY));
       jsvObjectSetChildAndUnLock(obj, "x2", jsvNewFromInteger(gfx.data.modMaxX));
       jsvObjectSetChildAndUnLock(obj, "y2", jsvNewFromInteger(gfx.data.modMaxY));
+#ifndef ESPR_NO_MODIFIED_BANDS
+      int y1 = 0, y2;
+      if (graphicsGetModifiedRows(&gfx, &y1, &y2) && y2 < gfx.data.modMaxY) { // more than one run of rows
+        JsVar *rows = jsvNewEmptyArray();
+        if (rows) {
+          do {
+            JsVar *run[2] = { jsvNewFromInteger(y1), jsvNewFromInteger(y2) };
+            jsvArrayPushAndUnLock(rows, jsvNewArray(run, 2));
+            jsvUnLockMany(2, run);
+            y1 = y2+1;
+          } while (graphicsGetModifiedRows(&gfx, &y1, &y2));
+          jsvObjectSetChildAndUnLock(obj, "rows", rows);
+        }
+      }
+#endif
     }
   }
   if (reset) {
-    gfx.data.modMaxX = -32768;
-    gfx.data.modMaxY = -32768;
-    gfx.data.modMinX = 32767;
-    gfx.data.modMinY = 32767;
+    graphicsClearModified(&gfx);
     graphicsSetVar(&gfx);
   }
   return obj;
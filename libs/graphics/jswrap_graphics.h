@@ -62,6 +62,7 @@ JsVar *jswrap_graphics_setFontAlign(JsVar *parent, int x, int y, int r);
 JsVar *jswrap_graphics_setFont(JsVar *parent, JsVar *name, int size);
 JsVar *jswrap_graphics_getFont(JsVar *parent);
 JsVar *jswrap_graphics_getFonts(JsVar *parent);
+JsVar *jswrap_graphics_getGlyphCacheInfo(bool reset);
 int jswrap_graphics_getFontHeight(JsVar *parent);
 JsVar *jswrap_graphics_wrapString(JsVar *parent, JsVar *str, int maxWidth);
 JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *str, int x, int y, bool solidBackground);
@@ -95,6 +96,9 @@ JsVar *jswrap_graphics_theme();
 JsVar *jswrap_graphics_setTheme(JsVar *parent, JsVar *theme);
 JsVar *jswrap_graphics_filter(JsVar *parent, JsVar *filter, JsVar *options);
 
+/// How many pixels of an image row are decoded at once before being sent to the backend with blitRow
+#define DRAWIMAGE_SPAN_SIZE 32
+
 /// Info about an image to be used for rendering
 typedef struct {
   int width, height, bpp;
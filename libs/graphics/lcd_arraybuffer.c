@@ -142,6 +142,52 @@ void  lcdFillRect_ArrayBuffer(struct JsGraphics *gfx, int x1, int y1, int x2, in
     lcdSetPixels_ArrayBuffer(gfx, x1, y, 1+x2-x1, col);
 }
 
+// set w pixels starting at x,y from cols, using one iterator for the whole row
+void lcdBlitRow_ArrayBuffer(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+  if (gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR)
+    return graphicsFallbackBlitRow(gfx, x, y, w, cols);
+  JsVar *buf = (JsVar*)gfx->backendData;
+  unsigned int idx = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,w);
+  JsvArrayBufferIterator it;
+  jsvArrayBufferIteratorNew(&it, buf, idx>>3 );
+  int bpp = gfx->data.bpp;
+  bool msb = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB)!=0;
+  if (bpp&7/*not a multiple of one byte*/) {
+    // build up each byte and write it once
+    unsigned int mask = (unsigned int)(1<<bpp)-1;
+    unsigned int bitIdx = idx & 7;
+    unsigned int existing = (unsigned int)jsvArrayBufferIteratorGetIntegerValue(&it);
+    for (int i=0;i<w;i++) {
+      unsigned int shift = msb ? 8-(bitIdx+(unsigned)bpp) : bitIdx;
+      existing = (existing&~(mask<<shift)) | ((cols[i]&mask)<<shift);
+      bitIdx += (unsigned)bpp;
+      if (bitIdx>=8) {
+        jsvArrayBufferIteratorSetByteValue(&it, (char)existing);
+        jsvArrayBufferIteratorNext(&it);
+        bitIdx = 0;
+        if (i+1<w) existing = (unsigned int)jsvArrayBufferIteratorGetIntegerValue(&it);
+      }
+    }
+    if (bitIdx) jsvArrayBufferIteratorSetByteValue(&it, (char)existing);
+  } else { // we're writing whole bytes
+    for (int i=0;i<w;i++) {
+      unsigned int col = cols[i];
+      if (msb) {
+        for (int b=bpp-8;b>=0;b-=8) {
+          jsvArrayBufferIteratorSetByteValue(&it, (char)(col >> b));
+          jsvArrayBufferIteratorNext(&it);
+        }
+      } else {
+        for (int b=0;b<bpp;b+=8) {
+          jsvArrayBufferIteratorSetByteValue(&it, (char)(col >> b));
+          jsvArrayBufferIteratorNext(&it);
+        }
+      }
+    }
+  }
+  jsvArrayBufferIteratorFree(&it);
+}
+
 #ifdef GRAPHICS_ARRAYBUFFER_OPTIMISATIONS
 // Faster implementation for where we have a flat memory area
 unsigned int lcdGetPixel_ArrayBuffer_flat(JsGraphics *gfx, int x, int y) {
@@ -231,60 +277,279 @@ void lcdSetPixel_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, unsigned int co
   lcdSetPixels_ArrayBuffer_flat(gfx, x, y, 1, col);
 }
 
+/* Word-at-a-time kernels for flat buffers. These work on the range of bits
+ * a row of pixels covers - whole bytes in the middle are written a 32 bit
+ * word at a time, and the bytes at each end are masked. Bits are numbered in
+ * the order pixels are stored, so for MSB buffers the masks are mirrored
+ * within each byte. With INTERLEAVEX only every other pixel's bits belong to
+ * the row, so we also mask every byte with the bits that do. */
+
+/// Mask for bits b0..b1 (0<=b0<b1<=8, in pixel order) of a byte
+static ALWAYS_INLINE unsigned char lcdByteMask_ArrayBuffer(bool msb, unsigned int b0, unsigned int b1) {
+  unsigned int m = (1U<<(b1-b0))-1;
+  return (unsigned char)(msb ? m<<(8-b1) : m<<b0);
+}
+
+/// Can lcdFillRow_ArrayBuffer_flat handle this buffer's layout?
+static bool lcdCanFillWords_ArrayBuffer(JsGraphics *gfx) {
+  int bpp = gfx->data.bpp;
+  if (gfx->data.flags & (JSGRAPHICSFLAGS_ARRAYBUFFER_ZIGZAG|JSGRAPHICSFLAGS_ARRAYBUFFER_VERTICAL_BYTE)) return false;
+  if (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_INTERLEAVEX) return bpp<=4;
+  return bpp<=16 && bpp!=24;
+}
+
+/// Set the bits in 'mask' of ptr[0..len) to the repeating 2 byte pattern 'pat'
+static void lcdFillBytes_ArrayBuffer_flat(unsigned char *ptr, size_t len, const unsigned char *pat, unsigned char mask) {
+  unsigned int phase = 0;
+  while (len && ((size_t)ptr&3)) { // until we're word aligned
+    *ptr = (unsigned char)((*ptr&~mask) | (pat[phase]&mask));
+    ptr++;
+    len--;
+    phase ^= 1;
+  }
+  if (len>=4) {
+    unsigned char wordPat[4] = { pat[phase], pat[phase^1], pat[phase], pat[phase^1] };
+    uint32_t w, m = mask*0x01010101U;
+    memcpy(&w, wordPat, 4);
+    uint32_t *wp = (uint32_t*)ptr;
+    size_t words = len>>2;
+    if (mask==0xFF) {
+      while (words--) *(wp++) = w;
+    } else {
+      w &= m;
+      while (words--) {
+        *wp = (*wp&~m) | w;
+        wp++;
+      }
+    }
+    ptr = (unsigned char*)wp;
+    len &= 3; // an even number of bytes, so 'phase' is unchanged
+  }
+  while (len--) {
+    *ptr = (unsigned char)((*ptr&~mask) | (pat[phase]&mask));
+    ptr++;
+    phase ^= 1;
+  }
+}
+
+/// Fill pixelCount pixels starting at x,y (which may run on to the next row). lcdCanFillWords_ArrayBuffer must be true
+static void lcdFillRow_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, int pixelCount, unsigned int col) {
+  unsigned int bpp = gfx->data.bpp;
+  bool msb = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB)!=0;
+  bool interleave = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_INTERLEAVEX)!=0;
+  unsigned int stride = interleave ? bpp*2 : bpp;
+  unsigned int start = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,pixelCount);
+  unsigned int end = start + (unsigned int)(pixelCount-1)*stride + bpp; // exclusive
+  // work out what each byte should contain
+  unsigned char pat[2];
+  col &= (unsigned int)((1L<<bpp)-1);
+  if (bpp==16) {
+    pat[0] = (unsigned char)(msb ? col>>8 : col);
+    pat[1] = (unsigned char)(msb ? col : col>>8);
+  } else {
+    for (unsigned int b=bpp;b<8;b<<=1)
+      col |= col<<b;
+    pat[0] = pat[1] = (unsigned char)col;
+  }
+  unsigned char slots = 0xFF; // bits in each byte that belong to this row
+  if (interleave) {
+    unsigned int offset = start % stride; // 0 for the top half, bpp for the bottom
+    slots = 0;
+    for (unsigned int b=0;b<8;b++)
+      if (((b + stride - offset) % stride) < bpp)
+        slots |= lcdByteMask_ArrayBuffer(msb, b, b+1);
+  }
+  unsigned char *ptr = (unsigned char*)gfx->backendData + (start>>3);
+  if (start&7) { // partial first byte
+    unsigned int last = end - (start&~7U);
+    if (last>8) last = 8;
+    unsigned char m = lcdByteMask_ArrayBuffer(msb, start&7, last) & slots;
+    *ptr = (unsigned char)((*ptr&~m) | (pat[0]&m));
+    ptr++;
+    start = (start&~7U) + 8;
+    if (start>=end) return;
+  }
+  size_t bytes = (end-start)>>3;
+  lcdFillBytes_ArrayBuffer_flat(ptr, bytes, pat, slots);
+  if (end&7) { // partial last byte
+    ptr += bytes;
+    unsigned char m = lcdByteMask_ArrayBuffer(msb, 0, end&7) & slots;
+    *ptr = (unsigned char)((*ptr&~m) | (pat[0]&m));
+  }
+}
+
+/// Copy pixelCount pixels from sx,sy to dx,dy (the areas may overlap). Buffer must not be JSGRAPHICSFLAGS_NONLINEAR
+static void lcdCopyRow_ArrayBuffer_flat(JsGraphics *gfx, int dx, int dy, int sx, int sy, int pixelCount) {
+  if (pixelCount<=0) return;
+  unsigned int src = lcdGetPixelIndex_ArrayBuffer(gfx,sx,sy,pixelCount);
+  unsigned int dst = lcdGetPixelIndex_ArrayBuffer(gfx,dx,dy,pixelCount);
+  if ((src&7) != (dst&7)) { // pixels are at different places in each byte - copy one at a time
+    if (dst<src) {
+      for (int i=0;i<pixelCount;i++)
+        lcdSetPixels_ArrayBuffer_flat(gfx, dx+i, dy, 1, lcdGetPixel_ArrayBuffer_flat(gfx, sx+i, sy));
+    } else {
+      for (int i=pixelCount-1;i>=0;i--)
+        lcdSetPixels_ArrayBuffer_flat(gfx, dx+i, dy, 1, lcdGetPixel_ArrayBuffer_flat(gfx, sx+i, sy));
+    }
+    return;
+  }
+  bool msb = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB)!=0;
+  unsigned char *s = (unsigned char*)gfx->backendData + (src>>3);
+  unsigned char *d = (unsigned char*)gfx->backendData + (dst>>3);
+  unsigned int first = dst&7;
+  unsigned int end = first + (unsigned int)pixelCount*gfx->data.bpp; // in bits, from the start of 'd'
+  if (end<=8) { // all within one byte
+    unsigned char m = lcdByteMask_ArrayBuffer(msb, first, end);
+    *d = (unsigned char)((*d&~m) | (*s&m));
+    return;
+  }
+  // read partial bytes at each end before the middle is overwritten
+  unsigned char head = s[0], tail = s[end>>3];
+  size_t headBytes = first ? 1 : 0;
+  memmove(d+headBytes, s+headBytes, (end>>3)-headBytes);
+  if (first) {
+    unsigned char m = lcdByteMask_ArrayBuffer(msb, first, 8);
+    d[0] = (unsigned char)((d[0]&~m) | (head&m));
+  }
+  if (end&7) {
+    unsigned char m = lcdByteMask_ArrayBuffer(msb, 0, end&7);
+    d[end>>3] = (unsigned char)((d[end>>3]&~m) | (tail&m));
+  }
+}
+
 // Faster implementation for where we have a flat memory area
 void  lcdFillRect_ArrayBuffer_flat(struct JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
   int y;
+  if (lcdCanFillWords_ArrayBuffer(gfx)) {
+    if (x1==0 && x2==gfx->data.width-1 && !(gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_INTERLEAVEX)) {
+      // whole rows are next to each other in memory, so fill them all at once
+      lcdFillRow_ArrayBuffer_flat(gfx, 0, y1, gfx->data.width*(1+y2-y1), col);
+    } else {
+      for (y=y1;y<=y2;y++)
+        lcdFillRow_ArrayBuffer_flat(gfx, x1, y, 1+x2-x1, col);
+    }
+    return;
+  }
   for (y=y1;y<=y2;y++)
     lcdSetPixels_ArrayBuffer_flat(gfx, x1, y, 1+x2-x1, col);
 }
 
-#ifdef GRAPHICS_FAST_PATHS
-void lcdSetPixel_ArrayBuffer_flat1(JsGraphics *gfx, int x, int y, unsigned int col) {
-  int p = x + y*gfx->data.width;
-  if (col) ((uint8_t*)gfx->backendData)[p>>3] |= (uint8_t)(0x80 >> (p&7));
-  else ((uint8_t*)gfx->backendData)[p>>3] &= (uint8_t)(0xFF7F >> (p&7));
+// Faster implementation for where we have a flat memory area (and a linear layout)
+void lcdScroll_ArrayBuffer_flat(JsGraphics *gfx, int xdir, int ydir, int x1, int y1, int x2, int y2) {
+  int count = 1+x2-x1-((xdir<0)?-xdir:xdir);
+  int sx = (xdir<0) ? x1-xdir : x1;
+  int dx = (xdir<0) ? x1 : x1+xdir;
+  if (ydir<=0) {
+    for (int y=y1;y<=y2+ydir;y++)
+      lcdCopyRow_ArrayBuffer_flat(gfx, dx, y, sx, y-ydir, count);
+  } else {
+    for (int y=y2-ydir;y>=y1;y--)
+      lcdCopyRow_ArrayBuffer_flat(gfx, dx, y+ydir, sx, y, count);
+  }
 }
 
-void lcdFillRect_ArrayBuffer_flat1(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
-  for (int y=y1;y<=y2;y++) {
-    int p = x1 + y*gfx->data.width;
-    for (int x=x1;x<=x2;x++) {
-      if (col) ((uint8_t*)gfx->backendData)[p>>3] |= (uint8_t)(0x80 >> (p&7));
-      else ((uint8_t*)gfx->backendData)[p>>3] &= (uint8_t)(0xFF7F >> (p&7));
-      p++;
+// Faster implementation for where we have a flat memory area (and a linear layout)
+void lcdBlit_ArrayBuffer_flat(JsGraphics *gfx, int x1, int y1, int w, int h, int x2, int y2) {
+  if (y2>y1) { // copy from the bottom up so we don't overwrite what we're copying
+    for (int y=h-1;y>=0;y--)
+      lcdCopyRow_ArrayBuffer_flat(gfx, x2, y2+y, x1, y1+y, w);
+  } else {
+    for (int y=0;y<h;y++)
+      lcdCopyRow_ArrayBuffer_flat(gfx, x2, y2+y, x1, y1+y, w);
+  }
+}
+
+// Faster implementation for where we have a flat memory area
+void lcdBlitRow_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+  if (gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR)
+    return graphicsFallbackBlitRow(gfx, x, y, w, cols);
+  unsigned char *ptr = (unsigned char*)gfx->backendData;
+  unsigned int idx = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,w);
+  ptr += idx>>3;
+  int bpp = gfx->data.bpp;
+  bool msb = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB)!=0;
+  if (bpp&7/*not a multiple of one byte*/) {
+    // build up each byte and write it once
+    unsigned int mask = (unsigned int)(1<<bpp)-1;
+    unsigned int bitIdx = idx & 7;
+    unsigned int existing = *ptr;
+    for (int i=0;i<w;i++) {
+      unsigned int shift = msb ? 8-(bitIdx+(unsigned)bpp) : bitIdx;
+      existing = (existing&~(mask<<shift)) | ((cols[i]&mask)<<shift);
+      bitIdx += (unsigned)bpp;
+      if (bitIdx>=8) {
+        *(ptr++) = (unsigned char)existing;
+        bitIdx = 0;
+        if (i+1<w) existing = *ptr;
+      }
+    }
+    if (bitIdx) *ptr = (unsigned char)existing;
+  } else if (bpp==16 && !msb) {
+    for (int i=0;i<w;i++) {
+      *(ptr++) = (unsigned char)cols[i];
+      *(ptr++) = (unsigned char)(cols[i] >> 8);
+    }
+  } else { // we're writing whole bytes
+    for (int i=0;i<w;i++) {
+      unsigned int col = cols[i];
+      if (msb) {
+        for (int b=bpp-8;b>=0;b-=8)
+          *(ptr++) = (unsigned char)(col >> b);
+      } else {
+        for (int b=0;b<bpp;b+=8)
+          *(ptr++) = (unsigned char)(col >> b);
+      }
     }
   }
 }
 
+#ifdef GRAPHICS_FAST_PATHS
+void lcdSetPixel_ArrayBuffer_flat1(JsGraphics *gfx, int x, int y, unsigned int col) {
+  int p = x + y*gfx->data.width;
+  if (col&1) ((uint8_t*)gfx->backendData)[p>>3] |= (uint8_t)(0x80 >> (p&7));
+  else ((uint8_t*)gfx->backendData)[p>>3] &= (uint8_t)(0xFF7F >> (p&7));
+}
+
 void lcdSetPixel_ArrayBuffer_flat8(JsGraphics *gfx, int x, int y, unsigned int col) {
   ((uint8_t*)gfx->backendData)[x + y*gfx->data.width] = (uint8_t)col;
 }
 
+void lcdBlitRow_ArrayBuffer_flat8(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+  uint8_t *p = &((uint8_t*)gfx->backendData)[x + y*gfx->data.width];
+  for (int i=0;i<w;i++)
+    p[i] = (uint8_t)cols[i];
+}
+
 unsigned int lcdGetPixel_ArrayBuffer_flat8(struct JsGraphics *gfx, int x, int y) {
   return ((uint8_t*)gfx->backendData)[x + y*gfx->data.width];
 }
 
 void lcdFillRect_ArrayBuffer_flat8(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
+  uint8_t *p = &((uint8_t*)gfx->backendData)[x1 + y1*gfx->data.width];
+  if (x1==0 && x2==gfx->data.width-1) { // whole rows are next to each other in memory
+    memset(p, (uint8_t)col, (size_t)(gfx->data.width*(1+y2-y1)));
+    return;
+  }
   for (int y=y1;y<=y2;y++) {
-    uint8_t *p = &((uint8_t*)gfx->backendData)[x1 + y*gfx->data.width];
-    for (int x=x1;x<=x2;x++)
-      *(p++) = (uint8_t)col;
+    memset(p, (uint8_t)col, (size_t)(1+x2-x1));
+    p += gfx->data.width;
   }
 }
 
 void lcdScroll_ArrayBuffer_flat8(JsGraphics *gfx, int xdir, int ydir, int x1, int y1, int x2, int y2) {
-  int clipWidth = x2 - x1;
-  int clipHeight = y2 - y1;
-  int pixels = -(xdir + ydir*clipWidth);
-  int startPixel = gfx->data.width * (y1 - ydir) + x1;
-  int row;
-  for (row=0; row<(clipHeight+ydir); row++) {
-    if (pixels<0) {
-      memcpy(&((uint8_t*)gfx->backendData)[startPixel-pixels],&((uint8_t*)gfx->backendData)[startPixel],(size_t)(clipWidth+xdir));
-    } else {
-      memcpy(&((uint8_t*)gfx->backendData)[startPixel],&((uint8_t*)gfx->backendData)[startPixel+pixels],(size_t)(clipWidth-xdir));
-    }
-    startPixel += gfx->data.width;
+  int count = 1+x2-x1-((xdir<0)?-xdir:xdir);
+  if (count<=0) return;
+  int sx = (xdir<0) ? x1-xdir : x1;
+  int dx = (xdir<0) ? x1 : x1+xdir;
+  uint8_t *buf = (uint8_t*)gfx->backendData;
+  int w = gfx->data.width;
+  int y;
+  if (ydir<=0) {
+    for (y=y1;y<=y2+ydir;y++)
+      memmove(&buf[dx+y*w], &buf[sx+(y-ydir)*w], (size_t)count);
+  } else {
+    for (y=y2-ydir;y>=y1;y--)
+      memmove(&buf[dx+(y+ydir)*w], &buf[sx+y*w], (size_t)count);
   }
 }
 #endif
@@ -316,14 +581,19 @@ void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx) {
         ) { // super fast path for 1 bit
       gfx->setPixel = lcdSetPixel_ArrayBuffer_flat1;
       gfx->getPixel = lcdGetPixel_ArrayBuffer_flat;
-      gfx->fillRect = lcdFillRect_ArrayBuffer_flat1;
+      gfx->fillRect = lcdFillRect_ArrayBuffer_flat;
+      gfx->blitRow = lcdBlitRow_ArrayBuffer_flat;
+      gfx->scroll = lcdScroll_ArrayBuffer_flat;
+      gfx->blit = lcdBlit_ArrayBuffer_flat;
     } else if (gfx->data.bpp==8 &&
                !(gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR)
         ) { // super fast path for 8 bits
       gfx->setPixel = lcdSetPixel_ArrayBuffer_flat8;
       gfx->getPixel = lcdGetPixel_ArrayBuffer_flat8;
       gfx->fillRect = lcdFillRect_ArrayBuffer_flat8;
+      gfx->blitRow = lcdBlitRow_ArrayBuffer_flat8;
       gfx->scroll = lcdScroll_ArrayBuffer_flat8;
+      gfx->blit = lcdBlit_ArrayBuffer_flat;
     } else
 #endif
     {
@@ -331,6 +601,11 @@ void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx) {
       gfx->setPixel = lcdSetPixel_ArrayBuffer_flat;
       gfx->getPixel = lcdGetPixel_ArrayBuffer_flat;
       gfx->fillRect = lcdFillRect_ArrayBuffer_flat;
+      gfx->blitRow = lcdBlitRow_ArrayBuffer_flat;
+      if (!(gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR)) {
+        gfx->scroll = lcdScroll_ArrayBuffer_flat;
+        gfx->blit = lcdBlit_ArrayBuffer_flat;
+      }
     }
 #else
   if (false) {
@@ -342,6 +617,7 @@ void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx) {
     gfx->setPixel = lcdSetPixel_ArrayBuffer;
     gfx->getPixel = lcdGetPixel_ArrayBuffer;
     gfx->fillRect = lcdFillRect_ArrayBuffer;
+    gfx->blitRow = lcdBlitRow_ArrayBuffer;
   }
 }
 
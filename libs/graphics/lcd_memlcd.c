@@ -25,6 +25,7 @@
 #define LCD_SPI EV_SPI1
 #define LCD_ROWHEADER 2
 #define LCD_STRIDE (LCD_ROWHEADER+((LCD_WIDTH*LCD_BPP+7)>>3)) // data in required BPP, plus 2 bytes LCD command
+#define LCD_SPI_CS_LOW_US 2 // How long SCS is held low between two transfers, so the panel sees the end of one before the next starts
 
 /** Buffer for our LCD data.
   - We add 2 extra lines (LCD_HEIGHT+2) as a scratch area for doing the overlay (if enabled)
@@ -223,6 +224,29 @@ void lcdMemLCD_fillRect(struct JsGraphics *gfx, int x1, int y1, int x2, int y2,
   }
 }
 
+void lcdMemLCD_blitRow(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+  lcdMemLCD_waitForSendComplete();
+#if LCD_BPP==3
+  int bitaddr = LCD_ROWHEADER*8 + (x*3) + (y*LCD_STRIDE*8);
+  for (int i=0;i<w;i++) {
+    unsigned int col = lcdMemLCD_convert16toLCD(cols[i],x+i,y);
+    int bit = bitaddr&7;
+    uint16_t b = *(uint16_t*)&lcdBuffer[bitaddr>>3];
+    *(uint16_t*)&lcdBuffer[bitaddr>>3] = (b & ~(7<<bit)) | (col<<bit);
+    bitaddr += 3;
+  }
+#endif
+#if LCD_BPP==4
+  unsigned char *p = &lcdBuffer[LCD_ROWHEADER + (x>>1) + (y*LCD_STRIDE)];
+  for (int i=0;i<w;i++) {
+    unsigned int col = lcdMemLCD_convert16toLCD(cols[i],x+i,y);
+    if ((x+i)&1) {
+      *p = (*p & 0x0F) | (col << 4);
+      p++;
+    } else *p = (*p & 0xF0) | col;
+  }
+#endif
+}
 
 static void lcdMemLCD_scrollX(struct JsGraphics *gfx, unsigned char *dst, unsigned char *src, int xdir) {
   uint32_t *dw = (uint32_t*)&dst[LCD_ROWHEADER];
@@ -287,7 +311,6 @@ void lcdMemLCD_flip(JsGraphics *gfx) {
 
   int y1 = gfx->data.modMinY;
   int y2 = gfx->data.modMaxY;
-  int l = 1+y2-y1;
 
   bool hasOverlay = false;
   GfxDrawImageInfo overlayImg;
@@ -363,20 +386,42 @@ void lcdMemLCD_flip(JsGraphics *gfx) {
     gfx->data.fgColor = oldFgColor;
     gfx->data.bgColor = oldBgColor;
   } else { // standard, non-overlay
+    /* Send each run of modified rows as a separate transfer (each row has its
+    own address so we can skip the rows between). All but the last are ended by
+    us toggling CS, so we have to wait for the SPI to finish first. The last
+    one completes in the background and lowers CS in lcdMemLCD_flip_spi_callback */
+    int ry1 = y1, ry2;
+    graphicsGetModifiedRows(gfx, &ry1, &ry2);
+#ifndef EMULATED
+    lcdIsBusy = true;
+#endif
+    while (true) {
+      int nextY1 = ry2+1, nextY2;
+      bool isLast = !graphicsGetModifiedRows(gfx, &nextY1, &nextY2);
 #ifdef EMULATED
-    memcpy(fakeLCDBuffer, lcdBuffer, LCD_HEIGHT*LCD_STRIDE);
+      memcpy(&fakeLCDBuffer[LCD_STRIDE*ry1], &lcdBuffer[LCD_STRIDE*ry1], (size_t)((1+ry2-ry1)*LCD_STRIDE));
 #else
-    lcdIsBusy = true;
-    if (!jshSPISendMany(LCD_SPI, &lcdBuffer[LCD_STRIDE*y1], NULL, (l*LCD_STRIDE)+2, lcdMemLCD_flip_spi_callback))
-      lcdMemLCD_flip_spi_callback();
-    // lcdMemLCD_flip_spi_callback will call jshPinSetValue(LCD_SPI_CS, 0); when done and set lcdIsBusy=false
+      size_t len = (size_t)((1+ry2-ry1)*LCD_STRIDE)+2;
+      if (isLast) {
+        if (!jshSPISendMany(LCD_SPI, &lcdBuffer[LCD_STRIDE*ry1], NULL, len, lcdMemLCD_flip_spi_callback))
+          lcdMemLCD_flip_spi_callback();
+        // lcdMemLCD_flip_spi_callback will call jshPinSetValue(LCD_SPI_CS, 0); when done and set lcdIsBusy=false
+      } else {
+        jshSPISendMany(LCD_SPI, &lcdBuffer[LCD_STRIDE*ry1], NULL, len, NULL);
+        // the send may still be in progress (eg. DMA), and CS must stay high until it's done
+        jshSPIWait(LCD_SPI);
+        jshPinSetValue(LCD_SPI_CS, 0);
+        jshDelayMicroseconds(LCD_SPI_CS_LOW_US);
+        jshPinSetValue(LCD_SPI_CS, 1);
+      }
 #endif
+      if (isLast) break;
+      ry1 = nextY1;
+      ry2 = nextY2;
+    }
   }
   // Reset modified-ness
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
+  graphicsClearModified(gfx);
 }
 
 void lcdMemLCD_init(JsGraphics *gfx) {
@@ -445,6 +490,7 @@ void lcdMemLCD_setOverlay(JsVar *imgVar, int x, int y) {
 void lcdMemLCD_setCallbacks(JsGraphics *gfx) {
   gfx->setPixel = lcdMemLCD_setPixel;
   gfx->fillRect = lcdMemLCD_fillRect;
+  gfx->blitRow = lcdMemLCD_blitRow;
   gfx->getPixel = lcdMemLCD_getPixel;
   gfx->scroll = lcdMemLCD_scroll;
 }
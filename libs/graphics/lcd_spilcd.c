@@ -140,6 +140,21 @@ void lcdSetPixel_SPILCD(JsGraphics *gfx, int x, int y, unsigned int col) {
 #endif
 }
 
+void lcdBlitRow_SPILCD(JsGraphics *gfx, int x, int y, int w, const unsigned int *cols) {
+#if LCD_BPP==8
+  unsigned char *p = &lcdBuffer[x + (y*LCD_WIDTH)];
+  for (int i=0;i<w;i++)
+    p[i] = (unsigned char)cols[i];
+#elif LCD_BPP==16
+  uint16_t *p = (uint16_t*)(lcdBuffer) + x + (y*LCD_WIDTH);
+  for (int i=0;i<w;i++)
+    p[i] = __builtin_bswap16((uint16_t)cols[i]);
+#else
+  for (int i=0;i<w;i++)
+    lcdSetPixel_SPILCD(gfx, x+i, y, cols[i]);
+#endif
+}
+
 #if LCD_BPP==16
 void lcdFillRect_SPILCD(struct JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
   // or update just part of it.
@@ -181,6 +196,33 @@ void lcdFlip_SPILCD_callback() {
   // just an empty stub for SPIsend - we'll just push data as fast as we can
 }
 
+/// Set the area of the screen the following data will be written to (waiting for any previous data to be sent first)
+static void lcdFlip_SPILCD_setWindow(unsigned char *buffer, int x1, int y1, int x2, int y2) {
+  jshSPIWait(LCD_SPI);
+  jshPinSetValue(LCD_SPI_DC, 0); // command
+  buffer[0] = SPILCD_CMD_WINDOW_X;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
+  jshPinSetValue(LCD_SPI_DC, 1); // data
+  buffer[0] = 0;
+  buffer[1] = (unsigned char)x1;
+  buffer[2] = 0;
+  buffer[3] = (unsigned char)x2;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 4, NULL);
+  jshPinSetValue(LCD_SPI_DC, 0); // command
+  buffer[0] = SPILCD_CMD_WINDOW_Y;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
+  jshPinSetValue(LCD_SPI_DC, 1); // data
+  buffer[0] = 0;
+  buffer[1] = (unsigned char)y1;
+  buffer[2] = 0;
+  buffer[3] = (unsigned char)y2;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 4, NULL);
+  jshPinSetValue(LCD_SPI_DC, 0); // command
+  buffer[0] = SPILCD_CMD_DATA;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
+  jshPinSetValue(LCD_SPI_DC, 1); // data
+}
+
 void lcdFlip_SPILCD(JsGraphics *gfx) {
   if (gfx->data.modMinX > gfx->data.modMaxX) return; // nothing to do!
 
@@ -222,31 +264,13 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
 #endif
 
   jshPinSetValue(LCD_SPI_CS, 0);
-  jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_WINDOW_X;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
-  jshPinSetValue(LCD_SPI_DC, 1); // data
-  buffer1[0] = 0;
-  buffer1[1] = gfx->data.modMinX;
-  buffer1[2] = 0;
-  buffer1[3] = gfx->data.modMaxX;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 4, NULL);
-  jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_WINDOW_Y;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
-  jshPinSetValue(LCD_SPI_DC, 1); // data
-  buffer1[0] = 0;
-  buffer1[1] = gfx->data.modMinY;
-  buffer1[2] = 0;
-  buffer1[3] = gfx->data.modMaxY;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 4, NULL);
-  jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_DATA;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
-  jshPinSetValue(LCD_SPI_DC, 1); // data
-
+  /* We send each run of modified rows (see graphicsGetModifiedRows) with its
+  own window, so if something at the top and bottom of the screen changed we
+  don't send everything in between */
+  int y1 = 0, y2;
 #if LCD_BPP==12 || LCD_BPP==16
   if (hasOverlay) { // we have an overlay, just send line by line
+    lcdFlip_SPILCD_setWindow(buffer1, gfx->data.modMinX, gfx->data.modMinY, gfx->data.modMaxX, gfx->data.modMaxY);
     // initialise image layer
     GfxDrawImageLayer l;
     int ovY = lcdOverlayY;
@@ -291,11 +315,12 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
     memcpy(&lcdBuffer[LCD_STRIDE*1], buffer2, LCD_STRIDE);
 
     jshSPIWait(LCD_SPI);
-  } else { // ============================================  standard, non-overlay transfer
+  } else while (graphicsGetModifiedRows(gfx, &y1, &y2)) { // ==========  standard, non-overlay transfer
+    lcdFlip_SPILCD_setWindow(buffer1, gfx->data.modMinX, y1, gfx->data.modMaxX, y2);
     // FIXME: hack because SPI send on NRF52 fails for >65k transfers
     // we should fix this in jshardware.c
-    unsigned char *p = &lcdBuffer[LCD_STRIDE*gfx->data.modMinY];
-    int c = (gfx->data.modMaxY+1-gfx->data.modMinY)*LCD_STRIDE;
+    unsigned char *p = &lcdBuffer[LCD_STRIDE*y1];
+    int c = (y2+1-y1)*LCD_STRIDE;
     while (c) {
       int n = c;
       if (n>65535) n=65535;
@@ -309,36 +334,43 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
       p+=n;
       c-=n;
     }
+    if (jspIsInterrupted()) break;
+    y1 = y2+1;
   }
 #else // Data stored paletted - must decode the palette before sending
   unsigned char buffer2[LCD_STRIDE];
-  for (int y=gfx->data.modMinY;y<=gfx->data.modMaxY;y++) {
-    unsigned char *buffer = (y&1)?buffer1:buffer2;
-    // skip any lines that don't need updating
+  while (graphicsGetModifiedRows(gfx, &y1, &y2)) {
+    lcdFlip_SPILCD_setWindow(buffer1, gfx->data.modMinX, y1, gfx->data.modMaxX, y2);
+    for (int y=y1;y<=y2;y++) {
+      unsigned char *buffer = (y&1)?buffer1:buffer2;
+      // skip any lines that don't need updating
 #if LCD_BPP==4
-    unsigned char *px = &lcdBuffer[y*LCD_STRIDE + (xstart>>1)];
+      unsigned char *px = &lcdBuffer[y*LCD_STRIDE + (xstart>>1)];
 #endif
 #if LCD_BPP==8
-    unsigned char *px = &lcdBuffer[y*LCD_STRIDE + xstart];
+      unsigned char *px = &lcdBuffer[y*LCD_STRIDE + xstart];
 #endif
-    unsigned char *bufPtr = (unsigned char*)buffer;
-    for (int x=0;x<xlen;x+=2) {
+      unsigned char *bufPtr = (unsigned char*)buffer;
+      for (int x=0;x<xlen;x+=2) {
 #if LCD_BPP==4
-      unsigned char c = *(px++);
-      unsigned int a = lcdPalette[c >> 4];
-      unsigned int b = lcdPalette[c & 15];
+        unsigned char c = *(px++);
+        unsigned int a = lcdPalette[c >> 4];
+        unsigned int b = lcdPalette[c & 15];
 #endif
 #if LCD_BPP==8
-      unsigned int a = lcdPalette[*(px++)];
-      unsigned int b = lcdPalette[*(px++)];
+        unsigned int a = lcdPalette[*(px++)];
+        unsigned int b = lcdPalette[*(px++)];
 #endif
-      *(bufPtr++) = a>>4;
-      *(bufPtr++) = (a<<4) | (b>>8);
-      *(bufPtr++) = b;
+        *(bufPtr++) = a>>4;
+        *(bufPtr++) = (a<<4) | (b>>8);
+        *(bufPtr++) = b;
+      }
+      size_t len = ((unsigned char*)bufPtr)-buffer;
+      jshSPISendMany(LCD_SPI, buffer, 0, len, lcdFlip_SPILCD_callback);
+      if (jspIsInterrupted()) break;
     }
-    size_t len = ((unsigned char*)bufPtr)-buffer;
-    jshSPISendMany(LCD_SPI, buffer, 0, len, lcdFlip_SPILCD_callback);
     if (jspIsInterrupted()) break;
+    y1 = y2+1;
   }
   jshSPIWait(LCD_SPI);
 #endif // End of paletted send
@@ -350,10 +382,7 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
 #endif
 
   // Reset modified-ness
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
+  graphicsClearModified(gfx);
 }
 
 
@@ -430,6 +459,7 @@ void lcdSetOverlay_SPILCD(JsVar *imgVar, int x, int y) {
 
 void lcdSetCallbacks_SPILCD(JsGraphics *gfx) {
   gfx->setPixel = lcdSetPixel_SPILCD;
+  gfx->blitRow = lcdBlitRow_SPILCD;
 #if LCD_BPP==16
   gfx->fillRect = lcdFillRect_SPILCD;
   gfx->blit = lcdBlit_SPILCD;
@@ -596,6 +596,7 @@ void lcdST7789_setCallbacks(JsGraphics *gfx) {
       gfx->setPixel = lcdSetPixel_ArrayBuffer_flat8;
       gfx->getPixel = lcdGetPixel_ArrayBuffer_flat8;
       gfx->fillRect = lcdFillRect_ArrayBuffer_flat8;
+      gfx->blitRow = lcdBlitRow_ArrayBuffer_flat8;
       gfx->scroll = lcdScroll_ArrayBuffer_flat8;
     }
   } else {
@@ -90,6 +90,36 @@ static void httpAppendHeaders(JsVar *string, JsVar *headerObject) {
   // free headers
 }
 
+/// Copy part of the received data into a new string - in one go if the data is in a flat string
+static JsVar *socketNewStringFromReceiveData(JsVar *receiveData, size_t idx, size_t len) {
+  if (jsvIsFlatString(receiveData)) {
+    size_t l = jsvGetStringLength(receiveData);
+    if (idx>l) idx=l;
+    if (len>l-idx) len=l-idx;
+    return jsvNewStringOfLength((unsigned int)len, jsvGetFlatStringPointer(receiveData)+idx);
+  }
+  JsVar *str = jsvNewFromEmptyString();
+  if (str) jsvAppendStringVar(str, receiveData, idx, len);
+  return str;
+}
+
+/** Add data we just received to receiveData (which may be 0), and return it. If
+ * there was nothing waiting we copy it straight into a new (flat if big enough) string */
+static JsVar *socketAppendReceiveData(JsVar *receiveData, const char *buf, size_t len) {
+  if (!receiveData || jsvIsEmptyString(receiveData)) {
+    jsvUnLock(receiveData);
+    return jsvNewStringOfLength((unsigned int)len, buf);
+  }
+  if (jsvIsFlatString(receiveData)) { // we can't append to flat strings, so copy it
+    JsVar *str = jsvNewWritableStringFromStringVar(receiveData, 0, JSVAPPENDSTRINGVAR_MAXLENGTH);
+    jsvUnLock(receiveData);
+    receiveData = str;
+    if (!str) return 0; // out of memory
+  }
+  jsvAppendStringBuf(receiveData, buf, len);
+  return receiveData;
+}
+
 // httpParseHeaders(&receiveData, reqVar, true) // server
 // httpParseHeaders(&receiveData, resVar, false) // client
 bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer) {
@@ -183,7 +213,7 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
     jsvObjectSetChildAndUnLock(objectForData, "statusMessage", jsvNewFromStringVar(*receiveData, (size_t)(secondSpace+1), (size_t)(firstEOL-(secondSpace+1))));
   }
   // strip out the header
-  JsVar *afterHeaders = jsvNewFromStringVar(*receiveData, (size_t)headerEnd, JSVAPPENDSTRINGVAR_MAXLENGTH);
+  JsVar *afterHeaders = socketNewStringFromReceiveData(*receiveData, (size_t)headerEnd, JSVAPPENDSTRINGVAR_MAXLENGTH);
   jsvUnLock(*receiveData);
   *receiveData = afterHeaders;
   return true;
@@ -343,9 +373,8 @@ void socketPushReceiveData(JsVar *reader, JsVar **receiveData, bool isHttp, bool
       size_t nextIdx = startIdx + (size_t)chunkLen + 2; // CRLF at the end
       if (nextIdx < len) { // there is another chunk in the buffer
         DBG("D:nextIdx %d %d\n", nextIdx, len);
-        nextChunk = jsvNewFromEmptyString();
+        nextChunk = socketNewStringFromReceiveData(*receiveData, nextIdx, len-nextIdx);
         if (!nextChunk) return; // out of memory
-        jsvAppendStringVar(nextChunk, *receiveData, nextIdx, len-nextIdx);
       } else if (nextIdx > len) { // chunk not complete
         DBG("D:partialIdx %d %d %d\n", len - startIdx, nextIdx - len - 2, len);
         if (nextIdx - len < 3) return; // just CRLF missing, wait
@@ -355,9 +384,8 @@ void socketPushReceiveData(JsVar *reader, JsVar **receiveData, bool isHttp, bool
         jsvAppendPrintf(partialChunk, "%x\r\n", nextIdx - len - 2);
       }
 
-      JsVar *chunkData = jsvNewFromEmptyString();
+      JsVar *chunkData = socketNewStringFromReceiveData(*receiveData, startIdx, (size_t)chunkLen);
       if (!chunkData) return; // out of memory
-      jsvAppendStringVar(chunkData, *receiveData, startIdx, (size_t)chunkLen);
       jsvUnLock(*receiveData);
       *receiveData = chunkData;
     } else {
@@ -517,9 +545,8 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
       } else {
         if (num>0) {
           JsVar *receiveData = jsvObjectGetChildIfExists(connection,HTTP_NAME_RECEIVE_DATA);
-          if (!receiveData) receiveData = jsvNewFromEmptyString();
+          receiveData = socketAppendReceiveData(receiveData, buf, (size_t)num);
           if (receiveData) {
-            jsvAppendStringBuf(receiveData, buf, (size_t)num);
             socketReceived(connection, socket, socketType, &receiveData, true);
             jsvObjectSetChild(connection,HTTP_NAME_RECEIVE_DATA,receiveData);
             jsvUnLock(receiveData);
@@ -701,10 +728,8 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
           }
           // got data add it to our receive buffer
           if (num > 0) {
-            if (!receiveData)
-              receiveData = jsvNewFromEmptyString();
+            receiveData = socketAppendReceiveData(receiveData, buf, (size_t)num);
             if (receiveData) { // could be out of memory
-              jsvAppendStringBuf(receiveData, buf, (size_t)num);
               socketReceived(connection, socket, socketType, &receiveData, false);
               jsvObjectSetChild(connection, HTTP_NAME_RECEIVE_DATA, receiveData);
             }
@@ -577,6 +577,21 @@ bool jshIsTopEvent(IOEventFlags eventType) {
   return IOEVENTFLAGS_GETTYPE(ioBuffer[ioTail].flags) == eventType;
 }
 
+unsigned int jshGetCharsInTopEvents(IOEventFlags eventType) {
+  unsigned int chars = 0;
+  IOBufferIdx head = ioHead;
+  IOBufferIdx lastHead = (IOBufferIdx)((head+IOBUFFERMASK) & IOBUFFERMASK); // one behind head
+  IOBufferIdx i = ioTail;
+  while (i!=head && IOEVENTFLAGS_GETTYPE(ioBuffer[i].flags) == eventType) {
+    unsigned int c = (unsigned int)IOEVENTFLAGS_GETCHARS(ioBuffer[i].flags);
+    // jshPushIOCharEventAppend could still add to the last event (unless it's the top one or full)
+    if (i==lastHead && i!=ioTail && c<IOEVENT_MAXCHARS) break;
+    chars += c;
+    i = (IOBufferIdx)((i+1) & IOBUFFERMASK);
+  }
+  return chars;
+}
+
 int jshGetEventsUsed() {
   int spaceUsed = (ioHead >= ioTail) ? ((int)ioHead-(int)ioTail) : /*or rolled*/((int)ioHead+IOBUFFERMASK+1-(int)ioTail);
   return spaceUsed;
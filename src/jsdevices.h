@@ -199,6 +199,8 @@ bool jshPopIOEventOfType(IOEventFlags eventType, IOEvent *result); ///< returns
 bool jshHasEvents();
 /// Check if the top event is for the given device
 bool jshIsTopEvent(IOEventFlags eventType);
+/// How many characters are in the events for the given device at the top of the queue (that won't have more characters added)
+unsigned int jshGetCharsInTopEvents(IOEventFlags eventType);
 
 /// How many event blocks are left? compare this to IOBUFFERMASK
 int jshGetEventsUsed();
@@ -13,7 +13,7 @@
  */
 #include "jsflags.h"
 
-volatile JsFlags jsFlags;
+volatile JsFlags jsFlags = JSF_DEFAULT;
 const char *jsFlagNames = JSFLAG_NAMES;
 
 
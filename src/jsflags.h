@@ -27,10 +27,19 @@ typedef enum {
 #ifdef ESPR_JIT
   JSF_JIT_DEBUG           = 1<<4, ///< When JIT enabled,
 #endif
+#ifndef ESPR_NO_NURSERY
+  JSF_NURSERY             = 1<<5, ///< When idle, move vars that survived in the nursery out of it (see jsvNurseryCollect)
+#endif
 } PACKED_FLAGS JsFlags;
 
+#if defined(ESPR_PRETOKENISE_BY_DEFAULT) && !defined(ESPR_NO_PRETOKENISE)
+#define JSF_DEFAULT JSF_PRETOKENISE ///< The flags that are set when Espruino starts
+#else
+#define JSF_DEFAULT JSF_NONE ///< The flags that are set when Espruino starts
+#endif
+
 
-#define JSFLAG_NAMES "deepSleep\0unsafeFlash\0unsyncFiles\0pretokenise\0jitDebug\0"
+#define JSFLAG_NAMES "deepSleep\0unsafeFlash\0unsyncFiles\0pretokenise\0jitDebug\0nursery\0"
 // NOTE: \0 also added by compiler - two \0's are required!
 
 extern volatile JsFlags jsFlags;
@@ -60,8 +60,47 @@ typedef enum {
 } PACKED_FLAGS InputState;
 
 JsVar *events = 0; // Array of events to execute
+#ifndef ESPR_NO_EVENT_RING
+/* Most events are queued in a fixed size ring of var references, so queueing
+ * and executing them doesn't need any vars allocating. If the ring is full
+ * (or an event has too many arguments) events go in 'events' instead, and
+ * while anything is in 'events' new events go there too so they stay in order. */
+typedef struct {
+  JsVarRef func;
+  JsVarRef thisVar;
+  JsVarRef args[JSI_EVENT_RING_ARGS];
+  unsigned char argCount;
+} JsiEvent;
+static JsiEvent jsiEventRing[JSI_EVENT_RING_SIZE];
+static unsigned char jsiEventRingStart; ///< Index of the first event in jsiEventRing
+static unsigned char jsiEventRingCount; ///< How many events are in jsiEventRing
+#endif
+uint32_t jsiEventsQueued; ///< How many events have been queued with jsiQueueEvents
+uint32_t jsiEventsOverflowed; ///< How many events have had to be queued in 'events' (allocating vars)
+uint32_t jsiEventsExecuted; ///< How many events have been taken off the queue by jsiExecuteEvents
 JsVarRef timerArray = 0; // Linked List of timers to check and run
 JsVarRef watchArray = 0; // Linked List of input watches to check and run
+/* The watches in watchArray, grouped by EXTI channel, with what we need to
+ * check when a pin changes copied out so we can go straight to the watches for
+ * that pin without looking anything up by name. The watches for channel 'n' are
+ * jsiWatchDispatch[jsiWatchDispatchStart[n] .. jsiWatchDispatchStart[n+1]-1].
+ * This only holds weak references - it's rebuilt when needed after
+ * jsiWatchesChanged is called. If there are more than JSI_WATCH_DISPATCH_SIZE
+ * watches, jsiWatchDispatchFull is set and we check every watch instead. */
+typedef struct {
+  JsVarRef watch;    ///< The name (in watchArray) of the watch
+  JsVarRef callback; ///< The watch's 'cb'
+  JsVarInt debounce; ///< The watch's 'debounce' time, or 0
+  Pin pin;           ///< The watch's 'pin'
+  signed char edge;  ///< The watch's 'edge' - 0 for both, >0 for rising, <0 for falling
+#ifndef ESPR_NO_WATCH_BATCH
+  bool batch;        ///< The watch's 'batch'
+#endif
+} JsiWatchEntry;
+static JsiWatchEntry jsiWatchDispatch[JSI_WATCH_DISPATCH_SIZE];
+static unsigned char jsiWatchDispatchStart[ESPR_EXTI_COUNT+1];
+static bool jsiWatchDispatchValid = false;
+static bool jsiWatchDispatchFull = false;
 // ----------------------------------------------------------------------------
 IOEventFlags consoleDevice = DEFAULT_CONSOLE_DEVICE; ///< The console device for user interaction
 #ifndef SAVE_ON_FLASH
@@ -70,6 +109,8 @@ Pin pinSleepIndicator = DEFAULT_SLEEP_PIN_INDICATOR;
 #endif
 JsiStatus jsiStatus = 0;
 JsSysTime jsiLastIdleTime;  ///< The last time we went around the idle loop - use this for timers
+JsSysTime jsiTimerBaseTime; ///< The 'time' of each timer is relative to this, so it doesn't have to be updated on every idle loop
+JsSysTime jsiTimerNextTime = JSSYSTIME_MAX; ///< When the next timer is due (relative to jsiTimerBaseTime) - only valid if JSIS_TIMERS_CHANGED isn't set
 #ifndef EMBEDDED
 uint32_t jsiTimeSinceCtrlC; ///< When was Ctrl-C last pressed. We use this so we quit on desktop when we do Ctrl-C + Ctrl-C
 #endif
@@ -462,10 +503,14 @@ void jsiSoftInit(bool hasBeenReset) {
   // Load timer/watch arrays
   timerArray = _jsiInitNamedArray(JSI_TIMERS_NAME);
   watchArray = _jsiInitNamedArray(JSI_WATCHES_NAME);
+  jsiWatchesChanged();
 
   // Make sure we set up lastIdleTime, as this could be used
   // when adding an interval from onInit (called below)
   jsiLastIdleTime = jshGetSystemTime();
+  // Timers were saved relative to the time we saved at (see jsiSoftKill)
+  jsiTimerBaseTime = jsiLastIdleTime;
+  jsiTimersChanged();
 #ifndef EMBEDDED
   jsiTimeSinceCtrlC = 0xFFFFFFFF;
 #endif
@@ -646,7 +691,7 @@ void jsiDumpHardwareInitialisation(vcbprintf_callback user_callback, void *user_
     cbprintf(user_callback, user_data, "setSleepIndicator(%p);\n", pinSleepIndicator);
   }
 #endif
-  if (humanReadableDump && jsFlags/* non-standard flags */) {
+  if (humanReadableDump && jsFlags!=JSF_DEFAULT/* non-standard flags */) {
     JsVar *v = jsfGetFlags();
     cbprintf(user_callback, user_data, "E.setFlags(%j);\n", v);
     jsvUnLock(v);
@@ -739,7 +784,21 @@ void jsiSoftKill() {
     jsvUnLock(events);
     events=0;
   }
+#ifndef ESPR_NO_EVENT_RING
+  // Any events that haven't been executed are just discarded
+  while (jsiEventRingCount) {
+    JsiEvent *e = &jsiEventRing[jsiEventRingStart];
+    if (e->func) jsvUnRefRef(e->func);
+    if (e->thisVar) jsvUnRefRef(e->thisVar);
+    for (int i=0;i<e->argCount;i++)
+      if (e->args[i]) jsvUnRefRef(e->args[i]);
+    jsiEventRingStart = (unsigned char)((jsiEventRingStart+1) % JSI_EVENT_RING_SIZE);
+    jsiEventRingCount--;
+  }
+#endif
   if (timerArray) {
+    // make timers relative to now, so they're still right when we're loaded again
+    jsiTimersRebase();
     jsvUnRefRef(timerArray);
     timerArray=0;
   }
@@ -759,9 +818,10 @@ void jsiSoftKill() {
     jsvUnRef(watchArrayPtr);
     jsvUnLock(watchArrayPtr);
     watchArray=0;
+    jsiWatchesChanged();
   }
   // Save flags if required
-  if (jsFlags)
+  if (jsFlags!=JSF_DEFAULT)
     jsvObjectSetChildAndUnLock(execInfo.hiddenRoot, JSI_JSFLAGS_NAME, jsvNewFromInteger(jsFlags));
 
   // Save initialisation information
@@ -1670,9 +1730,59 @@ void jsiHandleChar(char ch) {
   }
 }
 
+#ifndef ESPR_NO_EVENT_RING
+/// Reference a var so it can be stored in jsiEventRing
+static JsVarRef jsiEventRingRef(JsVar *v) {
+  return v ? jsvGetRef(jsvRef(v)) : 0;
+}
+
+/// Get a var back out of jsiEventRing (skipping names) and remove the reference to it
+static JsVar *jsiEventRingUnRef(JsVarRef ref) {
+  if (!ref) return 0;
+  JsVar *v = jsvLock(ref);
+  jsvUnRef(v);
+  return jsvSkipNameAndUnLock(v);
+}
+
+/// Call 'update' on each var referenced from the event ring, replacing the reference with the result (for GC/defrag)
+void jsiEventRingUpdateRefs(JsVarRef (*update)(JsVarRef ref, void *data), void *data) {
+  for (int n=0;n<jsiEventRingCount;n++) {
+    JsiEvent *e = &jsiEventRing[(jsiEventRingStart+n) % JSI_EVENT_RING_SIZE];
+    if (e->func) e->func = update(e->func, data);
+    if (e->thisVar) e->thisVar = update(e->thisVar, data);
+    for (int i=0;i<e->argCount;i++)
+      if (e->args[i]) e->args[i] = update(e->args[i], data);
+  }
+}
+#endif
+
+/// Are there any events waiting to be executed?
+static bool jsiHasEvents() {
+#ifndef ESPR_NO_EVENT_RING
+  if (jsiEventRingCount) return true;
+#endif
+  return !jsvArrayIsEmpty(events);
+}
+
 /// Queue a function, string, or array (of funcs/strings) to be executed next time around the idle loop
 void jsiQueueEvents(JsVar *object, JsVar *callback, JsVar **args, int argCount) { // an array of functions, a string, or a single function
   assert(argCount<10);
+  jsiEventsQueued++;
+#ifndef ESPR_NO_EVENT_RING
+  if (argCount<=JSI_EVENT_RING_ARGS &&
+      jsiEventRingCount<JSI_EVENT_RING_SIZE &&
+      jsvArrayIsEmpty(events)) {
+    JsiEvent *e = &jsiEventRing[(jsiEventRingStart+jsiEventRingCount) % JSI_EVENT_RING_SIZE];
+    e->func = jsiEventRingRef(callback);
+    e->thisVar = jsiEventRingRef(object);
+    e->argCount = (unsigned char)argCount;
+    for (int i=0;i<argCount;i++)
+      e->args[i] = jsiEventRingRef(args[i]);
+    jsiEventRingCount++;
+    return;
+  }
+#endif
+  jsiEventsOverflowed++;
   JsVar *event = jsvNewObject();
   if (event) { // Could be out of memory error!
     jsvUnLock(jsvAddNamedChild(event, callback, "func"));
@@ -1701,9 +1811,28 @@ void jsiQueueObjectCallbacks(JsVar *object, const char *callbackName, JsVar **ar
 }
 
 void jsiExecuteEvents() {
-  bool hasEvents = !jsvArrayIsEmpty(events);
+  bool hasEvents = jsiHasEvents();
   if (hasEvents) jsiSetBusy(BUSY_INTERACTIVE, true);
-  while (!jsvArrayIsEmpty(events)) {
+  while (jsiHasEvents()) {
+    jsiEventsExecuted++;
+#ifndef ESPR_NO_EVENT_RING
+    /* Everything in the ring was queued before anything in 'events'. Take the
+     * event out before executing it, as the callback may queue more events */
+    if (jsiEventRingCount) {
+      JsiEvent e = jsiEventRing[jsiEventRingStart];
+      jsiEventRingStart = (unsigned char)((jsiEventRingStart+1) % JSI_EVENT_RING_SIZE);
+      jsiEventRingCount--;
+      JsVar *func = jsiEventRingUnRef(e.func);
+      JsVar *thisVar = jsiEventRingUnRef(e.thisVar);
+      JsVar *args[JSI_EVENT_RING_ARGS];
+      for (int i=0;i<e.argCount;i++)
+        args[i] = jsiEventRingUnRef(e.args[i]);
+      jsiExecuteEventCallback(thisVar, func, e.argCount, args);
+      jsvUnLockMany(e.argCount, args);
+      jsvUnLock2(func, thisVar);
+      continue;
+    }
+#endif
     JsVar *event = jsvSkipNameAndUnLock(jsvArrayPopFirst(events));
     // Get function to execute
     JsVar *func = jsvObjectGetChildIfExists(event, "func");
@@ -1818,14 +1947,112 @@ bool jsiHasTimers() {
   return hasTimers;
 }
 
-/// Is the given watch object meant to be executed when the current value of the pin is pinIsHigh
-bool jsiShouldExecuteWatch(JsVar *watchPtr, bool pinIsHigh) {
-  int watchEdge = (int)jsvObjectGetIntegerChild(watchPtr, "edge");
+/// Get the EXTI channel (0..ESPR_EXTI_COUNT-1) that events for the given pin arrive on, or -1
+static int jsiGetWatchChannel(Pin pin) {
+  IOEvent ev;
+  for (int i=0;i<ESPR_EXTI_COUNT;i++) {
+    ev.flags = (IOEventFlags)(EV_EXTI0+i);
+    if (jshIsEventForPin(&ev, pin))
+      return i;
+  }
+  return -1;
+}
+
+/// Copy what we need to check when a pin changes out of the watch with the given name
+static void jsiWatchEntryFill(JsiWatchEntry *w, JsVar *watchName) {
+  JsVar *watchPtr = jsvSkipName(watchName);
+  w->watch = jsvGetRef(watchName);
+  JsVar *callback = jsvObjectGetChildIfExists(watchPtr, "cb");
+  w->callback = callback ? jsvGetRef(callback) : 0;
+  jsvUnLock(callback);
+  w->debounce = jsvObjectGetIntegerChild(watchPtr, "debounce");
+  w->pin = jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(watchPtr, "pin"));
+  JsVarInt edge = jsvObjectGetIntegerChild(watchPtr, "edge");
+  w->edge = (signed char)((edge>0) - (edge<0));
+#ifndef ESPR_NO_WATCH_BATCH
+  w->batch = jsvObjectGetBoolChild(watchPtr, "batch");
+#endif
+  jsvUnLock(watchPtr);
+}
+
+/// Rebuild jsiWatchDispatch if it's out of date
+static void jsiWatchDispatchUpdate() {
+  if (jsiWatchDispatchValid) return;
+  jsiWatchDispatchValid = true;
+  jsiWatchDispatchFull = false;
+  unsigned char counts[ESPR_EXTI_COUNT];
+  memset(counts, 0, sizeof(counts));
+  unsigned int total = 0;
+  JsVar *watchArrayPtr = jsvLock(watchArray);
+  JsvObjectIterator it;
+  // First count how many watches there are for each channel
+  jsvObjectIteratorNew(&it, watchArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *watchPtr = jsvObjectIteratorGetValue(&it);
+    int channel = jsiGetWatchChannel(jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(watchPtr, "pin")));
+    jsvUnLock(watchPtr);
+    if (channel>=0) {
+      counts[channel]++;
+      total++;
+    }
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  // Work out where each channel's watches go
+  unsigned char n = 0;
+  for (int i=0;i<ESPR_EXTI_COUNT;i++) {
+    jsiWatchDispatchStart[i] = n;
+    n = (unsigned char)(n + counts[i]);
+    counts[i] = jsiWatchDispatchStart[i]; // now the next free entry for this channel
+  }
+  jsiWatchDispatchStart[ESPR_EXTI_COUNT] = n;
+  if (total > JSI_WATCH_DISPATCH_SIZE) {
+    jsiWatchDispatchFull = true;
+  } else {
+    // Now fill them in, in the same order as in watchArray
+    jsvObjectIteratorNew(&it, watchArrayPtr);
+    while (jsvObjectIteratorHasValue(&it)) {
+      JsVar *watchName = jsvObjectIteratorGetKey(&it);
+      JsiWatchEntry w;
+      jsiWatchEntryFill(&w, watchName);
+      jsvUnLock(watchName);
+      int channel = jsiGetWatchChannel(w.pin);
+      if (channel>=0) jsiWatchDispatch[counts[channel]++] = w;
+      jsvObjectIteratorNext(&it);
+    }
+    jsvObjectIteratorFree(&it);
+  }
+  jsvUnLock(watchArrayPtr);
+}
+
+/** Work out event time. Events time is only stored in 32 bits, so we need to
+ * use the correct 'high' 32 bits from the current time.
+ *
+ * We know that the current time is always newer than the event time, so
+ * if the bottom 32 bits of the current time is less than the bottom
+ * 32 bits of the event time, we need to subtract a full 32 bits worth
+ * from the current time.
+ */
+static JsSysTime jsiGetEventTime(IOEvent *event) {
+  JsSysTime time = jshGetSystemTime();
+  if (((unsigned int)time) < (unsigned int)event->data.time)
+    time = time - 0x100000000LL;
+  // finally, mask in the event's time
+  return (time & ~0xFFFFFFFFLL) | (JsSysTime)event->data.time;
+}
+
+/// Is a watch with the given edge meant to be executed when the current value of the pin is pinIsHigh
+static bool jsiShouldExecuteWatchEdge(int watchEdge, bool pinIsHigh) {
   return watchEdge==0 || // any edge
       (pinIsHigh && watchEdge>0) || // rising edge
       (!pinIsHigh && watchEdge<0); // falling edge
 }
 
+/// Is the given watch object meant to be executed when the current value of the pin is pinIsHigh
+bool jsiShouldExecuteWatch(JsVar *watchPtr, bool pinIsHigh) {
+  return jsiShouldExecuteWatchEdge((int)jsvObjectGetIntegerChild(watchPtr, "edge"), pinIsHigh);
+}
+
 bool jsiIsWatchingPin(Pin pin) {
   if (jshGetPinShouldStayWatched(pin))
     return true;
@@ -1861,12 +2088,34 @@ static JsVar *jsiExtractIOEventData(IOEvent *event, int *eventsHandled) {
   assert(eventsHandled);
   *eventsHandled = 0;
 
+  /* If there's enough data waiting, allocate a flat string for all of it
+   * and copy each event's characters straight in */
+  IOEventFlags eventType = IOEVENTFLAGS_GETTYPE(event->flags);
+  unsigned int chars = (unsigned int)IOEVENTFLAGS_GETCHARS(event->flags);
+  unsigned int len = chars + jshGetCharsInTopEvents(eventType);
+  if (len > JSV_FLAT_STRING_BREAK_EVEN) {
+    JsVar *stringData = jsvNewFlatStringOfLength(len);
+    if (stringData) {
+      char *ptr = jsvGetFlatStringPointer(stringData);
+      memcpy(ptr, event->data.chars, chars);
+      unsigned int idx = chars;
+      while (idx<len && jshPopIOEvent(event)) {
+        (*eventsHandled)++;
+        chars = (unsigned int)IOEVENTFLAGS_GETCHARS(event->flags);
+        assert(IOEVENTFLAGS_GETTYPE(event->flags)==eventType && idx+chars<=len);
+        memcpy(&ptr[idx], event->data.chars, chars);
+        idx += chars;
+      }
+      return stringData;
+    }
+  }
+
   JsVar *stringData = jsvNewFromEmptyString();
   if (stringData) {
     JsvStringIterator it;
     jsvStringIteratorNew(&it, stringData, 0);
 
-    int i, chars = IOEVENTFLAGS_GETCHARS(event->flags);
+    unsigned int i;
     while (chars) {
       for (i=0;i<chars;i++) {
         jsvStringIteratorAppend(&it, event->data.chars[i]);
@@ -1875,7 +2124,7 @@ static JsVar *jsiExtractIOEventData(IOEvent *event, int *eventsHandled) {
       if (jshIsTopEvent(IOEVENTFLAGS_GETTYPE(event->flags))) {
         jshPopIOEvent(event);
         (*eventsHandled)++;
-        chars = IOEVENTFLAGS_GETCHARS(event->flags);
+        chars = (unsigned int)IOEVENTFLAGS_GETCHARS(event->flags);
       } else
         chars = 0;
     }
@@ -1905,6 +2154,144 @@ void jsiHandleIOEventForConsole(IOEvent *event) {
   jsiSetBusy(BUSY_INTERACTIVE, false);
 }
 
+/** Handle a pin change event for the watch 'w', whose name in watchArray is
+ * 'watchName' (locked by the caller, so it can't be freed even if an earlier
+ * callback for the same event removed it). Up to 'maxExtraEvents' more events
+ * for the same EXTI channel can be taken from the queue for a batch (this
+ * should be 0 if anything else is watching it). Returns the number taken. */
+static int jsiHandleWatchEvent(JsVar *watchArrayPtr, JsVar *watchName, JsiWatchEntry *w, IOEvent *event, int maxExtraEvents) {
+  if (!jsvGetRefs(watchName)) return 0; // no longer in watchArray
+  int eventsHandled = 0;
+  IOEventFlags eventType = IOEVENTFLAGS_GETTYPE(event->flags);
+  JsVar *watchPtr = jsvSkipName(watchName);
+  Pin pin = w->pin;
+  JsSysTime eventTime = jsiGetEventTime(event);
+
+  // Now actually process the event
+  bool pinIsHigh = (event->flags&EV_EXTI_IS_HIGH)!=0;
+
+  bool executeNow = false;
+  JsVarInt debounce = w->debounce;
+  if (debounce<=0) {
+    executeNow = true;
+  } else { // Debouncing - use timeouts to ensure we only fire at the right time
+    // store the current state of the pin
+    bool oldWatchState = jsvObjectGetBoolChild(watchPtr, "state");
+    JsVar *timeout = jsvObjectGetChildIfExists(watchPtr, "timeout");
+    if (timeout) { // if we had a timeout, update the callback time
+      JsSysTime timeoutTime = jsiTimerBaseTime + jsiTimerGetTime(timeout);
+      jsvUnLock(jsvObjectSetChild(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiTimerBaseTime) + debounce)));
+      jsiTimersChanged();
+      jsvObjectSetChildAndUnLock(timeout, "state", jsvNewFromBool(pinIsHigh));
+      if (eventTime > timeoutTime && pinIsHigh!=oldWatchState) {
+        // timeout should have fired, but we didn't get around to executing it!
+        // Do it now (with the old timeout time)
+        executeNow = true;
+        eventTime = timeoutTime - debounce;
+        jsvObjectSetChildAndUnLock(watchPtr, "state", jsvNewFromBool(pinIsHigh));
+        // Remove the timeout
+        JsVar *idArr = jsvNewArray(&timeout, 1);
+        jswrap_interface_clearTimeout(idArr);
+        jsvUnLock(idArr);
+        jsvObjectRemoveChild(watchPtr, "timeout");
+      }
+    } else if (pinIsHigh!=oldWatchState) { // else create a new timeout
+      timeout = jsvNewObject();
+      if (timeout) {
+        jsvObjectSetChild(timeout, "watch", watchPtr); // no unlock
+        jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiTimerBaseTime) + debounce));
+        jsvObjectSetChildAndUnLock(timeout, "cb", jsvObjectGetChildIfExists(watchPtr, "cb"));
+        jsvObjectSetChildAndUnLock(timeout, "lastTime", jsvObjectGetChildIfExists(watchPtr, "lastTime"));
+        jsvObjectSetChildAndUnLock(timeout, "pin", jsvNewFromPin(pin));
+        jsvObjectSetChildAndUnLock(timeout, "state", jsvNewFromBool(pinIsHigh));
+        // Add to timer array
+        jsiTimerAdd(timeout);
+        // Add to our watch
+        jsvObjectSetChild(watchPtr, "timeout", timeout); // no unlock
+      }
+    }
+    jsvUnLock(timeout);
+  }
+
+  // If we want to execute this watch right now...
+  if (executeNow) {
+    JsVarFloat time = jshGetMillisecondsFromTime(eventTime)/1000;
+    bool shouldExecute = jsiShouldExecuteWatchEdge(w->edge, pinIsHigh); // edge triggering
+    JsVar *batchTimes = 0;
+#ifndef ESPR_NO_WATCH_BATCH
+    if (w->batch && debounce<=0) {
+      /* If nothing else is watching this EXTI, take any more edges for
+       * it that are next in the queue so they all go to one callback. Not
+       * done when debouncing, as each edge has to go through the timeout above */
+      JsVarFloat times[JSI_WATCH_BATCH_MAX];
+      int timeCount = 0;
+      if (shouldExecute) times[timeCount++] = time;
+      while (eventsHandled<maxExtraEvents && timeCount<JSI_WATCH_BATCH_MAX &&
+             jshIsTopEvent(eventType) && jshPopIOEvent(event)) {
+        eventsHandled++;
+        bool isHigh = (event->flags&EV_EXTI_IS_HIGH)!=0;
+        time = jshGetMillisecondsFromTime(jsiGetEventTime(event))/1000;
+        if (jsiShouldExecuteWatchEdge(w->edge, isHigh)) {
+          times[timeCount++] = time;
+          pinIsHigh = isHigh;
+          shouldExecute = true;
+        }
+      }
+      if (shouldExecute) {
+        batchTimes = jsvNewTypedArray(ARRAYBUFFERVIEW_FLOAT64, timeCount);
+        if (batchTimes) {
+          JsvArrayBufferIterator ait;
+          jsvArrayBufferIteratorNew(&ait, batchTimes, 0);
+          for (int i=0;i<timeCount;i++) {
+            JsVar *t = jsvNewFromFloat(times[i]);
+            jsvArrayBufferIteratorSetValue(&ait, t, false);
+            jsvUnLock(t);
+            jsvArrayBufferIteratorNext(&ait);
+          }
+          jsvArrayBufferIteratorFree(&ait);
+        }
+      }
+    }
+#else
+    NOT_USED(maxExtraEvents);
+#endif
+    JsVar *timePtr = jsvNewFromFloat(time);
+    if (shouldExecute) {
+      JsVar *watchCallback = jsvLockSafe(w->callback);
+      bool watchRecurring = jsvObjectGetBoolChild(watchPtr,  "recur");
+      JsVar *data = jsvNewObject();
+      if (data) {
+        jsvObjectSetChildAndUnLock(data, "state", jsvNewFromBool(pinIsHigh));
+        jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChildIfExists(watchPtr, "lastTime"));
+        // set both data.time, and watch.lastTime in one go
+        jsvObjectSetChild(data, "time", batchTimes ? batchTimes : timePtr); // no unlock
+        jsvObjectSetChildAndUnLock(data, "pin", jsvNewFromPin(pin));
+        Pin dataPin = jshGetEventDataPin(eventType);
+        if (jshIsPinValid(dataPin))
+          jsvObjectSetChildAndUnLock(data, "data", jsvNewFromBool((event->flags&EV_EXTI_DATA_PIN_HIGH)!=0));
+      }
+      if (!jsiExecuteEventCallback(0, watchCallback, 1, &data) && watchRecurring) {
+        jsError("Ctrl-C while processing watch - removing it.");
+        jsErrorFlags |= JSERR_CALLBACK;
+        watchRecurring = false;
+      }
+      jsvUnLock(data);
+      if (!watchRecurring) {
+        // free all
+        jsvRemoveChild(watchArrayPtr, watchName);
+        jsiWatchesChanged();
+        if (!jsiIsWatchingPin(pin))
+          jshPinWatch(pin, false, JSPW_NONE);
+      }
+      jsvUnLock(watchCallback);
+    }
+    jsvUnLock(batchTimes);
+    jsvObjectSetChildAndUnLock(watchPtr, "lastTime", timePtr);
+  }
+  jsvUnLock(watchPtr);
+  return eventsHandled;
+}
+
 void jsiIdle() {
   // This is how many times we have been here and not done anything.
   // It will be zeroed if we do stuff later
@@ -1974,116 +2361,53 @@ void jsiIdle() {
 #endif
     } else if (DEVICE_IS_EXTI(eventType)) { // ---------------------------------------------------------------- PIN WATCH
       // we have an event... find out what it was for...
-      // Check everything in our Watch array
+      jsiWatchDispatchUpdate();
       JsVar *watchArrayPtr = jsvLock(watchArray);
-      JsvObjectIterator it;
-      jsvObjectIteratorNew(&it, watchArrayPtr);
-      while (jsvObjectIteratorHasValue(&it)) {
-        bool hasDeletedWatch = false;
-        JsVar *watchPtr = jsvObjectIteratorGetValue(&it);
-        Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(watchPtr, "pin"));
-
-        if (jshIsEventForPin(&event, pin)) {
-          /** Work out event time. Events time is only stored in 32 bits, so we need to
-           * use the correct 'high' 32 bits from the current time.
-           *
-           * We know that the current time is always newer than the event time, so
-           * if the bottom 32 bits of the current time is less than the bottom
-           * 32 bits of the event time, we need to subtract a full 32 bits worth
-           * from the current time.
-           */
-          JsSysTime time = jshGetSystemTime();
-          if (((unsigned int)time) < (unsigned int)event.data.time)
-            time = time - 0x100000000LL;
-          // finally, mask in the event's time
-          JsSysTime eventTime = (time & ~0xFFFFFFFFLL) | (JsSysTime)event.data.time;
-
-          // Now actually process the event
-          bool pinIsHigh = (event.flags&EV_EXTI_IS_HIGH)!=0;
-
-          bool executeNow = false;
-          JsVarInt debounce = jsvObjectGetIntegerChild(watchPtr, "debounce");
-          if (debounce<=0) {
-            executeNow = true;
-          } else { // Debouncing - use timeouts to ensure we only fire at the right time
-            // store the current state of the pin
-            bool oldWatchState = jsvObjectGetBoolChild(watchPtr, "state");
-            JsVar *timeout = jsvObjectGetChildIfExists(watchPtr, "timeout");
-            if (timeout) { // if we had a timeout, update the callback time
-              JsSysTime timeoutTime = jsiLastIdleTime + (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChildIfExists(timeout, "time"));
-              jsvUnLock(jsvObjectSetChild(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce)));
-              jsvObjectSetChildAndUnLock(timeout, "state", jsvNewFromBool(pinIsHigh));
-              if (eventTime > timeoutTime && pinIsHigh!=oldWatchState) {
-                // timeout should have fired, but we didn't get around to executing it!
-                // Do it now (with the old timeout time)
-                executeNow = true;
-                eventTime = timeoutTime - debounce;
-                jsvObjectSetChildAndUnLock(watchPtr, "state", jsvNewFromBool(pinIsHigh));
-                // Remove the timeout
-                JsVar *idArr = jsvNewArray(&timeout, 1);
-                jswrap_interface_clearTimeout(idArr);
-                jsvUnLock(idArr);
-                jsvObjectRemoveChild(watchPtr, "timeout");
-              }
-            } else if (pinIsHigh!=oldWatchState) { // else create a new timeout
-              timeout = jsvNewObject();
-              if (timeout) {
-                jsvObjectSetChild(timeout, "watch", watchPtr); // no unlock
-                jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce));
-                jsvObjectSetChildAndUnLock(timeout, "cb", jsvObjectGetChildIfExists(watchPtr, "cb"));
-                jsvObjectSetChildAndUnLock(timeout, "lastTime", jsvObjectGetChildIfExists(watchPtr, "lastTime"));
-                jsvObjectSetChildAndUnLock(timeout, "pin", jsvNewFromPin(pin));
-                jsvObjectSetChildAndUnLock(timeout, "state", jsvNewFromBool(pinIsHigh));
-                // Add to timer array
-                jsiTimerAdd(timeout);
-                // Add to our watch
-                jsvObjectSetChild(watchPtr, "timeout", timeout); // no unlock
-              }
-            }
-            jsvUnLock(timeout);
-          }
-
-          // If we want to execute this watch right now...
-          if (executeNow) {
-            JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(eventTime)/1000);
-            if (jsiShouldExecuteWatch(watchPtr, pinIsHigh)) { // edge triggering
-              JsVar *watchCallback = jsvObjectGetChildIfExists(watchPtr, "cb");
-              bool watchRecurring = jsvObjectGetBoolChild(watchPtr,  "recur");
-              JsVar *data = jsvNewObject();
-              if (data) {
-                jsvObjectSetChildAndUnLock(data, "state", jsvNewFromBool(pinIsHigh));
-                jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChildIfExists(watchPtr, "lastTime"));
-                // set both data.time, and watch.lastTime in one go
-                jsvObjectSetChild(data, "time", timePtr); // no unlock
-                jsvObjectSetChildAndUnLock(data, "pin", jsvNewFromPin(pin));
-                Pin dataPin = jshGetEventDataPin(eventType);
-                if (jshIsPinValid(dataPin))
-                  jsvObjectSetChildAndUnLock(data, "data", jsvNewFromBool((event.flags&EV_EXTI_DATA_PIN_HIGH)!=0));
-              }
-              if (!jsiExecuteEventCallback(0, watchCallback, 1, &data) && watchRecurring) {
-                jsError("Ctrl-C while processing watch - removing it.");
-                jsErrorFlags |= JSERR_CALLBACK;
-                watchRecurring = false;
-              }
-              jsvUnLock(data);
-              if (!watchRecurring) {
-                // free all
-                jsvObjectIteratorRemoveAndGotoNext(&it, watchArrayPtr);
-                hasDeletedWatch = true;
-                if (!jsiIsWatchingPin(pin))
-                  jshPinWatch(pin, false, JSPW_NONE);
-              }
-              jsvUnLock(watchCallback);
-            }
-            jsvObjectSetChildAndUnLock(watchPtr, "lastTime", timePtr);
-          }
+      if (!jsiWatchDispatchFull) {
+        // Go straight to the watches for this EXTI channel
+        int channel = eventType - EV_EXTI0;
+        int first = jsiWatchDispatchStart[channel];
+        int count = jsiWatchDispatchStart[channel+1] - first;
+        /* Callbacks can add, remove, or (with E.defrag) move watches, so copy
+         * the entries and lock the watches before we execute any of them */
+        JsiWatchEntry *watches = (JsiWatchEntry*)alloca(sizeof(JsiWatchEntry)*(size_t)count);
+        JsVar **watchNames = (JsVar**)alloca(sizeof(JsVar*)*(size_t)count);
+        for (int i=0;i<count;i++) {
+          watches[i] = jsiWatchDispatch[first+i];
+          watchNames[i] = jsvLock(watches[i].watch);
         }
-
-        jsvUnLock(watchPtr);
-        if (!hasDeletedWatch)
+        for (int i=0;i<count;i++) {
+          // if an earlier callback changed the watches, our copy could be out of date
+          if (!jsiWatchDispatchValid && jsvGetRefs(watchNames[i]))
+            jsiWatchEntryFill(&watches[i], watchNames[i]);
+          maxEvents -= jsiHandleWatchEvent(watchArrayPtr, watchNames[i], &watches[i], &event, count==1 ? maxEvents : 0);
+        }
+        jsvUnLockMany((unsigned int)count, watchNames);
+      } else {
+        // Too many watches to fit in jsiWatchDispatch - check every watch
+        int count = 0;
+        JsvObjectIterator it;
+        jsvObjectIteratorNew(&it, watchArrayPtr);
+        while (jsvObjectIteratorHasValue(&it)) {
+          JsVar *watchPtr = jsvObjectIteratorGetValue(&it);
+          if (jshIsEventForPin(&event, jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(watchPtr, "pin"))))
+            count++;
+          jsvUnLock(watchPtr);
           jsvObjectIteratorNext(&it);
+        }
+        jsvObjectIteratorFree(&it);
+        jsvObjectIteratorNew(&it, watchArrayPtr);
+        while (jsvObjectIteratorHasValue(&it)) {
+          JsVar *watchName = jsvObjectIteratorGetKey(&it);
+          jsvObjectIteratorNext(&it); // move on first, as the callback may remove this watch
+          JsiWatchEntry w;
+          jsiWatchEntryFill(&w, watchName);
+          if (jshIsEventForPin(&event, w.pin))
+            maxEvents -= jsiHandleWatchEvent(watchArrayPtr, watchName, &w, &event, count==1 ? maxEvents : 0);
+          jsvUnLock(watchName);
+        }
+        jsvObjectIteratorFree(&it);
       }
-      jsvObjectIteratorFree(&it);
       jsvUnLock(watchArrayPtr);
     }
   }
@@ -2096,38 +2420,38 @@ void jsiIdle() {
   // Check timers
   JsSysTime minTimeUntilNext = JSSYSTIME_MAX;
   JsSysTime time = jshGetSystemTime();
-  JsSysTime timePassed = time - jsiLastIdleTime;
-  jsiLastIdleTime = time;
 #ifndef EMBEDDED
+  JsSysTime timePassed = time - jsiLastIdleTime;
   // add time to Ctrl-C counter, checking for overflow
   uint32_t oldTimeSinceCtrlC = jsiTimeSinceCtrlC;
   jsiTimeSinceCtrlC += (uint32_t)timePassed;
   if (oldTimeSinceCtrlC > jsiTimeSinceCtrlC)
     jsiTimeSinceCtrlC = 0xFFFFFFFF;
 #endif
+  jsiLastIdleTime = time;
 
+  /* Timers store the time they're due relative to jsiTimerBaseTime, so we don't
+   * have to update every timer each time around the loop. We also remember when
+   * the next one is due, so unless timers have changed we only go through them
+   * when one needs executing. */
   JsVar *timerArrayPtr = jsvLock(timerArray);
+  if (jsvArrayIsEmpty(timerArrayPtr)) {
+    jsiTimerBaseTime = jsiLastIdleTime;
+    jsiTimerNextTime = JSSYSTIME_MAX;
+  } else if (jsiLastIdleTime - jsiTimerBaseTime > JSI_TIMER_REBASE_TIME)
+    jsiTimersRebase();
+  JsSysTime timeNow = jsiLastIdleTime - jsiTimerBaseTime;
   JsvObjectIterator it;
-  // Go through all intervals and decrement time
-  jsvObjectIteratorNew(&it, timerArrayPtr);
-  while (jsvObjectIteratorHasValue(&it)) {
-    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
-    JsSysTime timerTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChildIfExists(timerPtr, "time"));
-    JsSysTime timeUntilNext = timerTime - timePassed;
-    jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(timeUntilNext));
-    jsvUnLock(timerPtr);
-    jsvObjectIteratorNext(&it);
-  }
-  jsvObjectIteratorFree(&it);
   // Now go through intervals and execute if needed
-  do {
+  if ((jsiStatus & JSIS_TIMERS_CHANGED) || timeNow >= jsiTimerNextTime) do {
     jsiStatus = jsiStatus & ~JSIS_TIMERS_CHANGED;
+    jsiTimerNextTime = JSSYSTIME_MAX;
     jsvObjectIteratorNew(&it, timerArrayPtr);
     while (jsvObjectIteratorHasValue(&it) && !(jsiStatus & JSIS_TIMERS_CHANGED)) {
       bool hasDeletedTimer = false;
       JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
-      JsSysTime timerTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChildIfExists(timerPtr, "time"));
-      if (timerTime<=0) {
+      JsSysTime timerTime = jsiTimerGetTime(timerPtr);
+      if (timerTime<=timeNow) {
         // we're now doing work
         jsiSetBusy(BUSY_INTERACTIVE, true);
         wasBusy = true;
@@ -2143,7 +2467,7 @@ void jsiIdle() {
           if (watchState!=timerState) {
             // Create the 'time' variable that will be passed to the user and stored as last time
             JsVarInt delay = jsvObjectGetIntegerChild(watchPtr, "debounce");
-            JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(jsiLastIdleTime+timerTime-delay)/1000);
+            JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(jsiTimerBaseTime+timerTime-delay)/1000);
             // If it's the right edge...
             if (jsiShouldExecuteWatch(watchPtr, timerState)) {
               data = jsvNewObject();
@@ -2194,6 +2518,7 @@ void jsiIdle() {
               JsVar *watchNamePtr = jsvGetIndexOf(watchArrayPtr, watchPtr, true);
               if (watchNamePtr) {
                 jsvRemoveChildAndUnLock(watchArrayPtr, watchNamePtr);
+                jsiWatchesChanged();
               }
               jsvUnLock(watchArrayPtr);
               Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(watchPtr, "pin"));
@@ -2213,13 +2538,12 @@ void jsiIdle() {
           // Beware... may have already been removed!
           jsvObjectIteratorRemoveAndGotoNext(&it, timerArrayPtr);
           hasDeletedTimer = true;
-          timerTime = -1;
         }
         jsvUnLock2(timerCallback,interval);
       }
-      // update the time until the next timer
-      if (timerTime>=0 && timerTime < minTimeUntilNext)
-        minTimeUntilNext = timerTime;
+      // update the time the next timer is due
+      if (!hasDeletedTimer && timerTime < jsiTimerNextTime)
+        jsiTimerNextTime = timerTime;
       // update the timer's time
       if (!hasDeletedTimer)
         jsvObjectIteratorNext(&it);
@@ -2228,6 +2552,8 @@ void jsiIdle() {
     jsvObjectIteratorFree(&it);
   } while (jsiStatus & JSIS_TIMERS_CHANGED);
   jsvUnLock(timerArrayPtr);
+  if (jsiTimerNextTime != JSSYSTIME_MAX)
+    minTimeUntilNext = (jsiTimerNextTime > timeNow) ? jsiTimerNextTime - timeNow : 0;
   /* We might have left the timers loop with stuff to do because the contents of it
    * changed. It's not a big deal because it could only have changed because a timer
    * got executed - so `wasBusy` got set and we know we're going to go around the
@@ -2238,7 +2564,7 @@ void jsiIdle() {
   if (jswIdle()) wasBusy = true;
 
   // Just in case we got any events to do and didn't clear loopsIdling before
-  if (wasBusy || !jsvArrayIsEmpty(events) )
+  if (wasBusy || jsiHasEvents())
     loopsIdling = 0;
 
   if (wasBusy)
@@ -2311,17 +2637,41 @@ void jsiIdle() {
   /* if we've been around this loop, there is nothing to do, and
    * we have a spare 10ms then let's do some Garbage Collection
    * if we think we need to */
+#ifndef ESPR_NO_INCREMENTAL_GC
+  /* This is done a step at a time, so any events that come in
+   * don't have to wait for all of memory to be scanned */
+  if (loopsIdling>=1 &&
+      minTimeUntilNext > jshGetTimeFromMilliseconds(10) &&
+      (jsvGarbageCollectInProgress() ||
+       (loopsIdling==1 && !jsvMoreFreeVariablesThan(JS_VARS_BEFORE_IDLE_GC)))) {
+    jsiSetBusy(BUSY_INTERACTIVE, true);
+    jsvGarbageCollectStep(JS_IDLE_GC_STEP_BLOCKS);
+    jsiSetBusy(BUSY_INTERACTIVE, false);
+#else
   if (loopsIdling==1 &&
       minTimeUntilNext > jshGetTimeFromMilliseconds(10) &&
       !jsvMoreFreeVariablesThan(JS_VARS_BEFORE_IDLE_GC)) {
     jsiSetBusy(BUSY_INTERACTIVE, true);
     jsvGarbageCollect();
     jsiSetBusy(BUSY_INTERACTIVE, false);
+#endif
     /* Return here so we run around the idle loop again
      * and check whether any events came in during GC. If not
      * then we'll sleep. */
     return;
   }
+#ifndef ESPR_NO_NURSERY
+  /* If lots of vars survived in the nursery while we were busy, move them
+   * out so it's free for short-lived vars next time */
+  if (jsfGetFlag(JSF_NURSERY) &&
+      loopsIdling==1 &&
+      minTimeUntilNext > jshGetTimeFromMilliseconds(10)) {
+    jsiSetBusy(BUSY_INTERACTIVE, true);
+    bool moved = jsvNurseryCollect();
+    jsiSetBusy(BUSY_INTERACTIVE, false);
+    if (moved) return;
+  }
+#endif
 
   // Go to sleep!
   if (loopsIdling>=1 && // once around the idle loop without having done any work already (just in case)
@@ -2446,7 +2796,7 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data) {
     JsVar *timerInterval = jsvObjectGetChildIfExists(timer, "intr");
     user_callback(timerInterval ? "setInterval(" : "setTimeout(", user_data);
     jsiDumpJSON(user_callback, user_data, timerCallback, 0);
-    cbprintf(user_callback, user_data, ", %f); // %v\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : jsvGetLongIntegerAndUnLock(jsvObjectGetChildIfExists(timer, "time"))), timerNumber);
+    cbprintf(user_callback, user_data, ", %f); // %v\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : (jsiTimerGetTime(timer) - (jsiLastIdleTime - jsiTimerBaseTime))), timerNumber);
     jsvUnLock3(timerInterval, timerCallback, timerNumber);
     // next
     jsvUnLock(timer);
@@ -2495,13 +2845,49 @@ JsVarInt jsiTimerAdd(JsVar *timerPtr) {
   JsVar *timerArrayPtr = jsvLock(timerArray);
   JsVarInt itemIndex = jsvArrayAddToEnd(timerArrayPtr, timerPtr, 1) - 1;
   jsvUnLock(timerArrayPtr);
+  jsiTimersChanged();
   return itemIndex;
 }
 
+/// Get the time a timer is due (relative to jsiTimerBaseTime) - without allocating a var if it's stored in the name
+JsSysTime jsiTimerGetTime(JsVar *timerPtr) {
+  JsVar *v = jsvFindChildFromString(timerPtr, "time");
+  if (jsvIsNameInt(v)) {
+    JsVarInt t = jsvGetFirstChildSigned(v);
+    jsvUnLock(v);
+    return t;
+  }
+  return (JsSysTime)jsvGetLongIntegerAndUnLock(jsvSkipNameAndUnLock(v));
+}
+
+/// Make all timers relative to jsiLastIdleTime, so the values stored in them don't get too big
+void jsiTimersRebase() {
+  JsSysTime offset = jsiLastIdleTime - jsiTimerBaseTime;
+  jsiTimerBaseTime = jsiLastIdleTime;
+  if (jsiTimerNextTime != JSSYSTIME_MAX)
+    jsiTimerNextTime -= offset;
+  if (!offset || !timerArray) return;
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
+    jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(jsiTimerGetTime(timerPtr) - offset));
+    jsvUnLock(timerPtr);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(timerArrayPtr);
+}
+
 void jsiTimersChanged() {
   jsiStatus |= JSIS_TIMERS_CHANGED;
 }
 
+void jsiWatchesChanged() {
+  jsiWatchDispatchValid = false;
+}
+
 #ifdef USE_DEBUGGER
 void jsiDebuggerLoop() {
   // exit if:
@@ -49,6 +49,15 @@ void jsiCtrlC(); // Ctrl-C - force interrupt of execution
 
 /// Queue a function, string, or array (of funcs/strings) to be executed next time around the idle loop
 void jsiQueueEvents(JsVar *object, JsVar *callback, JsVar **args, int argCount);
+extern uint32_t jsiEventsQueued; ///< How many events have been queued with jsiQueueEvents
+extern uint32_t jsiEventsOverflowed; ///< How many events have had to be queued in the events array (allocating vars)
+extern uint32_t jsiEventsExecuted; ///< How many events have been taken off the queue by jsiExecuteEvents
+#ifndef ESPR_NO_EVENT_RING
+#define JSI_EVENT_RING_SIZE 16 ///< How many events can be queued without allocating any vars
+#define JSI_EVENT_RING_ARGS 3  ///< Events with more arguments than this always allocate vars
+/// Call 'update' on each var referenced from the event ring, replacing the reference with the result (for GC/defrag)
+void jsiEventRingUpdateRefs(JsVarRef (*update)(JsVarRef ref, void *data), void *data);
+#endif
 /// Return true if the object has callbacks...
 bool jsiObjectHasCallbacks(JsVar *object, const char *callbackName);
 /// Queue up callbacks for other things (touchscreen? network?)
@@ -177,6 +186,7 @@ extern Pin pinBusyIndicator;
 extern Pin pinSleepIndicator;
 #endif
 extern JsSysTime jsiLastIdleTime; ///< The last time we went around the idle loop - use this for timers
+extern JsSysTime jsiTimerBaseTime; ///< The 'time' of each timer is relative to this
 
 void jsiDumpJSON(vcbprintf_callback user_callback, void *user_data, JsVar *data, JsVar *existing);
 void jsiDumpState(vcbprintf_callback user_callback, void *user_data);
@@ -187,6 +197,18 @@ extern JsVarRef watchArray; // Linked List of input watches to check and run
 
 extern JsVarInt jsiTimerAdd(JsVar *timerPtr);
 extern void jsiTimersChanged(); // Flag timers changed so we can skip out of the loop if needed
+extern JsSysTime jsiTimerGetTime(JsVar *timerPtr); // Get the time a timer is due, relative to jsiTimerBaseTime
+extern void jsiTimersRebase(); // Make all timers relative to jsiLastIdleTime
+#ifndef ESPR_NO_WATCH_BATCH
+#define JSI_WATCH_BATCH_MAX 16 ///< The most edges a setWatch with batch:true will pass to one callback
+#endif
+#ifdef SAVE_ON_FLASH
+#define JSI_WATCH_DISPATCH_SIZE 8 ///< How many watches the per-pin dispatch table holds (if there are more, every watch is checked)
+#else
+#define JSI_WATCH_DISPATCH_SIZE 16 ///< How many watches the per-pin dispatch table holds (if there are more, every watch is checked)
+#endif
+extern void jsiWatchesChanged(); // Flag watches added/removed/moved so the per-pin dispatch table is rebuilt
+#define JSI_TIMER_REBASE_TIME 0x3FFFFFFF // Rebase timers once jsiTimerBaseTime is this far behind, so their times still fit in an int
 // end for jswrap_interactive/io.c ------------------------------------------------
 
 #ifdef USE_DEBUGGER
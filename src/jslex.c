@@ -611,10 +611,35 @@ static void jslGetRawString() {
   jslGetNextCh(); // ensure we're all set up with next char (might be able to optimise slightly, but this is safe)
 }
 
+/// Pretokenised integers are stored as binary - turn them back into a LEX_INT
+static void jslGetRawInt() {
+  assert(lex->tk >= LEX_RAW_INT0 && lex->tk <= LEX_RAW_INT16);
+  int value = 0;
+  if (lex->tk != LEX_RAW_INT0) {
+    value = (unsigned char)lex->currCh;
+    jslGetNextCh();
+    if (lex->tk == LEX_RAW_INT16) {
+      value |= ((unsigned char)lex->currCh)<<8;
+      jslGetNextCh();
+    }
+  }
+  lex->tk = LEX_INT;
+  lex->tokenRawInt = value; // jspeFactor uses this directly, the text is only made if needed
+}
+
+/// If we have a LEX_INT from pretokenised code, fill in the token's text
+static void jslGetRawIntToken() {
+  if (lex->tokenRawInt>=0 && !lex->tokenl) {
+    itostr(lex->tokenRawInt, lex->token, 10);
+    lex->tokenl = (unsigned char)strlen(lex->token);
+  }
+}
+
 void jslGetNextToken() {
   int lastToken = lex->tk;
   lex->tk = LEX_EOF;
   lex->tokenl = 0; // clear token string
+  lex->tokenRawInt = -1;
   if (lex->tokenValue) {
     jsvUnLock(lex->tokenValue);
     lex->tokenValue = 0;
@@ -640,7 +665,10 @@ void jslGetNextToken() {
     case JSLJT_SINGLE_CHAR:
       jslSingleChar();
       if (lex->tk == LEX_R_THIS) lex->hadThisKeyword=true;
-      else if (lex->tk == LEX_RAW_STRING8 || lex->tk == LEX_RAW_STRING16) jslGetRawString();
+      else if (lex->tk >= LEX_RAW_STRING8 && lex->tk <= LEX_RAW_INT16) {
+        if (lex->tk <= LEX_RAW_STRING16) jslGetRawString();
+        else jslGetRawInt();
+      }
       break;
     case JSLJT_ID: {
       while (isAlphaInline(lex->currCh) || isNumericInline(lex->currCh) || lex->currCh=='$') {
@@ -920,6 +948,7 @@ void jslInit(JsVar *var) {
   lex->tokenStart = 0;
   lex->tokenLastStart = 0;
   lex->tokenl = 0;
+  lex->tokenRawInt = -1;
   lex->tokenValue = 0;
 #ifndef ESPR_NO_LINE_NUMBERS
   lex->lineNumberOffset = 0;
@@ -1109,6 +1138,7 @@ void jslGetTokenString(char *str, size_t len) {
 }
 
 char *jslGetTokenValueAsString() {
+  jslGetRawIntToken();
   assert(lex->tokenl < JSLEX_MAX_TOKEN_LENGTH);
   lex->token[lex->tokenl]  = 0; // add final null
   if (lex->tokenl==0 && LEX_IS_RESERVED_WORD(lex->tk)) {
@@ -1124,6 +1154,7 @@ char *jslGetTokenValueAsString() {
 size_t jslGetTokenLength() {
   if (lex->tokenValue)
     return jsvGetStringLength(lex->tokenValue);
+  jslGetRawIntToken();
   return (size_t)lex->tokenl;
 }
 
@@ -1134,6 +1165,7 @@ JsVar *jslGetTokenValueAsVar() {
     // in pretokenised code, we must make this up
     return jsvNewFromString(jslReservedWordAsString(lex->tk));
   } else {
+    jslGetRawIntToken();
     assert(lex->tokenl < JSLEX_MAX_TOKEN_LENGTH);
     lex->token[lex->tokenl]  = 0; // add final null
     return jsvNewFromString(lex->token);
@@ -1195,6 +1227,7 @@ static size_t _jslNewTokenisedStringFromLexer(JsvStringIterator *dstit, JsVar *d
   size_t length = 0;
   int lastTk = LEX_EOF;
   int atobChecker = 0; // we increment this to see if we've got the `atob("...")` pattern. 0=nothing, 2='atob('
+  long long intValue;
   while (lex->tk!=LEX_EOF && jsvStringIteratorGetIndex(&lex->it)<=charTo+1) {
     if (jslPreserveSpaceBetweenTokens(lastTk, lex->tk)) {
       length++;
@@ -1236,6 +1269,16 @@ static size_t _jslNewTokenisedStringFromLexer(JsvStringIterator *dstit, JsVar *d
       }
       jsvUnLock(v);
       length += ((l<256)?2:3) + l;
+    } else if (lex->tk==LEX_INT && lex->tokenl<6 && // only plain decimal, so toString returns what was written
+               (lex->tokenl==1 || lex->token[0]!='0') &&
+               (intValue = stringToInt(jslGetTokenValueAsString()))>=0 && intValue<65536) { // ---------------------- token = integer we can store as raw binary
+      atobChecker = 0;
+      if (dstit) {
+        jsvStringIteratorSetCharAndNext(dstit, (char)((intValue==0) ? LEX_RAW_INT0 : ((intValue<256) ? LEX_RAW_INT8 : LEX_RAW_INT16)));
+        if (intValue!=0) jsvStringIteratorSetCharAndNext(dstit, (char)(intValue&255));
+        if (intValue>=256) jsvStringIteratorSetCharAndNext(dstit, (char)(intValue>>8));
+      }
+      length += (intValue==0) ? 1 : ((intValue<256) ? 2 : 3);
     } else if (lex->tk==LEX_ID || // ---------------------------------  token = string of chars
         lex->tk==LEX_INT ||
         lex->tk==LEX_FLOAT ||
@@ -1408,6 +1451,29 @@ static void jslPrintTokenisedChar(JsvStringIterator *it, unsigned char *lastch,
     user_callback("\"", user_data);
     return;
   }
+  // Decoding raw integers
+  if (ch>=LEX_RAW_INT0 && ch<=LEX_RAW_INT16) {
+    int value = 0;
+    if (ch!=LEX_RAW_INT0) {
+      (*chars)++;
+      value = (unsigned char)jsvStringIteratorGetCharAndNext(it);
+      if (ch==LEX_RAW_INT16) {
+        (*chars)++;
+        value |= ((unsigned char)jsvStringIteratorGetCharAndNext(it))<<8;
+      }
+    }
+    (*chars)++; // token
+    if (jslNeedSpaceBetween(*lastch, '0')) {
+      (*col)++;
+      user_callback(" ", user_data);
+    }
+    char buf[8];
+    itostr(value, buf, 10);
+    (*col) += strlen(buf)-1;
+    user_callback(buf, user_data);
+    *lastch = '0';
+    return;
+  }
   if (jslNeedSpaceBetween(*lastch, ch)) {
     (*col)++;
     user_callback(" ", user_data);
@@ -121,6 +121,9 @@ _LEX_OPERATOR2_START = _LEX_R_LIST_END+10, // padding for adding new symbols in
     LEX_NULLISH = _LEX_OPERATOR2_START,
     LEX_RAW_STRING8, //< a pretokenised string stored as 0xD1,length,raw_binary_data
     LEX_RAW_STRING16, //< a pretokenised string stored as 0xD2,length_lo,length_hi,raw_binary_data
+    LEX_RAW_INT0, //< a pretokenised integer 0 stored as 0xD3
+    LEX_RAW_INT8, //< a pretokenised integer 1..255 stored as 0xD4,value
+    LEX_RAW_INT16, //< a pretokenised integer 256..65535 stored as 0xD5,value_lo,value_hi
 _LEX_OPERATOR2_END = LEX_NULLISH,
 
 _LEX_TOKENS_END = _LEX_OPERATOR2_END, /* always the last entry for symbols */
@@ -151,6 +154,7 @@ typedef struct JsLex
   char token[JSLEX_MAX_TOKEN_LENGTH]; ///< Data contained in the token we have here
   JsVar *tokenValue; ///< JsVar containing the current token - used only for strings/regex
   unsigned char tokenl; ///< the current length of token
+  int tokenRawInt; ///< Value of a LEX_INT from pretokenised code (token is only filled in if asked for), or -1
   bool hadThisKeyword; ///< We need this when scanning arrow functions (to avoid storing a 'this' link if not needed)
 #ifdef ESPR_UNICODE_SUPPORT
   bool isUTF8;         ///< Is the current String a UTF8 String?
@@ -83,9 +83,68 @@ void jspSetError(bool lineReported) {
 bool jspHasError() {
   return JSP_HAS_ERROR;
 }
+#ifndef ESPR_NO_SCOPE_CACHE
+/* Every time an identifier is used, jspeiFindInScopes has to search each
+ * scope in turn and then root. In loops the same identifiers get looked up
+ * over and over, so we cache the NAMEs that were found.
+ *
+ * Each entry is tagged with execInfo.scopesId, which gets a new value every
+ * time the list of scopes changes. When execInfo is restored after a function
+ * call, scopesId is restored too so the caller's entries are valid again.
+ * Entries hold no locks, so they're removed if a child with the same name is
+ * added or removed anywhere (as it could shadow or be the cached NAME) and
+ * the whole cache is cleared when vars are moved, loaded or garbage collected. */
+#define JSP_SCOPE_CACHE_SIZE 16 ///< How many lookups we cache (must be a power of 2)
+#define JSP_SCOPE_CACHE_NAME_LEN 15 ///< Lookups of longer names aren't cached
+typedef struct {
+  unsigned int scopesId; ///< execInfo.scopesId when this was found, or 0 if this entry is unused
+  JsVarRef result; ///< The NAME that was found
+  char name[JSP_SCOPE_CACHE_NAME_LEN+1]; ///< The name that was looked up
+} JspScopeCacheEntry;
+static JspScopeCacheEntry jspScopeCache[JSP_SCOPE_CACHE_SIZE];
+static unsigned int jspScopesLastId; ///< The last value given to execInfo.scopesId
+
+void jspScopeCacheClear() {
+  memset(jspScopeCache, 0, sizeof(jspScopeCache));
+}
+
+void jspScopeCacheNameChanged(JsVar *name) {
+  if (!jsvIsString(name)) return;
+  char ch = name->varData.str[0];
+  for (int i=0;i<JSP_SCOPE_CACHE_SIZE;i++) {
+    JspScopeCacheEntry *entry = &jspScopeCache[i];
+    if (entry->scopesId && entry->name[0]==ch && jsvIsStringEqual(name, entry->name))
+      entry->scopesId = 0;
+  }
+}
+
+/// Get the cache entry that would be used for this name, or 0 if it can't be cached
+static JspScopeCacheEntry *jspScopeCacheGetEntry(const char *name) {
+  unsigned int hash = 0;
+  int len = 0;
+  while (name[len]) {
+    if (len>=JSP_SCOPE_CACHE_NAME_LEN) return 0;
+    hash = hash*31 + (unsigned char)name[len++];
+  }
+  return &jspScopeCache[hash & (JSP_SCOPE_CACHE_SIZE-1)];
+}
+#endif
+
+/// Called whenever execInfo.scopesVar changes
+static void jspeiScopesChanged() {
+#ifndef ESPR_NO_SCOPE_CACHE
+  execInfo.scopesId = ++jspScopesLastId;
+  if (!execInfo.scopesId) { // wrapped around - old entries could now match
+    jspScopeCacheClear();
+    execInfo.scopesId = ++jspScopesLastId;
+  }
+#endif
+}
+
 void jspeiClearScopes() {
   jsvUnLock(execInfo.scopesVar);
   execInfo.scopesVar = 0;
+  jspeiScopesChanged();
 }
 
 bool jspeiAddScope(JsVar *scope) {
@@ -93,6 +152,7 @@ bool jspeiAddScope(JsVar *scope) {
     execInfo.scopesVar = jsvNewEmptyArray();
   if (!execInfo.scopesVar) return false;
   jsvArrayPush(execInfo.scopesVar, scope);
+  jspeiScopesChanged();
   return true;
 }
 
@@ -109,9 +169,10 @@ void jspeiRemoveScope() {
     jsvUnLock(execInfo.scopesVar);
     execInfo.scopesVar = 0;
   }
+  jspeiScopesChanged();
 }
 
-JsVar *jspeiFindInScopes(const char *name) {
+static JsVar *jspeiFindInScopesUncached(const char *name) {
   if (execInfo.scopesVar) {
     JsVar *it = jsvLockSafe(jsvGetLastChild(execInfo.scopesVar));
     while (it) {
@@ -125,6 +186,23 @@ JsVar *jspeiFindInScopes(const char *name) {
   }
   return jsvFindChildFromString(execInfo.root, name);
 }
+
+JsVar *jspeiFindInScopes(const char *name) {
+#ifndef ESPR_NO_SCOPE_CACHE
+  JspScopeCacheEntry *entry = jspScopeCacheGetEntry(name);
+  if (entry && entry->scopesId && entry->scopesId==execInfo.scopesId && !strcmp(entry->name, name))
+    return jsvLock(entry->result);
+  JsVar *ref = jspeiFindInScopesUncached(name);
+  if (ref && entry) {
+    entry->scopesId = execInfo.scopesId;
+    entry->result = jsvGetRef(ref);
+    strcpy(entry->name, name);
+  }
+  return ref;
+#else
+  return jspeiFindInScopesUncached(name);
+#endif
+}
 /// Return the topmost scope (and lock it)
 JsVar *jspeiGetTopScope() {
   if (execInfo.scopesVar) {
@@ -219,6 +297,7 @@ void jspeiLoadScopesFromVar(JsVar *arr) {
       execInfo.scopesVar = jsvNewArray(&arr, 1);
     }
   }
+  jspeiScopesChanged();
 }
 // -----------------------------------------------
 /// Check that we have enough stack to recurse. Return true if all ok, error if not.
@@ -784,7 +863,11 @@ NO_INLINE JsVar *jspeFunctionCall(JsVar *function, JsVar *functionName, JsVar *t
       if (!JSP_HAS_ERROR) {
         // save old scopes and reset scope list
         JsVar *oldScopeVar = execInfo.scopesVar;
+#ifndef ESPR_NO_SCOPE_CACHE
+        unsigned int oldScopesId = execInfo.scopesId;
+#endif
         execInfo.scopesVar = 0;
+        jspeiScopesChanged();
         // if we have a scope var, load it up. We may not have one if there were no scopes apart from root
         if (functionScope) {
           jspeiLoadScopesFromVar(functionScope);
@@ -930,6 +1013,9 @@ NO_INLINE JsVar *jspeFunctionCall(JsVar *function, JsVar *functionName, JsVar *t
         // Unlock scopes and restore old ones
         jsvUnLock(execInfo.scopesVar);
         execInfo.scopesVar = oldScopeVar;
+#ifndef ESPR_NO_SCOPE_CACHE
+        execInfo.scopesId = oldScopesId; // cached lookups for the old scopes are still valid
+#endif
       }
       jsvUnLock2(functionCode, functionRoot);
     }
@@ -981,16 +1067,167 @@ JsVar *jspGetNamedVariable(const char *tokenName) {
   return a;
 }
 
-/// Used by jspGetNamedField / jspGetVarNamedField
-static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName) {
+#ifndef ESPR_NO_PROPERTY_CACHE
+/* Looking up a field that isn't in the object itself means searching the
+ * prototype chain and then the built-in symbol tables. In loops (eg.
+ * `g.setPixel(...)`) the same lookup is done over and over, so we cache
+ * the result of jspFindNamedFieldInParents for a few object/field pairs.
+ *
+ * Entries hold no locks or references, so they must be removed when
+ * anything they depend on changes:
+ *
+ * - When a child is added/removed anywhere, entries with that name are
+ *   removed (jsvAddName/jsvRemoveChild)
+ * - When the object an entry is for is freed (jsvFreePtr)
+ * - When `__proto__`, `prototype` or `constructor` change anywhere the whole
+ *   cache is cleared (see jspPropertyCacheIsPrototypeName)
+ * - When a capitalised name (which could be a class in root) changes, entries
+ *   for objects that find their prototype through that class are removed
+ *   (see jspPropertyCacheRemoveClass)
+ * - When vars are moved, loaded or garbage collected the whole cache is cleared
+ */
+#define JSP_PROPERTY_CACHE_SIZE 16 ///< How many lookups we cache (must be a power of 2)
+#define JSP_PROPERTY_CACHE_NAME_LEN 15 ///< Lookups of fields with longer names aren't cached
+typedef struct {
+  JsVarRef object; ///< The object the field was looked up on, or 0 if this entry is unused
+  JsVarRef result; ///< The NAME that was found in a prototype, or 0 if it was a built-in function
+  void (*nativePtr)(void); ///< If result==0, the built-in function's pointer
+  unsigned short argTypes; ///< If result==0, the built-in function's argument types
+  char name[JSP_PROPERTY_CACHE_NAME_LEN+1]; ///< The name of the field
+} JspPropertyCacheEntry;
+static JspPropertyCacheEntry jspPropertyCache[JSP_PROPERTY_CACHE_SIZE];
+static unsigned char jspPropertyCacheUsed; ///< How many entries are in use (so we can skip checks when the cache is empty)
+
+void jspPropertyCacheClear() {
+  if (!jspPropertyCacheUsed) return;
+  memset(jspPropertyCache, 0, sizeof(jspPropertyCache));
+  jspPropertyCacheUsed = 0;
+}
+
+static void jspPropertyCacheRemoveEntry(JspPropertyCacheEntry *entry) {
+  entry->object = 0;
+  jspPropertyCacheUsed--;
+}
+
+void jspPropertyCacheRemoveObject(JsVar *object) {
+  if (!jspPropertyCacheUsed) return;
+  JsVarRef ref = jsvGetRef(object);
+  for (int i=0;i<JSP_PROPERTY_CACHE_SIZE;i++)
+    if (jspPropertyCache[i].object == ref)
+      jspPropertyCacheRemoveEntry(&jspPropertyCache[i]);
+}
+
+/// Is this `__proto__`, `prototype` or `constructor` - which link objects together?
+static bool jspPropertyCacheIsPrototypeName(JsVar *name) {
+  char ch = name->varData.str[0];
+  return (ch=='_' && jsvIsStringEqual(name, JSPARSE_INHERITS_VAR)) ||
+         (ch=='p' && jsvIsStringEqual(name, JSPARSE_PROTOTYPE_VAR)) ||
+         (ch=='c' && jsvIsStringEqual(name, JSPARSE_CONSTRUCTOR_VAR));
+}
+
+/** Capitalised names in root are the classes used to find prototypes for
+ * Arrays/Strings/etc (and `Object` for everything else). If 'name' is
+ * capitalised, remove entries for objects that would look in that class */
+static void jspPropertyCacheRemoveClass(JsVar *name) {
+  char ch = name->varData.str[0];
+  if (ch<'A' || ch>'Z') return;
+  for (int i=0;i<JSP_PROPERTY_CACHE_SIZE;i++) {
+    JspPropertyCacheEntry *entry = &jspPropertyCache[i];
+    if (!entry->object) continue;
+    // see jspeiFindChildFromStringInParents
+    JsVar *object = jsvLock(entry->object);
+    const char *objectName = jsvIsObject(object) ? "Object" : jswGetBasicObjectName(object);
+    jsvUnLock(object);
+    while (objectName) {
+      if (objectName[0]==ch && jsvIsStringEqual(name, objectName)) {
+        jspPropertyCacheRemoveEntry(entry);
+        break;
+      }
+      objectName = jswGetBasicObjectPrototypeName(objectName);
+    }
+  }
+}
+
+void jspPropertyCacheNameChanged(JsVar *name) {
+  if (!jspPropertyCacheUsed || !jsvIsString(name)) return;
+  if (jspPropertyCacheIsPrototypeName(name)) {
+    jspPropertyCacheClear();
+    return;
+  }
+  char ch = name->varData.str[0];
+  for (int i=0;i<JSP_PROPERTY_CACHE_SIZE;i++) {
+    JspPropertyCacheEntry *entry = &jspPropertyCache[i];
+    if (entry->object && entry->name[0]==ch && jsvIsStringEqual(name, entry->name))
+      jspPropertyCacheRemoveEntry(entry);
+  }
+  jspPropertyCacheRemoveClass(name);
+}
+
+void jspPropertyCacheValueChanged(JsVar *name) {
+  if (!jspPropertyCacheUsed || !jsvIsString(name)) return;
+  if (jspPropertyCacheIsPrototypeName(name))
+    jspPropertyCacheClear();
+  else
+    jspPropertyCacheRemoveClass(name);
+}
+
+/// Get the cache entry that would be used for this lookup, or 0 if it can't be cached
+static JspPropertyCacheEntry *jspPropertyCacheGetEntry(JsVar *object, const char *name) {
+  // Only objects/arrays/functions - anything else could be freed without us knowing.
+  // Don't cache numeric names as they're added to objects as integers
+  if (!jsvHasChildren(object) || (name[0]>='0' && name[0]<='9') || name[0]=='-')
+    return 0;
+  unsigned int hash = jsvGetRef(object);
+  int len = 0;
+  while (name[len]) {
+    if (len>=JSP_PROPERTY_CACHE_NAME_LEN) return 0;
+    hash = hash*31 + (unsigned char)name[len++];
+  }
+  return &jspPropertyCache[hash & (JSP_PROPERTY_CACHE_SIZE-1)];
+}
+
+static void jspPropertyCacheSet(JspPropertyCacheEntry *entry, JsVar *object, const char *name, JsVarRef result) {
+  if (!entry->object) jspPropertyCacheUsed++;
+  entry->object = jsvGetRef(object);
+  entry->result = result;
+  strcpy(entry->name, name);
+}
+#endif
+
+/// Look for a field in an object's prototypes, or in the built-in functions for it
+static JsVar *jspFindNamedFieldInParents(JsVar *object, const char* name) {
+#ifndef ESPR_NO_PROPERTY_CACHE
+  JspPropertyCacheEntry *entry = jspPropertyCacheGetEntry(object, name);
+  if (entry && entry->object==jsvGetRef(object) && !strcmp(entry->name, name)) {
+    if (entry->result) return jsvLock(entry->result);
+    return jsvNewNativeFunction(entry->nativePtr, entry->argTypes);
+  }
+#endif
   // Now look in prototypes
   JsVar * child = jspeiFindChildFromStringInParents(object, name);
+#ifndef ESPR_NO_PROPERTY_CACHE
+  if (child && entry) jspPropertyCacheSet(entry, object, name, jsvGetRef(child));
+#endif
 
   /* Check for builtins via separate function
    * This way we save on RAM for built-ins because everything comes out of program code */
   if (!child) {
     child = jswFindBuiltInFunction(object, name);
+#ifndef ESPR_NO_PROPERTY_CACHE
+    // only cache plain functions - not values (which could change each time)
+    if (entry && jsvIsNativeFunction(child) && !jsvGetFirstChild(child)) {
+      jspPropertyCacheSet(entry, object, name, 0);
+      entry->nativePtr = child->varData.native.ptr;
+      entry->argTypes = child->varData.native.argTypes;
+    }
+#endif
   }
+  return child;
+}
+
+/// Used by jspGetNamedField / jspGetVarNamedField
+static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName) {
+  JsVar * child = jspFindNamedFieldInParents(object, name);
 
   /* We didn't get here if we found a child in the object itself, so
    * if we're here then we probably have the wrong name - so for example
@@ -1043,6 +1280,39 @@ static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* nam
   return child;
 }
 
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+/* Cache of the position in its object's list of children that a field name
+ * was found at last time. Objects made the same way (by the same constructor,
+ * object literal or from similar JSON) have their fields in the same order,
+ * so we check the child at that position first rather than comparing the name
+ * of every child before it. Getting to that child still means following the
+ * sibling list, so this only saves the name comparisons. The child found is
+ * always checked, so this holds no references and never needs clearing. */
+#define JSP_FIELD_POSITION_CACHE_SIZE 32 ///< How many field names we remember positions for (must be a power of 2)
+#define JSP_FIELD_POSITION_NAME_LEN 15 ///< Fields with longer names aren't remembered
+typedef struct {
+  unsigned char position; ///< The position the field was found at last time
+  char name[JSP_FIELD_POSITION_NAME_LEN+1]; ///< The name of the field, or "" if this entry is unused
+} JspFieldPosition;
+static JspFieldPosition jspFieldPositionCache[JSP_FIELD_POSITION_CACHE_SIZE];
+
+/// Get the entry for a field name (allocating it if needed), or 0 if the name can't be remembered
+static JspFieldPosition *jspFieldPositionGet(const char *name) {
+  unsigned int hash = 0;
+  int len = 0;
+  while (name[len]) {
+    if (len>=JSP_FIELD_POSITION_NAME_LEN) return 0;
+    hash = hash*31 + (unsigned char)name[len++];
+  }
+  JspFieldPosition *entry = &jspFieldPositionCache[hash & (JSP_FIELD_POSITION_CACHE_SIZE-1)];
+  if (strcmp(entry->name, name)) {
+    entry->position = 0;
+    memcpy(entry->name, name, (size_t)len+1);
+  }
+  return entry;
+}
+#endif
+
 /** Get the named function/variable on the object - whether it's built in, or predefined.
  * If !returnName, returns the function/variable itself or undefined, but
  * if returnName, return a name (could be fake) referencing the parent.
@@ -1054,8 +1324,15 @@ JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
 
   JsVar *child = 0;
   // if we're an object (or pretending to be one)
-  if (jsvHasChildren(object))
-    child = jsvFindChildFromString(object, name);
+  if (jsvHasChildren(object)) {
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+    JspFieldPosition *entry = jspFieldPositionGet(name);
+    if (entry)
+      child = jsvFindChildFromStringAtPosition(object, name, &entry->position);
+    else
+#endif
+      child = jsvFindChildFromString(object, name);
+  }
 
   if (!child) {
     bool isPrototypeVar = strcmp(name, JSPARSE_PROTOTYPE_VAR)==0;
@@ -1815,7 +2092,10 @@ NO_INLINE JsVar *jspeFactor() {
   } else if (lex->tk==LEX_INT) {
     JsVar *v = 0;
     if (JSP_SHOULD_EXECUTE) {
-      v = jsvNewFromLongInteger(stringToInt(jslGetTokenValueAsString()));
+      if (lex->tokenRawInt>=0) // pretokenised, so we already have the value
+        v = jsvNewFromInteger(lex->tokenRawInt);
+      else
+        v = jsvNewFromLongInteger(stringToInt(jslGetTokenValueAsString()));
     }
     JSP_ASSERT_MATCH(LEX_INT);
     return v;
@@ -1933,10 +2213,8 @@ NO_INLINE JsVar *__jspePostfixExpression(JsVar *a) {
     int op = lex->tk;
     JSP_ASSERT_MATCH(op);
     if (JSP_SHOULD_EXECUTE) {
-      JsVar *one = jsvNewFromInteger(1);
       JsVar *oldValue = jsvAsNumberAndUnLock(jsvSkipName(a)); // keep the old value (but convert to number)
-      JsVar *res = jsvMathsOpSkipNames(oldValue, one, op==LEX_PLUSPLUS ? '+' : '-');
-      jsvUnLock(one);
+      JsVar *res = jsvMathsOpSkipNamesAndUnLock(jsvLockAgainSafe(oldValue), jsvNewFromInteger(1), op==LEX_PLUSPLUS ? '+' : '-');
       // in-place add/subtract
       jsvReplaceWith(a, res);
       jsvUnLock(res);
@@ -1957,9 +2235,7 @@ NO_INLINE JsVar *jspePostfixExpression() {
     JSP_ASSERT_MATCH(op);
     a = jspePostfixExpression();
     if (JSP_SHOULD_EXECUTE) {
-      JsVar *one = jsvNewFromInteger(1);
-      JsVar *res = jsvMathsOpSkipNames(a, one, op==LEX_PLUSPLUS ? '+' : '-');
-      jsvUnLock(one);
+      JsVar *res = jsvMathsOpSkipNamesAndUnLock(jsvLockAgainSafe(a), jsvNewFromInteger(1), op==LEX_PLUSPLUS ? '+' : '-');
       // in-place add/subtract
       jsvReplaceWith(a, res);
       jsvUnLock(res);
@@ -2136,8 +2412,9 @@ NO_INLINE JsVar *__jspeBinaryExpression(JsVar *a, unsigned int lastPrecedence) {
           jsvUnLock3(av, bv, a);
           a = jsvNewFromBool(inst);
         } else {  // --------------------------------------------- NORMAL
-          JsVar *res = jsvMathsOpSkipNames(a, b, op);
-          jsvUnLock(a); a = res;
+          // a and b are consumed, so a temporary result from earlier in the chain can be reused
+          a = jsvMathsOpSkipNamesAndUnLock(a, b, op);
+          b = 0;
         }
       }
       jsvUnLock(b);
@@ -2230,7 +2507,8 @@ NO_INLINE JsVar *__jspeAssignmentExpression(JsVar *lhs) {
         }
         if (op) {
           /* Fallback which does a proper add */
-          JsVar *res = jsvMathsOpSkipNames(lhs,rhs,op);
+          JsVar *res = jsvMathsOpSkipNamesAndUnLock(jsvLockAgainSafe(lhs),rhs,op);
+          rhs = 0; // consumed above
           jsvReplaceWith(lhs, res);
           jsvUnLock(res);
         }
@@ -3213,6 +3491,7 @@ void jspSoftInit() {
   execInfo.hiddenRoot = jsvObjectGetChild(execInfo.root, JS_HIDDEN_CHAR_STR, JSV_OBJECT);
   execInfo.execute = EXEC_YES;
   execInfo.scopesVar = 0;
+  jspeiScopesChanged();
 #ifndef ESPR_NO_LET_SCOPING
   execInfo.baseScope = execInfo.root;
   execInfo.blockScope = 0;
@@ -3284,6 +3563,7 @@ JsVar *jspEvaluateVar(JsVar *str, JsVar *scope, uint16_t lineNumberOffset) {
   if (scope) {
     // if we're adding a scope, make sure it's the *only* scope
     execInfo.scopesVar = 0;
+    jspeiScopesChanged();
     if (scope!=execInfo.root) {
       jspeiAddScope(scope); // it's searched by default anyway
 #ifndef ESPR_NO_LET_SCOPING
@@ -3339,6 +3619,7 @@ JsVar *jspExecuteJSFunction(const char *jsCode, JsVar *thisArg, int argCount, Js
 JsVar *jspExecuteFunction(JsVar *func, JsVar *thisArg, int argCount, JsVar **argPtr) {
   JsExecInfo oldExecInfo = execInfo;
   execInfo.scopesVar = 0;
+  jspeiScopesChanged();
   execInfo.execute = EXEC_YES;
   execInfo.thisVar = 0;
   JsVar *result = jspeFunctionCall(func, 0, thisArg, false, argCount, argPtr);
@@ -136,6 +136,10 @@ typedef struct {
 
   /// JsVar array of all execution scopes (`root` is not included)
   JsVar *scopesVar;
+#ifndef ESPR_NO_SCOPE_CACHE
+  /// Changes whenever scopesVar is changed, so we know if lookups cached by jspeiFindInScopes are still valid
+  unsigned int scopesId;
+#endif
 #ifndef ESPR_NO_LET_SCOPING
   /// This is the base scope of execution - `root`, or the execution scope of the function. Scopes added for let/const are not included
   JsVar *baseScope;
@@ -210,4 +214,30 @@ JsVar *jspeiFindInScopes(const char *name);
 /// Return the topmost scope (and lock it)
 JsVar *jspeiGetTopScope();
 
+#ifndef ESPR_NO_PROPERTY_CACHE
+/// Clear the cache of `object.field` lookups (eg. because variables have been moved or freed)
+void jspPropertyCacheClear();
+/// Remove any cached lookups made on this object (because it's being freed)
+void jspPropertyCacheRemoveObject(JsVar *object);
+/// A child with this name has been added to or removed from an object
+void jspPropertyCacheNameChanged(JsVar *name);
+/// The value of this name is about to change
+void jspPropertyCacheValueChanged(JsVar *name);
+#else
+#define jspPropertyCacheClear()
+#define jspPropertyCacheRemoveObject(object)
+#define jspPropertyCacheNameChanged(name)
+#define jspPropertyCacheValueChanged(name)
+#endif
+
+#ifndef ESPR_NO_SCOPE_CACHE
+/// Clear the cache of variables found with jspeiFindInScopes (eg. because variables have been moved or freed)
+void jspScopeCacheClear();
+/// A child with this name has been added to or removed from an object (which could be a scope)
+void jspScopeCacheNameChanged(JsVar *name);
+#else
+#define jspScopeCacheClear()
+#define jspScopeCacheNameChanged(name)
+#endif
+
 #endif /* JSPARSE_H_ */
@@ -823,7 +823,9 @@ void vcbprintf(
         bool quoted = fmtChar!='v';
         bool isJSONStyle = fmtChar=='Q';
         if (quoted) user_callback("\"",user_data);
-        JsVar *v = jsvAsString(va_arg(argp, JsVar*));
+        JsVar *v = va_arg(argp, JsVar*);
+        // we can iterate over names (eg. Object keys) directly rather than copying them with jsvAsString
+        v = jsvHasCharacterData(v) ? jsvLockAgain(v) : jsvAsString(v);
         if (jsvIsUTF8String(v)) isJSONStyle=true; // if it's a UTF8 string make sure we escape in UTF8 form to force Espruino to re-create it as a UTF8 string when parsing
         buf[1] = 0;
         if (jsvIsString(v)) {
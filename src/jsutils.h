@@ -54,6 +54,18 @@
 #define ESPR_NO_PRETOKENISE 1
 #define ESPR_NO_TEMPLATE_LITERAL 1
 #define ESPR_NO_SOFTWARE_SERIAL 1
+#define ESPR_NO_OBJECT_INDEX 1
+#define ESPR_NO_PROPERTY_CACHE 1
+#define ESPR_NO_SCOPE_CACHE 1
+#define ESPR_NO_INCREMENTAL_GC 1
+#define ESPR_NO_NURSERY 1
+#define ESPR_NO_EVENT_RING 1
+#define ESPR_NO_WATCH_BATCH 1
+#define ESPR_NO_ATOMS 1
+#define ESPR_NO_FIELD_POSITION_CACHE 1
+#define ESPR_NO_JSON_STREAM 1
+#define ESPR_NO_MODIFIED_BANDS 1
+#define ESPR_NO_GLYPH_CACHE 1
 #ifndef ESPR_NO_SOFTWARE_I2C
   #define ESPR_NO_SOFTWARE_I2C 1
 #endif
@@ -323,6 +335,16 @@ typedef int64_t JsSysTime;
 #else
 #define JS_VARS_BEFORE_IDLE_GC 32
 #endif
+/* When garbage collecting on idle, how many vars do we look at before checking
+ * whether any events have come in (see jsvGarbageCollectStep) */
+#define JS_IDLE_GC_STEP_BLOCKS 1000
+/* After the free list is rebuilt in address order, new vars are allocated from the
+ * first 1/JS_NURSERY_FRACTION of memory first, and vars that survive there are moved
+ * out when idle (see jsvNurseryCollect) */
+#define JS_NURSERY_FRACTION 8
+/* How many vars jsvNurseryCollect looks at with interrupts off before letting
+ * any pending interrupts run */
+#define JS_NURSERY_IRQ_BLOCKS 256
 
 // javascript specific names
 #define JSPARSE_RETURN_VAR JS_HIDDEN_CHAR_STR"rtn" // variable name used for returning function results
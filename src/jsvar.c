@@ -21,6 +21,7 @@
 #include "jswrap_object.h" // for jswrap_object_toString
 #include "jswrap_arraybuffer.h" // for jsvNewTypedArray
 #include "jswrap_dataview.h" // for jsvNewDataViewWithData
+#include "jstimer.h" // for jstGetLastBufferTimerTask/utilTimerGetLastTask
 #if defined(ESPR_JIT) && defined(LINUX)
 #include <sys/mman.h>
 #endif
@@ -64,6 +65,90 @@ volatile bool touchedFreeList = false;
 volatile JsVarRef jsVarFirstEmpty; ///< reference of first unused variable (variables are in a linked list)
 volatile MemBusyType isMemoryBusy; ///< Are we doing garbage collection or similar, so can't access memory?
 
+/// What stage of marking the garbage collector is at
+typedef enum {
+  JSVGC_IDLE,   ///< No garbage collection in progress
+  JSVGC_ROOTS,  ///< Marking everything that can be reached from locked vars
+  JSVGC_RESCAN, ///< The mark stack overflowed, so marking children of everything that is already marked
+} PACKED_FLAGS JsvGCPhase;
+static JsvGCPhase jsvGCPhase;
+/// How many vars can be waiting to have their children marked
+#ifdef SAVE_ON_FLASH
+#define JSV_GC_MARK_STACK_SIZE 16
+#else
+#define JSV_GC_MARK_STACK_SIZE 64
+#endif
+static JsVarRef jsvGCMarkStack[JSV_GC_MARK_STACK_SIZE]; ///< Vars that have been marked, but whose children haven't been yet
+static unsigned char jsvGCMarkStackCount; ///< How many items are in jsvGCMarkStack
+static bool jsvGCMarkStackOverflowed; ///< Some vars were marked but didn't fit in jsvGCMarkStack, so we'll have to rescan
+static JsVarRef jsvGCCursor; ///< The next var to look at when in JSVGC_ROOTS/JSVGC_RESCAN
+
+#ifndef ESPR_NO_INCREMENTAL_GC
+static bool jsvGCIncremental; ///< This GC was split up with jsvGarbageCollectStep, so JS code may have run while marking
+
+/// Stop any garbage collection that's in progress (eg. because all vars are about to be wiped)
+static void jsvGarbageCollectCancel() {
+  // JSV_GARBAGE_COLLECT flags are left set, but the next GC will set them all anyway
+  jsvGCPhase = JSVGC_IDLE;
+  jsvGCMarkStackCount = 0;
+  jsvGCMarkStackOverflowed = false;
+  jsvGCIncremental = false;
+}
+/// This var is being freed while an incremental GC is in progress, so don't try and mark its children
+static void jsvGarbageCollectForget(JsVarRef ref) {
+  for (int i=0;i<jsvGCMarkStackCount;i++)
+    if (jsvGCMarkStack[i] == ref) {
+      jsvGCMarkStack[i] = 0;
+      // if this was part way through a list we'd miss the rest, so rescan everything afterwards
+      jsvGCMarkStackOverflowed = true;
+    }
+}
+static void jsvGarbageCollectWriteBarrier(JsVar *v, JsVarRef r);
+/* When an incremental GC is in progress, JS code runs between each part of
+ * it. If a link is made from a var that has already been marked to one that
+ * hasn't, the new var must be marked too or it would be freed. */
+#define JSV_GC_WRITE_BARRIER(v, r, isLink) if (jsvGCPhase!=JSVGC_IDLE && (r) && (isLink)) jsvGarbageCollectWriteBarrier(v, r)
+#else
+#define JSV_GC_WRITE_BARRIER(v, r, isLink)
+#define jsvGarbageCollectCancel()
+#endif
+
+#ifndef SAVE_ON_FLASH
+/** For a few arrays, remember the last element that was found with jsvGetArrayIndex.
+ * Arrays are stored as sorted linked lists, so this means that accessing elements
+ * sequentially (eg. `for (i=0;i<a.length;i++) a[i]`) only has to step one element
+ * along the list, rather than searching from the start or end each time.
+ * Entries are invalidated whenever the element could be removed from the array. */
+#define JSV_ARRAY_INDEX_CACHE_SIZE 4
+typedef struct {
+  JsVarRef arr;   ///< The array
+  JsVarRef child; ///< The NAME_INT (in the array) that was last accessed
+} JsvArrayIndexCacheEntry;
+static JsvArrayIndexCacheEntry jsvArrayIndexCache[JSV_ARRAY_INDEX_CACHE_SIZE];
+static unsigned char jsvArrayIndexCacheNext; ///< next entry to overwrite
+
+/// Forget everything in the array index cache (eg. after a GC or defrag)
+static void jsvArrayIndexCacheClear() {
+  memset(jsvArrayIndexCache, 0, sizeof(jsvArrayIndexCache));
+}
+/// Forget any cached element of the given array
+static void jsvArrayIndexCacheRemoveArray(JsVarRef arr) {
+  for (int i=0;i<JSV_ARRAY_INDEX_CACHE_SIZE;i++)
+    if (jsvArrayIndexCache[i].arr == arr)
+      jsvArrayIndexCache[i].arr = jsvArrayIndexCache[i].child = 0;
+}
+/// Forget this element if it was cached (because it's being removed from its array)
+static void jsvArrayIndexCacheRemoveChild(JsVarRef child) {
+  for (int i=0;i<JSV_ARRAY_INDEX_CACHE_SIZE;i++)
+    if (jsvArrayIndexCache[i].child == child)
+      jsvArrayIndexCache[i].arr = jsvArrayIndexCache[i].child = 0;
+}
+#else
+#define jsvArrayIndexCacheClear()
+#define jsvArrayIndexCacheRemoveArray(arr)
+#define jsvArrayIndexCacheRemoveChild(child)
+#endif
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
@@ -76,10 +161,10 @@ JsVarRefSigned jsvGetFirstChildSigned(const JsVar *v) {
 JsVarRef jsvGetLastChild(const JsVar *v) { return v->varData.ref.lastChild; }
 JsVarRef jsvGetNextSibling(const JsVar *v) { return v->varData.ref.nextSibling; }
 JsVarRef jsvGetPrevSibling(const JsVar *v) { return v->varData.ref.prevSibling; }
-void jsvSetFirstChild(JsVar *v, JsVarRef r) { v->varData.ref.firstChild = r; }
-void jsvSetLastChild(JsVar *v, JsVarRef r) { v->varData.ref.lastChild = r; }
-void jsvSetNextSibling(JsVar *v, JsVarRef r) { v->varData.ref.nextSibling = r; }
-void jsvSetPrevSibling(JsVar *v, JsVarRef r) { v->varData.ref.prevSibling = r; }
+void jsvSetFirstChild(JsVar *v, JsVarRef r) { v->varData.ref.firstChild = r; JSV_GC_WRITE_BARRIER(v, r, jsvHasChildren(v) || jsvHasSingleChild(v)); }
+void jsvSetLastChild(JsVar *v, JsVarRef r) { v->varData.ref.lastChild = r; JSV_GC_WRITE_BARRIER(v, r, jsvHasChildren(v) || jsvHasStringExt(v)); }
+void jsvSetNextSibling(JsVar *v, JsVarRef r) { v->varData.ref.nextSibling = r; JSV_GC_WRITE_BARRIER(v, r, jsvIsName(v)); }
+void jsvSetPrevSibling(JsVar *v, JsVarRef r) { v->varData.ref.prevSibling = r; JSV_GC_WRITE_BARRIER(v, r, jsvIsName(v)); }
 
 JsVarRefCounter jsvGetRefs(JsVar *v) { return v->varData.ref.refs; }
 void jsvSetRefs(JsVar *v, JsVarRefCounter refs) { v->varData.ref.refs = refs; }
@@ -120,6 +205,11 @@ unsigned char jsvGetLocks(JsVar *v) { return (unsigned char)((v->flags>>JSV_LOCK
 #else
 #define JSV_IS_GETTER_OR_SETTER(f) (f)==JSV_GET_SET
 #endif
+#ifdef ESPR_NO_ATOMS
+#define JSV_IS_ATOM_NAME(f) false
+#else
+#define JSV_IS_ATOM_NAME(f) (f)==JSV_NAME_ATOM
+#endif
 #ifdef SPIFLASH_BASE
 #define JSV_IS_FLASH_STRING(f) (f)==JSV_FLASH_STRING
 #else
@@ -135,6 +225,7 @@ bool jsvIsFloat(const JsVar *v) { return v && (v->flags&JSV_VARTYPEMASK)==JSV_FL
 bool jsvIsBoolean(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_BOOL(f); }
 bool jsvIsString(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_STRING(f); } ///< String, or a NAME too
 bool jsvIsUTF8String(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_UNICODE_STRING(f); } ///< Just a unicode string (UTF8 JsVar, pointing to a string)
+bool jsvIsAtomName(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; NOT_USED(f); return JSV_IS_ATOM_NAME(f); } ///< A long name that points to a shared atom string (see jsvAtomTable)
 bool jsvIsBasicString(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_BASIC_STRING(f); } ///< Just a string (NOT a name/flatstr/nativestr or flashstr)
 bool jsvIsStringExt(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_STRING_EXT(f); } ///< The extra bits dumped onto the end of a string to store more data
 bool jsvIsFlatString(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK; return JSV_IS_FLAT_STRING(f); }
@@ -155,7 +246,7 @@ bool jsvIsNull(const JsVar *v) { return v && JSV_IS_NULL(v->flags&JSV_VARTYPEMAS
 bool jsvIsNullish(const JsVar *v) { return !v || JSV_IS_NULL(v->flags&JSV_VARTYPEMASK); } // jsvIsUndefined(v) || jsvIsNull(v);
 bool jsvIsBasic(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return JSV_IS_NUMERIC(f) || JSV_IS_STRING(f); } ///< Is this *not* an array/object/etc
 bool jsvIsName(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return JSV_IS_NAME(f); } ///< NAMEs are what's used to name a variable (it is not the data itself)
-bool jsvIsBasicName(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return f>=JSV_NAME_STRING_0 && f<=JSV_NAME_STRING_MAX; } ///< Simple NAME that links to a variable via firstChild
+bool jsvIsBasicName(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return (f>=JSV_NAME_STRING_0 && f<=JSV_NAME_STRING_MAX) || JSV_IS_ATOM_NAME(f); } ///< Simple NAME that links to a variable via firstChild
 /// Names with values have firstChild set to a value - AND NOT A REFERENCE
 bool jsvIsNameWithValue(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return JSV_IS_NAME_WITH_VALUE(f); }
 bool jsvIsNameInt(const JsVar *v) { if (!v) return false; char f = v->flags&JSV_VARTYPEMASK;  return JSV_IS_NAME_INT(f); } ///< Is this a NAME pointing to an Integer value
@@ -244,6 +335,421 @@ JsVar *_jsvGetAddressOf(JsVarRef ref) {
   return jsvGetAddressOf(ref);
 }
 
+#if !defined(ESPR_NO_OBJECT_INDEX) || !defined(ESPR_NO_ATOMS)
+static unsigned int jsvHashStr(const char *str) {
+  unsigned int hash = 0;
+  while (*str) hash = hash*31 + (unsigned char)*(str++);
+  return hash;
+}
+
+/// Hash a String - must match jsvHashStr (and jsvIsStringEqual - which stops at the first 0)
+static unsigned int jsvHashVar(JsVar *str) {
+  unsigned int hash = 0;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  char ch;
+  while ((ch = jsvStringIteratorGetChar(&it))) {
+    hash = hash*31 + (unsigned char)ch;
+    jsvStringIteratorNext(&it);
+  }
+  jsvStringIteratorFree(&it);
+  return hash;
+}
+#endif
+
+#ifndef ESPR_NO_OBJECT_INDEX
+/** Objects with lots of children (the global scope, objects used as maps,
+ * big prototypes) are slow to search, because children are a linked list.
+ * For a few such objects we keep a hash table of child NAMEs, which is
+ * built the first time a search has to step over JSV_OBJECT_INDEX_THRESHOLD
+ * children, and is then kept up to date by jsvAddName/jsvRemoveChild.
+ *
+ * The table is an open-addressed array of JsVarRefs stored in a flat
+ * string, which stays locked for as long as it is in use. Only String
+ * names are indexed - integer keys still use the linked list. */
+#define JSV_OBJECT_INDEX_COUNT 8 ///< How many objects can be indexed at once
+#define JSV_OBJECT_INDEX_THRESHOLD 32 ///< How many children must be searched before we make an index
+#define JSV_OBJECT_INDEX_DELETED ((JsVarRef)~(JsVarRef)0) ///< Marks a deleted entry in the table
+typedef struct {
+  JsVar *obj;   ///< The object that is indexed (NOT locked), or 0
+  JsVar *table; ///< Locked flat string containing the hash table
+  unsigned int used; ///< Number of entries used in the table (including deleted ones)
+} JsvObjectIndex;
+static JsvObjectIndex jsvObjectIndices[JSV_OBJECT_INDEX_COUNT];
+static unsigned char jsvObjectIndexCount; ///< How many entries of jsvObjectIndices are in use
+static unsigned char jsvObjectIndexBackoff; ///< If >0, we failed to allocate an index recently so don't try again yet
+
+static ALWAYS_INLINE JsVarRef *jsvObjectIndexGetSlots(JsvObjectIndex *idx, unsigned int *mask) {
+  *mask = (unsigned int)(jsvGetCharactersInVar(idx->table) / sizeof(JsVarRef)) - 1;
+  return (JsVarRef*)jsvGetFlatStringPointer(idx->table);
+}
+
+static JsvObjectIndex *jsvObjectIndexGet(const JsVar *obj) {
+  if (!jsvObjectIndexCount) return 0;
+  for (int i=0;i<JSV_OBJECT_INDEX_COUNT;i++)
+    if (jsvObjectIndices[i].obj == obj)
+      return &jsvObjectIndices[i];
+  return 0;
+}
+
+static void jsvObjectIndexFree(JsvObjectIndex *idx) {
+  JsVar *table = idx->table;
+  idx->obj = 0;
+  idx->table = 0;
+  jsvObjectIndexCount--;
+  jsvUnLock(table);
+}
+
+/// Free all object indices (because memory is being saved/defragmented)
+static void jsvObjectIndexFreeAll() {
+  for (int i=0;i<JSV_OBJECT_INDEX_COUNT;i++)
+    if (jsvObjectIndices[i].obj)
+      jsvObjectIndexFree(&jsvObjectIndices[i]);
+}
+
+/// Free indices for any objects that have been freed (eg. by the garbage collector)
+static void jsvObjectIndexFreeUnused() {
+  for (int i=0;i<JSV_OBJECT_INDEX_COUNT;i++)
+    if (jsvObjectIndices[i].obj && (jsvObjectIndices[i].obj->flags&JSV_VARTYPEMASK)==JSV_UNUSED)
+      jsvObjectIndexFree(&jsvObjectIndices[i]);
+}
+
+/// Add a NAME to the object's index. Returns false if the table is too full
+static bool jsvObjectIndexAdd(JsvObjectIndex *idx, JsVar *name) {
+  unsigned int mask;
+  JsVarRef *slots = jsvObjectIndexGetSlots(idx, &mask);
+  if ((idx->used+1)*4 > (mask+1)*3) return false; // >75% full
+  unsigned int i = jsvHashVar(name) & mask;
+  while (slots[i] && slots[i]!=JSV_OBJECT_INDEX_DELETED)
+    i = (i+1) & mask;
+  if (!slots[i]) idx->used++;
+  slots[i] = jsvGetRef(name);
+  return true;
+}
+
+static void jsvObjectIndexRemove(JsvObjectIndex *idx, JsVar *name) {
+  unsigned int mask;
+  JsVarRef *slots = jsvObjectIndexGetSlots(idx, &mask);
+  JsVarRef ref = jsvGetRef(name);
+  unsigned int i = jsvHashVar(name) & mask;
+  while (slots[i]) {
+    if (slots[i] == ref) {
+      slots[i] = JSV_OBJECT_INDEX_DELETED;
+      return;
+    }
+    i = (i+1) & mask;
+  }
+}
+
+/// Find a child of the indexed object that has the given name, and lock it
+static JsVar *jsvObjectIndexFindStr(JsvObjectIndex *idx, const char *name) {
+  unsigned int mask;
+  JsVarRef *slots = jsvObjectIndexGetSlots(idx, &mask);
+  unsigned int i = jsvHashStr(name) & mask;
+  while (slots[i]) {
+    if (slots[i] != JSV_OBJECT_INDEX_DELETED) {
+      JsVar *child = jsvGetAddressOf(slots[i]);
+      if (jsvIsStringEqual(child, name))
+        return jsvLockAgain(child);
+    }
+    i = (i+1) & mask;
+  }
+  return 0;
+}
+
+/// Find a child of the indexed object that has the given (String) name, and lock it
+static JsVar *jsvObjectIndexFindVar(JsvObjectIndex *idx, JsVar *name) {
+  unsigned int mask;
+  JsVarRef *slots = jsvObjectIndexGetSlots(idx, &mask);
+  unsigned int i = jsvHashVar(name) & mask;
+  while (slots[i]) {
+    if (slots[i] != JSV_OBJECT_INDEX_DELETED) {
+      JsVar *child = jsvGetAddressOf(slots[i]);
+      if (jsvIsBasicVarEqual(child, name))
+        return jsvLockAgain(child);
+    }
+    i = (i+1) & mask;
+  }
+  return 0;
+}
+
+/// We searched 'childCount' children of obj - see if we should create an index for it
+static void jsvObjectIndexCreateIfNeeded(JsVar *obj, unsigned int childCount) {
+  if (childCount < JSV_OBJECT_INDEX_THRESHOLD ||
+      jsvObjectIndexCount>=JSV_OBJECT_INDEX_COUNT ||
+      jsvIsArray(obj) || isMemoryBusy || jshIsInInterrupt())
+    return;
+  if (jsvObjectIndexBackoff) {
+    jsvObjectIndexBackoff--;
+    return;
+  }
+  // count all the children, and make the table at least twice that size
+  childCount = (unsigned int)jsvGetChildren(obj);
+  unsigned int size = 64;
+  while (size < childCount*2) size <<= 1;
+  JsVar *table = jsvNewFlatStringOfLength((unsigned int)(size*sizeof(JsVarRef)));
+  if (!table) {
+    jsvObjectIndexBackoff = 255;
+    return;
+  }
+  JsvObjectIndex *idx = 0;
+  for (int i=0;i<JSV_OBJECT_INDEX_COUNT;i++)
+    if (!jsvObjectIndices[i].obj)
+      idx = &jsvObjectIndices[i];
+  assert(idx);
+  idx->obj = obj;
+  idx->table = table;
+  idx->used = 0;
+  jsvObjectIndexCount++;
+  JsVarRef childref = jsvGetFirstChild(obj);
+  while (childref) {
+    JsVar *child = jsvGetAddressOf(childref);
+    if (jsvIsString(child))
+      jsvObjectIndexAdd(idx, child);
+    childref = jsvGetNextSibling(child);
+  }
+}
+
+/// Get the number of objects that currently have a hash index of their children
+unsigned int jsvGetIndexedObjectCount() {
+  return jsvObjectIndexCount;
+}
+#else
+#define jsvObjectIndexFreeAll()
+#define jsvObjectIndexFreeUnused()
+unsigned int jsvGetIndexedObjectCount() {
+  return 0;
+}
+#endif
+
+#ifndef ESPR_NO_ATOMS
+/** Lots of objects often have the same long property names (eg. records
+ * from JSON.parse), and normally each NAME stores its own copy of the text,
+ * using StringExts when it doesn't fit in one var. Instead, names that are too
+ * long are made into a JSV_NAME_ATOM, which keeps its first characters inline
+ * (so quick checks on varData.str still work) but links with lastChild to a
+ * reference counted 'atom' - a basic String shared by every name with that text.
+ *
+ * jsvAtomTable is an open-addressed hash table of all the atoms, stored like
+ * the object indices. It doesn't reference the atoms, but they are removed
+ * from it when the last name that uses them is freed. As every atom is in the
+ * table there's only ever one atom for a string, so two JSV_NAME_ATOMs are
+ * the same name exactly when they link to the same atom.
+ *
+ * The table is freed when memory is saved or defragmented, and rebuilt from
+ * the JSV_NAME_ATOMs in memory the next time it is needed. */
+#define JSV_ATOM_TABLE_MIN_SIZE 64 ///< Initial size of the table (a power of 2)
+#define JSV_ATOM_DELETED ((JsVarRef)~(JsVarRef)0) ///< Marks a deleted entry in the table
+static JsVar *jsvAtomTable; ///< Locked flat string containing the hash table of atoms, or 0
+static unsigned int jsvAtomTableUsed; ///< Number of entries used in the table (including deleted ones)
+static unsigned int jsvAtomCount; ///< Number of atoms in the table
+static unsigned char jsvAtomTableBackoff; ///< If >0, we failed to allocate a table recently so don't try again yet
+
+void jsvFreePtrStringExt(JsVar* var);
+
+static ALWAYS_INLINE JsVarRef *jsvAtomTableGetSlots(unsigned int *mask) {
+  *mask = (unsigned int)(jsvGetCharactersInVar(jsvAtomTable) / sizeof(JsVarRef)) - 1;
+  return (JsVarRef*)jsvGetFlatStringPointer(jsvAtomTable);
+}
+
+static void jsvAtomTableFree() {
+  JsVar *table = jsvAtomTable;
+  jsvAtomTable = 0;
+  jsvAtomTableUsed = 0;
+  jsvAtomCount = 0;
+  jsvUnLock(table);
+}
+
+/// Find the atom with the same text as 'str' (which could be the atom itself) - doesn't lock
+static JsVar *jsvAtomFindVar(JsVar *str, unsigned int hash) {
+  unsigned int mask;
+  JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+  unsigned int i = hash & mask;
+  while (slots[i]) {
+    if (slots[i] != JSV_ATOM_DELETED) {
+      JsVar *atom = jsvGetAddressOf(slots[i]);
+      if (jsvIsBasicVarEqual(atom, str))
+        return atom;
+    }
+    i = (i+1) & mask;
+  }
+  return 0;
+}
+
+/// Find the atom for the given string, or return 0
+static JsVarRef jsvAtomFindStr(const char *str) {
+  unsigned int mask;
+  JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+  unsigned int i = jsvHashStr(str) & mask;
+  size_t len = strlen(str);
+  while (slots[i]) {
+    if (slots[i] != JSV_ATOM_DELETED) {
+      JsVar *atom = jsvGetAddressOf(slots[i]);
+      if (jsvIsStringEqual(atom, str) && jsvGetStringLength(atom)==len)
+        return slots[i];
+    }
+    i = (i+1) & mask;
+  }
+  return 0;
+}
+
+/// Put a new atom in the table (it must not be in there already, and there must be space)
+static void jsvAtomTableInsert(JsVarRef *slots, unsigned int mask, JsVarRef atom, unsigned int hash) {
+  unsigned int i = hash & mask;
+  while (slots[i] && slots[i]!=JSV_ATOM_DELETED)
+    i = (i+1) & mask;
+  if (!slots[i]) jsvAtomTableUsed++;
+  slots[i] = atom;
+  jsvAtomCount++;
+}
+
+/// Replace the table with one of the given size. Returns false if out of memory
+static bool jsvAtomTableResize(unsigned int size) {
+  JsVar *table = jsvNewFlatStringOfLength((unsigned int)(size*sizeof(JsVarRef)));
+  if (!table) return false;
+  JsVar *oldTable = jsvAtomTable;
+  unsigned int oldMask = 0;
+  JsVarRef *oldSlots = oldTable ? jsvAtomTableGetSlots(&oldMask) : 0;
+  jsvAtomTable = table;
+  jsvAtomTableUsed = 0;
+  jsvAtomCount = 0;
+  if (oldTable) {
+    unsigned int mask;
+    JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+    for (unsigned int i=0;i<=oldMask;i++)
+      if (oldSlots[i] && oldSlots[i]!=JSV_ATOM_DELETED)
+        jsvAtomTableInsert(slots, mask, oldSlots[i], jsvHashVar(jsvGetAddressOf(oldSlots[i])));
+    jsvUnLock(oldTable);
+  }
+  return true;
+}
+
+/// Add a new atom to the table, making it bigger if needed. Returns false if out of memory
+static bool jsvAtomTableAdd(JsVar *atom, unsigned int hash) {
+  unsigned int mask;
+  jsvAtomTableGetSlots(&mask);
+  if ((jsvAtomTableUsed+1)*4 > (mask+1)*3 && // >75% full
+      !jsvAtomTableResize((jsvAtomCount+1)*4 > (mask+1)*3/2 ? (mask+1)*2 : mask+1))
+    return false;
+  JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+  jsvAtomTableInsert(slots, mask, jsvGetRef(atom), hash);
+  return true;
+}
+
+/// Create the table, adding the atoms of any JSV_NAME_ATOMs already in memory (eg. after a load or defrag)
+static bool jsvAtomTableCreate() {
+  if (jsvAtomTableBackoff) {
+    jsvAtomTableBackoff--;
+    return false;
+  }
+  if (!jsvAtomTableResize(JSV_ATOM_TABLE_MIN_SIZE)) {
+    jsvAtomTableBackoff = 255;
+    return false;
+  }
+  for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
+    JsVar *v = _jsvGetAddressOf((JsVarRef)(i+1));
+    if (jsvIsFlatString(v)) {
+      i += (unsigned int)jsvGetFlatStringBlocks(v); // skip forward
+    } else if (jsvIsAtomName(v)) {
+      JsVar *atom = jsvGetAddressOf(jsvGetLastChild(v));
+      unsigned int hash = jsvHashVar(atom);
+      if (!jsvAtomFindVar(atom, hash) && !jsvAtomTableAdd(atom, hash)) {
+        // we can't add every atom, so we can't use the table
+        jsvAtomTableFree();
+        jsvAtomTableBackoff = 255;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Remove an atom from the table (because it's about to be freed)
+static void jsvAtomTableRemove(JsVar *atom) {
+  if (!jsvAtomTable) return;
+  unsigned int mask;
+  JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+  JsVarRef ref = jsvGetRef(atom);
+  unsigned int i = jsvHashVar(atom) & mask;
+  while (slots[i]) {
+    if (slots[i] == ref) {
+      slots[i] = JSV_ATOM_DELETED;
+      jsvAtomCount--;
+      return;
+    }
+    i = (i+1) & mask;
+  }
+}
+
+/// Remove atoms that have been (or are about to be) freed by the garbage collector from the table
+static void jsvAtomTableFreeUnused() {
+  if (!jsvAtomTable) return;
+  unsigned int mask;
+  JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+  for (unsigned int i=0;i<=mask;i++) {
+    if (slots[i] && slots[i]!=JSV_ATOM_DELETED) {
+      JsVar *atom = jsvGetAddressOf(slots[i]);
+      if ((atom->flags&JSV_VARTYPEMASK)==JSV_UNUSED || !jsvGetRefs(atom)) {
+        slots[i] = JSV_ATOM_DELETED;
+        jsvAtomCount--;
+      }
+    }
+  }
+  // no atoms left - free the table too (it'll get recreated when next needed)
+  if (!jsvAtomCount) jsvAtomTableFree();
+}
+
+/// A JSV_NAME_ATOM is being freed - unreference its atom (removing it from the table if nothing else uses it)
+static void jsvAtomNameFree(JsVar *name) {
+  JsVar *atom = jsvLock(jsvGetLastChild(name));
+  jsvSetLastChild(name, 0);
+  if (jsvGetRefs(atom)==1) jsvAtomTableRemove(atom);
+  jsvUnRef(atom);
+  jsvUnLock(atom);
+}
+
+/** Try and turn a basic String that is too long to fit in a NAME into a
+ * JSV_NAME_ATOM (with no value). Returns false if we can't (eg. out of memory) */
+static bool jsvMakeIntoAtomName(JsVar *var) {
+  assert(jsvIsBasicString(var) && jsvGetCharactersInVar(var) > JSVAR_DATA_STRING_NAME_LEN);
+  if (isMemoryBusy || jshIsInInterrupt()) return false;
+  if (!jsvAtomTable && !jsvAtomTableCreate()) return false;
+  unsigned int hash = jsvHashVar(var);
+  JsVar *atom = jsvAtomFindVar(var, hash);
+  if (atom) {
+    atom = jsvLockAgain(atom);
+  } else {
+    atom = jsvNewFromStringVarComplete(var);
+    if (!atom) return false;
+    if (!jsvAtomTableAdd(atom, hash)) {
+      jsvUnLock(atom);
+      return false;
+    }
+  }
+  // The atom has all our characters now - just keep the first few in varData.str
+  jsvStringEndCacheRemove(jsvGetRef(var));
+  jsvFreePtrStringExt(var);
+  jsvSetNextSibling(var, 0);
+  jsvSetPrevSibling(var, 0);
+  jsvSetFirstChild(var, 0);
+  var->flags = (var->flags & (JsVarFlags)~JSV_VARTYPEMASK) | JSV_NAME_ATOM;
+  jsvSetLastChild(var, jsvGetRef(jsvRef(atom)));
+  jsvUnLock(atom);
+  return true;
+}
+
+/// Get the number of atoms - strings shared between long names
+unsigned int jsvGetAtomCount() {
+  return jsvAtomCount;
+}
+#else
+#define jsvAtomTableFree()
+#define jsvAtomTableFreeUnused()
+unsigned int jsvGetAtomCount() {
+  return 0;
+}
+#endif
+
 // For debugging/testing ONLY - maximum # of vars we are allowed to use
 void jsvSetMaxVarsUsed(unsigned int size) {
 #ifdef RESIZABLE_JSVARS
@@ -308,9 +814,17 @@ void jsvClearEmptyVarList() {
 
 void jsvSoftInit() {
   jsvCreateEmptyVarList();
+  jsvArrayIndexCacheClear();
+  jsvStringEndCacheClear();
+  jspPropertyCacheClear();
+  jspScopeCacheClear();
 }
 
 void jsvSoftKill() {
+  jsvGarbageCollectCancel();
+  // don't save object indices or atom table - they'll get recreated when needed
+  jsvObjectIndexFreeAll();
+  jsvAtomTableFree();
   jsvClearEmptyVarList();
 }
 
@@ -335,7 +849,23 @@ static JsVarRef jsvInitJsVars(JsVarRef start, unsigned int count) {
 
 
 void jsvReset() {
+  jsvGarbageCollectCancel();
   jsVarFirstEmpty = 0; // jsvCreateEmptyVarList in jsvSoftInit sets this
+  jsvArrayIndexCacheClear();
+  jsvStringEndCacheClear();
+  jspPropertyCacheClear();
+  jspScopeCacheClear();
+#ifndef ESPR_NO_OBJECT_INDEX
+  // all vars are about to be wiped, so just forget about any indices
+  memset(jsvObjectIndices, 0, sizeof(jsvObjectIndices));
+  jsvObjectIndexCount = 0;
+#endif
+#ifndef ESPR_NO_ATOMS
+  jsvAtomTable = 0;
+  jsvAtomTableUsed = 0;
+  jsvAtomCount = 0;
+  jsvAtomTableBackoff = 0;
+#endif
 #ifdef RESIZABLE_JSVARS
   unsigned int i;
   for (i=0;i<jsVarsSize>>JSVAR_BLOCK_SHIFT;i++) {
@@ -377,6 +907,16 @@ void jsvInit(unsigned int size) {
 }
 
 void jsvKill() {
+#ifndef ESPR_NO_OBJECT_INDEX
+  memset(jsvObjectIndices, 0, sizeof(jsvObjectIndices));
+  jsvObjectIndexCount = 0;
+#endif
+#ifndef ESPR_NO_ATOMS
+  jsvAtomTable = 0;
+  jsvAtomTableUsed = 0;
+  jsvAtomCount = 0;
+  jsvAtomTableBackoff = 0;
+#endif
 #ifdef RESIZABLE_JSVARS
   unsigned int i;
   for (i=0;i<jsVarsSize>>JSVAR_BLOCK_SHIFT;i++) {
@@ -426,6 +966,28 @@ unsigned int jsvGetMemoryUsage() {
   return usage;
 }
 
+/// Get the size of the largest run of contiguous free blocks, and optionally the number of separate runs
+unsigned int jsvGetLargestFreeRun(unsigned int *runCount) {
+  unsigned int largest = 0, runs = 0, blockCount = 0;
+  for (unsigned int i=1;i<=jsVarsSize;i++) {
+    JsVar *v = jsvGetAddressOf((JsVarRef)i);
+    if ((v->flags&JSV_VARTYPEMASK) == JSV_UNUSED) {
+#ifdef RESIZABLE_JSVARS
+      if (blockCount && jsvGetAddressOf((JsVarRef)(i-1))+1 != v)
+        blockCount = 0; // blocks aren't contiguous in memory
+#endif
+      if (!blockCount) runs++;
+      if (++blockCount > largest) largest = blockCount;
+    } else {
+      blockCount = 0;
+      if (jsvIsFlatString(v))
+        i += (unsigned int)jsvGetFlatStringBlocks(v);
+    }
+  }
+  if (runCount) *runCount = runs;
+  return largest;
+}
+
 /// Get total amount of memory records
 unsigned int jsvGetMemoryTotal() {
   return jsVarsSize;
@@ -533,6 +1095,10 @@ size_t jsvGetCharactersInVar(const JsVar *v) {
   if (f<=JSV_NAME_STRING_MAX) {
     if (f<=JSV_NAME_STRING_INT_MAX)
       return f-JSV_NAME_STRING_INT_0;
+#ifndef ESPR_NO_ATOMS
+    else if (f==JSV_NAME_ATOM)
+      return JSVAR_DATA_STRING_NAME_LEN; // just the characters kept inline - the atom has them all
+#endif
     else
       return f-JSV_NAME_STRING_0;
   } else {
@@ -586,6 +1152,11 @@ void jsvResetVariable(JsVar *v, JsVarFlags flags) {
       ((uint8_t*)v)[i] = 0;
   }
   v->flags = flags | JSV_LOCK_ONE;
+#ifndef ESPR_NO_INCREMENTAL_GC
+  /* If a GC is in progress, new vars are only kept if they're locked or
+   * referenced from something else that's kept by the time it finishes */
+  if (jsvGCPhase!=JSVGC_IDLE) v->flags |= JSV_GARBAGE_COLLECT;
+#endif
   // This code really *should* be faster as it really does just
   // create a handful of stores and the ARM assembly looks great.
   // Somehow it's slower though!
@@ -654,6 +1225,9 @@ JsVar *jsvNewWithFlags(JsVarFlags flags) {
 
 static void jsvFreePtrInternal(JsVar *var) {
   assert(jsvGetLocks(var)==0);
+#ifndef ESPR_NO_INCREMENTAL_GC
+  if (jsvGCPhase!=JSVGC_IDLE) jsvGarbageCollectForget(jsvGetRef(var));
+#endif
   var->flags = JSV_UNUSED;
   // add this to our free list
   jshInterruptOff(); // to allow this to be used from an IRQ
@@ -715,7 +1289,12 @@ ALWAYS_INLINE void jsvFreePtr(JsVar *var) {
   if (jsvIsUTF8String(var)) {
     jsvUnRefRef(jsvGetLastChild(var));
     jsvSetLastChild(var, 0);
+#ifndef ESPR_NO_ATOMS
+  } else if (jsvIsAtomName(var)) {
+    jsvAtomNameFree(var);
+#endif
   } else if (jsvHasStringExt(var)) {
+    jsvStringEndCacheRemove(jsvGetRef(var));
     // Free the string without recursing
     jsvFreePtrStringExt(var);
 #ifdef CLEAR_MEMORY_ON_FREE
@@ -760,6 +1339,13 @@ ALWAYS_INLINE void jsvFreePtr(JsVar *var) {
     can be ints or strings */
 
   if (jsvHasChildren(var)) {
+    if (jsvIsArray(var))
+      jsvArrayIndexCacheRemoveArray(jsvGetRef(var));
+    jspPropertyCacheRemoveObject(var);
+#ifndef ESPR_NO_OBJECT_INDEX
+    JsvObjectIndex *idx = jsvObjectIndexGet(var);
+    if (idx) jsvObjectIndexFree(idx);
+#endif
     JsVarRef childref = jsvGetLastChild(var);
 #ifdef CLEAR_MEMORY_ON_FREE
     jsvSetFirstChild(var, 0);
@@ -945,6 +1531,132 @@ JsVarRef jsvUnRefRef(JsVarRef ref) {
   return 0;
 }
 
+/* Claim the 'requiredBlocks' blocks starting at 'startBlock' (which must
+ * all be free) as a flat string. Must be called with interrupts off */
+static JsVar *jsvNewFlatStringInBlocks(JsVarRef startBlock, size_t requiredBlocks, unsigned int byteLength) {
+  JsVar *flatString = jsvGetAddressOf(startBlock);
+  // Set up the header block (including one lock)
+  jsvResetVariable(flatString, JSV_FLAT_STRING);
+  flatString->varData.integer = (JsVarInt)byteLength;
+#ifndef ESPR_NO_INCREMENTAL_GC
+  // if a GC is in progress, don't let it look at our data as if it were vars
+  if (jsvGCCursor>startBlock && jsvGCCursor<startBlock+requiredBlocks)
+    jsvGCCursor = startBlock;
+#endif
+  return flatString;
+}
+
+/* Search the variable array itself (rather than the free list) for the first
+ * run of 'requiredBlocks' free blocks that could hold a flat string. Single
+ * vars are freed onto the front of the free list, so after a while it is no
+ * longer in address order and searching it can miss free space.
+ *
+ * If 'movingBlock' is set, it's a flat string that we want to move lower
+ * down in memory - its blocks count as free, but only runs starting below
+ * it are returned. */
+static JsVarRef jsvFindFreeRun(size_t requiredBlocks, JsVarRef movingBlock) {
+  JsVarRef startBlock = 0;
+  size_t blockCount = 0;
+  for (JsVarRef i=1;i<=jsVarsSize;i++) {
+    JsVar *v = jsvGetAddressOf(i);
+    bool isMoving = movingBlock && i>=movingBlock;
+    if (isMoving || (v->flags&JSV_VARTYPEMASK) == JSV_UNUSED) {
+#ifdef RESIZABLE_JSVARS
+      if (blockCount && jsvGetAddressOf((JsVarRef)(i-1))+1 != v)
+        blockCount = 0; // blocks aren't contiguous in memory
+#endif
+      if (!blockCount) {
+        if (isMoving) return 0; // no space below the block we're moving
+        // Check to see if the next block is aligned on a 4 byte boundary or not
+        if (i==jsVarsSize || ((size_t)(jsvGetAddressOf((JsVarRef)(i+1))))&3)
+          continue; // this block is not aligned
+        startBlock = i;
+      }
+      if (++blockCount >= requiredBlocks)
+        return startBlock;
+    } else {
+      blockCount = 0;
+      if (jsvIsFlatString(v)) // skip over used blocks for flat strings
+        i = (JsVarRef)(i+jsvGetFlatStringBlocks(v));
+    }
+  }
+  return 0;
+}
+
+/// How many blocks jsvNewFlatStringInFreeRun looks at each time it turns interrupts off
+#define JSV_FREE_RUN_CHUNK 32
+/// How many free runs jsvNewFlatStringOfLength tries before giving up (and doing a GC)
+#define JSV_FREE_RUN_TRIES 4
+
+/* Allocate a flat string in a run of blocks found with jsvFindFreeRun,
+ * unlinking them from wherever they are in the free list. So that interrupts
+ * aren't off for the whole walk of the free list, they are only turned off for
+ * JSV_FREE_RUN_CHUNK blocks at a time. If an interrupt changed the free list
+ * in between, we check the run is still free and walk it again from the top.
+ *
+ * Blocks we have unlinked point to themselves (which no block in the free
+ * list can) so we can put them back if an interrupt allocated part of the run. */
+static JsVar *jsvNewFlatStringInFreeRun(JsVarRef startBlock, size_t requiredBlocks, unsigned int byteLength) {
+  JsVarRef endBlock = (JsVarRef)(startBlock+requiredBlocks);
+  size_t inFreeList = requiredBlocks; // blocks of the run we have yet to unlink
+  size_t checked = 0; // blocks of the run we know are still free
+  JsVarRef prev = 0, curr = 0;
+  bool restart = true, failed = false;
+  JsVar *flatString = 0;
+  while (!flatString && !failed) {
+    jshInterruptOff();
+    if (restart || touchedFreeList) {
+      restart = false;
+      touchedFreeList = false;
+      checked = 0;
+      prev = 0;
+      curr = jsVarFirstEmpty;
+    }
+    for (int n=0;n<JSV_FREE_RUN_CHUNK;n++) {
+      if (checked<requiredBlocks) {
+        // make sure nothing got allocated in our run since we found it
+        if ((jsvGetAddressOf((JsVarRef)(startBlock+checked))->flags&JSV_VARTYPEMASK) != JSV_UNUSED) {
+          failed = true;
+          break;
+        }
+        checked++;
+      } else if (inFreeList) {
+        if (!curr) { // every free block should be in the free list
+          assert(0);
+          failed = true;
+          break;
+        }
+        JsVar *currVar = jsvGetAddressOf(curr);
+        JsVarRef next = jsvGetNextSibling(currVar);
+        if (curr>=startBlock && curr<endBlock) {
+          if (prev) jsvSetNextSibling(jsvGetAddressOf(prev), next);
+          else jsVarFirstEmpty = next;
+          jsvSetNextSibling(currVar, curr); // mark as unlinked
+          inFreeList--;
+        } else
+          prev = curr;
+        curr = next;
+      } else {
+        flatString = jsvNewFlatStringInBlocks(startBlock, requiredBlocks, byteLength);
+        break;
+      }
+    }
+    if (failed && inFreeList<requiredBlocks) {
+      // put back the blocks we unlinked
+      for (JsVarRef r=startBlock;r<endBlock;r++) {
+        JsVar *v = jsvGetAddressOf(r);
+        if ((v->flags&JSV_VARTYPEMASK)==JSV_UNUSED && jsvGetNextSibling(v)==r) {
+          jsvSetNextSibling(v, jsVarFirstEmpty);
+          jsVarFirstEmpty = r;
+        }
+      }
+    }
+    jshInterruptOn();
+  }
+  touchedFreeList = true; // in case we interrupted someone else walking the free list
+  return flatString;
+}
+
 JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
   bool firstRun = true;
   // Work out how many blocks we need. One for the header, plus some for the characters
@@ -987,10 +1699,7 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
               } else {
                 jsVarFirstEmpty = nextFree;
               }
-              flatString = jsvGetAddressOf(startBlock);
-              // Set up the header block (including one lock)
-              jsvResetVariable(flatString, JSV_FLAT_STRING);
-              flatString->varData.integer = (JsVarInt)byteLength;
+              flatString = jsvNewFlatStringInBlocks(startBlock, requiredBlocks, byteLength);
             }
             jshInterruptOn();
             // if success, break out!
@@ -1014,6 +1723,16 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
         memoryTouched = true;
       }
     }
+    /* The free list may just be out of order, so if it didn't contain a
+     * long enough run look for one in the variable array itself before
+     * resorting to a GC. If an interrupt allocated part of the run we'll find
+     * a different one next time - but if we can't unlink a run for any other
+     * reason we'd keep finding the same one, so only try a few times. */
+    for (int tries=0;!flatString && tries<JSV_FREE_RUN_TRIES;tries++) {
+      JsVarRef startBlock = jsvFindFreeRun(requiredBlocks, 0);
+      if (!startBlock) break;
+      flatString = jsvNewFlatStringInFreeRun(startBlock, requiredBlocks, byteLength);
+    }
 
     // all good
     if (flatString || !firstRun)
@@ -1078,6 +1797,11 @@ JsVar *jsvNewFromString(const char *str) {
 }
 
 JsVar *jsvNewNameFromString(const char *str) {
+#ifndef ESPR_NO_ATOMS
+  // jsvMakeIntoVariableName will make long names into atoms
+  if (strlen(str) > JSVAR_DATA_STRING_NAME_LEN)
+    return jsvMakeIntoVariableName(jsvNewFromString(str), 0);
+#endif
   return jsvNewNameOrString(str, true/*isName*/);
 }
 
@@ -1086,7 +1810,7 @@ JsVar *jsvNewStringOfLength(unsigned int byteLength, const char *initialData) {
   if (byteLength > JSV_FLAT_STRING_BREAK_EVEN) {
     JsVar *v = jsvNewFlatStringOfLength(byteLength);
     if (v) {
-      if (initialData) jsvSetString(v, initialData, byteLength);
+      if (initialData) memcpy(jsvGetFlatStringPointer(v), initialData, byteLength);
       return v;
     }
   }
@@ -1271,6 +1995,14 @@ JsVar *jsvMakeIntoVariableName(JsVar *var, JsVar *valueOrZero) {
 #ifdef ESPR_UNICODE_SUPPORT
   } else if (jsvIsUTF8String(var)) {
     var->flags = (var->flags & (JsVarFlags)~JSV_VARTYPEMASK) | JSV_NAME_UTF8_STRING;
+#endif
+#ifndef ESPR_NO_ATOMS
+  } else if (JSV_IS_ATOM_NAME(varType)) {
+    // a copy of a name that already uses an atom - nothing to do
+  } else if (JSV_IS_BASIC_STRING(varType) &&
+             jsvGetCharactersInVar(var) > JSVAR_DATA_STRING_NAME_LEN &&
+             jsvMakeIntoAtomName(var)) {
+    // it's now a JSV_NAME_ATOM that shares its characters with other names
 #endif
   } else if (JSV_IS_STRING(varType)) {
     if (JSV_IS_NONAPPENDABLE_STRING(varType)) {
@@ -1282,6 +2014,7 @@ JsVar *jsvMakeIntoVariableName(JsVar *var, JsVar *valueOrZero) {
       /* Argh. String is too large to fit in a JSV_NAME! We must chomp
        * new STRINGEXTs to put the data in
        */
+      jsvStringEndCacheRemove(jsvGetRef(var)); // characters will move between blocks
       JsvStringIterator it;
       char queue[JSVAR_DATA_STRING_LEN - JSVAR_DATA_STRING_NAME_LEN];
       int index;
@@ -1412,6 +2145,11 @@ bool jsvIsBasicVarEqual(JsVar *a, JsVar *b) {
       }
     }
   } else if (jsvIsString(a) && jsvIsString(b)) {
+#ifndef ESPR_NO_ATOMS
+    // there's only ever one atom for each string, so we can just compare them
+    if (jsvIsAtomName(a) && jsvIsAtomName(b))
+      return jsvGetLastChild(a)==jsvGetLastChild(b);
+#endif
     // OPT: could we do a fast check here with data?
     JsvStringIterator ita, itb;
     jsvStringIteratorNew(&ita, a, 0);
@@ -1711,6 +2449,14 @@ size_t jsvGetStringLength(const JsVar *v) {
     jsvStringIteratorFree(&it);
     return strLength;
   }
+#ifndef ESPR_NO_ATOMS
+  if (jsvIsAtomName(v)) {
+    JsVar *atom = jsvLock(jsvGetLastChild(v));
+    strLength = jsvGetStringLength(atom);
+    jsvUnLock(atom);
+    return strLength;
+  }
+#endif
 
   const JsVar *var = v;
   JsVar *newVar = 0;
@@ -1877,13 +2623,7 @@ void jsvAppendStringBuf(JsVar *var, const char *str, size_t length) {
   JsvStringIterator dst;
   jsvStringIteratorNew(&dst, var, 0);
   jsvStringIteratorGotoEnd(&dst);
-  // now start appending
-  /* This isn't as fast as something single-purpose, but it's not that bad,
-   * and is less likely to break :) */
-  while (length) {
-    jsvStringIteratorAppend(&dst, *(str++));
-    length--;
-  }
+  jsvStringIteratorAppendBuf(&dst, str, length);
   jsvStringIteratorFree(&dst);
 }
 
@@ -1930,15 +2670,8 @@ void jsvAppendStringVar(JsVar *var, const JsVar *str, size_t stridx, size_t maxL
   jsvStringIteratorNew(&dst, var, 0);
   jsvStringIteratorGotoEnd(&dst);
   // now start appending
-  /* This isn't as fast as something single-purpose, but it's not that bad,
-     * and is less likely to break :) */
-  JsvStringIterator it;
-  jsvStringIteratorNewConst(&it, str, stridx);
-  while (jsvStringIteratorHasChar(&it) && (maxLength-->0)) {
-    char ch = jsvStringIteratorGetCharAndNext(&it);
-    jsvStringIteratorAppend(&dst, ch);
-  }
-  jsvStringIteratorFree(&it);
+  if (maxLength > JSVAPPENDSTRINGVAR_MAXLENGTH) maxLength = JSVAPPENDSTRINGVAR_MAXLENGTH;
+  jsvStringIteratorAppendString(&dst, (JsVar*)str, stridx, (int)maxLength);
   jsvStringIteratorFree(&dst);
 }
 
@@ -2739,6 +3472,12 @@ JsVar *jsvCopyNameOnly(JsVar *src, bool linkChildren, bool keepAsName) {
       // If it had extra string data it should have been handled above
       assert(keepAsName || !jsvGetLastChild(src));
       // copy extra bits of string if there were any
+#ifndef ESPR_NO_ATOMS
+      if (jsvIsAtomName(src)) {
+        // atoms are shared, not copied
+        jsvSetLastChild(dst, jsvRefRef(jsvGetLastChild(src)));
+      } else
+#endif
       if (jsvGetLastChild(src)) {
         JsVar *child = jsvLock(jsvGetLastChild(src));
         JsVar *childCopy = jsvCopy(child, true);
@@ -2806,6 +3545,12 @@ JsVar *jsvCopy(JsVar *src, bool copyChildren) {
     }
   }
 
+#ifndef ESPR_NO_ATOMS
+  if (jsvIsAtomName(src)) {
+    // atoms are shared, not copied
+    jsvSetLastChild(dst, jsvRefRef(jsvGetLastChild(src)));
+  } else
+#endif
   if (jsvHasStringExt(src)) {
     // copy extra bits of string if there were any
     src = jsvLockAgain(src);
@@ -2908,6 +3653,13 @@ void jsvAddName(JsVar *parent, JsVar *namedChild) {
     jsvSetFirstChild(parent, r);
     jsvSetLastChild(parent, r);
   }
+#ifndef ESPR_NO_OBJECT_INDEX
+  JsvObjectIndex *idx = jsvObjectIndexGet(parent);
+  if (idx && jsvIsString(namedChild) && !jsvObjectIndexAdd(idx, namedChild))
+    jsvObjectIndexFree(idx); // table full - it'll get recreated (bigger) when next needed
+#endif
+  jspPropertyCacheNameChanged(namedChild);
+  jspScopeCacheNameChanged(namedChild);
 }
 
 JsVar *jsvAddNamedChild(JsVar *parent, JsVar *value, const char *name) {
@@ -2926,6 +3678,7 @@ void jsvAddNamedChildAndUnLock(JsVar *parent, JsVar *value, const char *name) {
 JsVar *jsvSetValueOfName(JsVar *name, JsVar *src) {
   assert(name && jsvIsName(name));
   assert(name!=src); // no infinite loops!
+  jspPropertyCacheValueChanged(name);
   // all is fine, so replace the existing child...
   /* Existing child may be null in the case of Z = 0 where
    * we create 'Z' and pass it down to '=' to have the value
@@ -2948,7 +3701,7 @@ JsVar *jsvSetValueOfName(JsVar *name, JsVar *src) {
           return name;
         }
       }
-    } else if (jsvIsString(name) && !jsvIsUTF8String(name)) {
+    } else if (jsvIsString(name) && !jsvIsUTF8String(name) && !jsvIsAtomName(name)) {
       if (jsvIsInt(src) && !jsvIsPin(src)) {
         JsVarInt v = src->varData.integer;
         if (v>=JSVARREF_MIN && v<=JSVARREF_MAX) {
@@ -2965,7 +3718,8 @@ JsVar *jsvSetValueOfName(JsVar *name, JsVar *src) {
   return name;
 }
 
-JsVar *jsvFindChildFromString(JsVar *parent, const char *name) {
+/// Used by jsvFindChildFromString - see jsvFindChildFromStringAtPosition
+static JsVar *jsvFindChildFromStringInternal(JsVar *parent, const char *name, unsigned char *position) {
   /* Pull out first 4 bytes, and ensure that everything
    * is 0 padded so that we can do a nice speedy check. */
   char fastCheck[4] = {0,0,0,0};
@@ -2990,17 +3744,60 @@ JsVar *jsvFindChildFromString(JsVar *parent, const char *name) {
   }
 
   assert(jsvHasChildren(parent));
+#ifndef ESPR_NO_OBJECT_INDEX
+  JsvObjectIndex *idx = jsvObjectIndexGet(parent);
+  if (idx) return jsvObjectIndexFindStr(idx, name);
+#endif
+  unsigned int childCount = 0;
+  JsVar *found = 0;
   JsVarRef childref = jsvGetFirstChild(parent);
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+  if (position && *position) {
+    /* Check the child at the position it was found last time first - objects
+     * made the same way have their fields in the same order */
+    unsigned int n = *position;
+    JsVarRef ref = childref;
+    while (ref && n--)
+      ref = jsvGetNextSibling(jsvGetAddressOf(ref));
+    if (ref) {
+      JsVar *child = jsvGetAddressOf(ref);
+      if (*(int*)fastCheck==*(int*)child->varData.str &&
+          (superFastCheck ? (!child->varData.ref.lastChild && jsvGetCharactersInVar(child)==strlen(name)) : jsvIsStringEqual(child, name)))
+        return jsvLockAgain(child);
+    }
+  }
+#endif
   if (!superFastCheck) { // more than 4 chars so we MUST use stringequal
+#ifndef ESPR_NO_ATOMS
+    /* If we find a JSV_NAME_ATOM that might match, look up the atom for 'name'
+     * once - then we only have to compare it with the atom each name links to */
+    bool atomLookedUp = false;
+    JsVarRef atom = 0;
+#endif
     while (childref) {
       // Don't Lock here, just use GetAddressOf - to try and speed up the finding
       JsVar *child = jsvGetAddressOf(childref);
-      if (*(int*)fastCheck==*(int*)child->varData.str && // speedy check of first 4 bytes
-          jsvIsStringEqual(child, name)) {
-        // found it! unlock parent but leave child locked
-        return jsvLockAgain(child);
+      if (*(int*)fastCheck==*(int*)child->varData.str) { // speedy check of first 4 bytes
+#ifndef ESPR_NO_ATOMS
+        if (jsvIsAtomName(child) && jsvAtomTable) {
+          if (!atomLookedUp) {
+            atom = jsvAtomFindStr(name);
+            atomLookedUp = true;
+          }
+          if (jsvGetLastChild(child)==atom) {
+            found = jsvLockAgain(child);
+            break;
+          }
+        } else
+#endif
+        if (jsvIsStringEqual(child, name)) {
+          // found it! unlock parent but leave child locked
+          found = jsvLockAgain(child);
+          break;
+        }
       }
       childref = jsvGetNextSibling(child);
+      childCount++;
     }
   } else { // 4 or less chars, so if 4 chars match, there is no StringExt + length matches, then we're good without jsvIsStringEqual
     size_t charsInName = 0;
@@ -3012,13 +3809,32 @@ JsVar *jsvFindChildFromString(JsVar *parent, const char *name) {
           !child->varData.ref.lastChild &&
           jsvGetCharactersInVar(child)==charsInName) { // no extra stringexts - so it really is that small
         // found it! unlock parent but leave child locked
-        return jsvLockAgain(child);
+        found = jsvLockAgain(child);
+        break;
       }
       childref = jsvGetNextSibling(child);
+      childCount++;
     }
   }
-  return 0;
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+  if (found && position) *position = (unsigned char)((childCount<=255) ? childCount : 0);
+#endif
+#ifndef ESPR_NO_OBJECT_INDEX
+  jsvObjectIndexCreateIfNeeded(parent, childCount);
+#endif
+  NOT_USED(childCount); // if built without object indices or the field position cache
+  return found;
+}
+
+JsVar *jsvFindChildFromString(JsVar *parent, const char *name) {
+  return jsvFindChildFromStringInternal(parent, name, 0);
+}
+
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+JsVar *jsvFindChildFromStringAtPosition(JsVar *parent, const char *name, unsigned char *position) {
+  return jsvFindChildFromStringInternal(parent, name, position);
 }
+#endif
 
 JsVar *jsvFindOrAddChildFromString(JsVar *parent, const char *name) {
   JsVar *child = jsvFindChildFromString(parent, name);
@@ -3083,6 +3899,24 @@ JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound)
   JsVar *child;
   JsVarRef childref = jsvGetFirstChild(parent);
 
+  if (jsvIsArray(parent) && jsvIsInt(childName)) {
+    // Integer indices of arrays are sorted, so we can search much faster
+    child = jsvGetArrayIndex(parent, childName->varData.integer);
+    if (child) return child;
+    childref = 0; // not found - don't bother searching again
+  }
+#ifndef ESPR_NO_OBJECT_INDEX
+  unsigned int childCount = 0;
+  if (jsvIsString(childName)) {
+    JsvObjectIndex *idx = jsvObjectIndexGet(parent);
+    if (idx) {
+      child = jsvObjectIndexFindVar(idx, childName);
+      if (child) return child;
+      childref = 0; // not found - don't bother searching again
+    }
+  }
+#endif
+
   // TODO: could split this into separate loops looking for Numeric/String
 
   while (childref) {
@@ -3093,7 +3927,14 @@ JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound)
     }
     childref = jsvGetNextSibling(child);
     jsvUnLock(child);
+#ifndef ESPR_NO_OBJECT_INDEX
+    childCount++;
+#endif
   }
+#ifndef ESPR_NO_OBJECT_INDEX
+  if (jsvIsString(childName))
+    jsvObjectIndexCreateIfNeeded(parent, childCount);
+#endif
 
   child = 0;
   if (addIfNotFound && childName) {
@@ -3111,6 +3952,15 @@ void jsvRemoveChild(JsVar *parent, JsVar *child) {
 #endif
   JsVarRef childref = jsvGetRef(child);
   bool wasChild = false;
+  if (jsvIsArray(parent))
+    jsvArrayIndexCacheRemoveChild(childref);
+#ifndef ESPR_NO_OBJECT_INDEX
+  JsvObjectIndex *idx = jsvObjectIndexGet(parent);
+  if (idx && jsvIsString(child))
+    jsvObjectIndexRemove(idx, child);
+#endif
+  jspPropertyCacheNameChanged(child);
+  jspScopeCacheNameChanged(child);
   // unlink from parent
   if (jsvGetFirstChild(parent) == childref) {
     jsvSetFirstChild(parent, jsvGetNextSibling(child));
@@ -3411,50 +4261,72 @@ JsVar *jsvGetArrayIndex(const JsVar *arr, JsVarInt index) {
   JsVarInt lastArrayIndex = 0;
   // Look at last non-string element!
   while (childref) {
-    JsVar *child = jsvLock(childref);
+    JsVar *child = jsvGetAddressOf(childref);
     if (jsvIsInt(child)) {
       lastArrayIndex = child->varData.integer;
       // it was the last element... sorted!
       if (lastArrayIndex == index) {
-        return child;
+        return jsvLockAgain(child);
       }
-      jsvUnLock(child);
       break;
     }
     // if not an int, keep going
     childref = jsvGetPrevSibling(child);
-    jsvUnLock(child);
   }
   // it's not in this array - don't search the whole lot...
   if (index > lastArrayIndex)
     return 0;
-  // otherwise is it more than halfway through?
+  /* Integer indices are sorted, and always come before any string
+   * indices. Start from whichever end is closest and work along */
+  bool forwards = true;
+  JsVarInt distance = index;
   if (index > lastArrayIndex/2) {
     // it's in the final half of the array (probably) - search backwards
-    while (childref) {
-      JsVar *child = jsvLock(childref);
-
-      assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
-      childref = jsvGetPrevSibling(child);
-      jsvUnLock(child);
-    }
+    forwards = false;
+    distance = lastArrayIndex - index;
   } else {
     // it's in the first half of the array (probably) - search forwards
     childref = jsvGetFirstChild(arr);
-    while (childref) {
-      JsVar *child = jsvLock(childref);
-
-      assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
-      childref = jsvGetNextSibling(child);
-      jsvUnLock(child);
+  }
+#ifndef SAVE_ON_FLASH
+  // See if we have a cached element that's nearer than the start or end
+  JsVarRef arrRef = jsvGetRef((JsVar*)arr);
+  JsvArrayIndexCacheEntry *cache = 0;
+  for (int i=0;i<JSV_ARRAY_INDEX_CACHE_SIZE;i++)
+    if (jsvArrayIndexCache[i].arr == arrRef)
+      cache = &jsvArrayIndexCache[i];
+  if (cache) {
+    JsVarInt cachedIndex = jsvGetAddressOf(cache->child)->varData.integer;
+    JsVarInt cachedDistance = (index>=cachedIndex) ? index-cachedIndex : cachedIndex-index;
+    if (cachedDistance < distance) {
+      childref = cache->child;
+      forwards = index >= cachedIndex;
     }
+  } else if (jsvIsArray(arr)) {
+    cache = &jsvArrayIndexCache[jsvArrayIndexCacheNext];
+    jsvArrayIndexCacheNext = (unsigned char)((jsvArrayIndexCacheNext+1) % JSV_ARRAY_INDEX_CACHE_SIZE);
+    cache->arr = arrRef;
+    cache->child = 0;
   }
+#endif
+  while (childref) {
+    // Don't Lock here, just use GetAddressOf - to try and speed up the finding
+    JsVar *child = jsvGetAddressOf(childref);
+    if (!jsvIsInt(child)) break; // we're into the string indices now
+    JsVarInt childIndex = child->varData.integer;
+    if (childIndex == index) {
+#ifndef SAVE_ON_FLASH
+      if (cache) cache->child = childref;
+#endif
+      return jsvLockAgain(child);
+    }
+    // sparse array and we've gone past where it should have been
+    if (forwards ? (childIndex > index) : (childIndex < index)) break;
+    childref = forwards ? jsvGetNextSibling(child) : jsvGetPrevSibling(child);
+  }
+#ifndef SAVE_ON_FLASH
+  if (cache && !cache->child) cache->arr = 0; // nothing to remember
+#endif
   return 0; // undefined
 }
 
@@ -3641,6 +4513,7 @@ JsVar *jsvArrayPopFirst(JsVar *arr) {
   assert(jsvIsArray(arr));
   if (jsvGetFirstChild(arr)) {
     JsVar *child = jsvLock(jsvGetFirstChild(arr));
+    jsvArrayIndexCacheRemoveChild(jsvGetRef(child));
     if (jsvGetFirstChild(arr) == jsvGetLastChild(arr))
       jsvSetLastChild(arr, 0); // if 1 item in array
     jsvSetFirstChild(arr, jsvGetNextSibling(child)); // unlink from end of array
@@ -3718,6 +4591,8 @@ JsVar *jsvArrayJoin(JsVar *arr, JsVar *filler, bool ignoreNull) {
 /// Insert a new element before beforeIndex, DOES NOT UPDATE INDICES
 void jsvArrayInsertBefore(JsVar *arr, JsVar *beforeIndex, JsVar *element) {
   if (beforeIndex) {
+    // indices will be out of order until the caller renumbers them
+    jsvArrayIndexCacheRemoveArray(jsvGetRef(arr));
     JsVar *idxVar = jsvMakeIntoVariableName(jsvNewFromInteger(0), element);
     if (!idxVar) return; // out of memory
 
@@ -3754,6 +4629,116 @@ JsVar *jsvMathsOpSkipNames(JsVar *a, JsVar *b, int op) {
   return res;
 }
 
+/// Is this a plain number that only the caller has a lock on, so can be overwritten with a result?
+static ALWAYS_INLINE bool jsvIsTemporaryNumber(JsVar *v) {
+  if (!v) return false;
+  JsVarFlags f = v->flags&JSV_VARTYPEMASK;
+  return (f==JSV_INTEGER || f==JSV_FLOAT) && jsvGetLocks(v)==1 && jsvGetRefs(v)==0;
+}
+
+/// Get a var of the given type to store a result in - reusing 'a' or 'b' if they're temporary
+static JsVar *jsvMathsOpResult(JsVar *a, JsVar *b, JsVarFlags type) {
+  JsVar *r = 0;
+  if (jsvIsTemporaryNumber(a)) r = a;
+  else if (jsvIsTemporaryNumber(b)) r = b;
+  if (!r) return jsvNewWithFlags(type);
+  r->flags = (JsVarFlags)((r->flags & ~JSV_VARTYPEMASK) | type);
+  return jsvLockAgain(r);
+}
+
+static JsVar *jsvMathsOpResultLongInteger(JsVar *a, JsVar *b, long long value) {
+  bool isInt = value>=-2147483648LL && value<=2147483647LL;
+  JsVar *r = jsvMathsOpResult(a, b, isInt ? JSV_INTEGER : JSV_FLOAT);
+  if (!r) return 0; // no memory
+  if (isInt) r->varData.integer = (JsVarInt)value;
+  else r->varData.floating = (JsVarFloat)value;
+  return r;
+}
+
+static JsVar *jsvMathsOpResultFloat(JsVar *a, JsVar *b, JsVarFloat value) {
+  JsVar *r = jsvMathsOpResult(a, b, JSV_FLOAT);
+  if (r) r->varData.floating = value;
+  return r;
+}
+
+static JsVar *jsvMathsOpResultBool(JsVar *a, JsVar *b, bool value) {
+  JsVar *r = jsvMathsOpResult(a, b, JSV_BOOLEAN);
+  if (r) r->varData.integer = value ? 1 : 0;
+  return r;
+}
+
+/** Fast path for jsvMathsOp when 'a' and 'b' are both plain integers or doubles.
+ * The maths is done on C values, and the result is written back into 'a' or 'b'
+ * if it is a temporary rather than allocating a new var. This must only be
+ * used when the caller is about to unlock 'a' and 'b'. Returns false (with
+ * *result untouched) if the operation isn't handled here. */
+static bool jsvMathsOpNumeric(JsVar *a, JsVar *b, int op, JsVar **result) {
+  if (!a || !b) return false;
+  JsVarFlags fa = a->flags&JSV_VARTYPEMASK;
+  JsVarFlags fb = b->flags&JSV_VARTYPEMASK;
+  if (fa==JSV_INTEGER && fb==JSV_INTEGER) {
+    JsVarInt da = a->varData.integer;
+    JsVarInt db = b->varData.integer;
+    switch (op) {
+    case '+': *result = jsvMathsOpResultLongInteger(a, b, (long long)da + (long long)db); return true;
+    case '-': *result = jsvMathsOpResultLongInteger(a, b, (long long)da - (long long)db); return true;
+    case '*': *result = jsvMathsOpResultLongInteger(a, b, (long long)da * (long long)db); return true;
+    case '/': *result = jsvMathsOpResultFloat(a, b, (JsVarFloat)da/(JsVarFloat)db); return true;
+    case '%': if (db<0) db=-db; // fix SIGFPE
+              *result = db ? jsvMathsOpResultLongInteger(a, b, da%db) : jsvMathsOpResultFloat(a, b, NAN); return true;
+    case '&': *result = jsvMathsOpResultLongInteger(a, b, da&db); return true;
+    case '|': *result = jsvMathsOpResultLongInteger(a, b, da|db); return true;
+    case '^': *result = jsvMathsOpResultLongInteger(a, b, da^db); return true;
+    case LEX_LSHIFT: *result = jsvMathsOpResultLongInteger(a, b, (JsVarInt)(da << db)); return true;
+    case LEX_RSHIFT: *result = jsvMathsOpResultLongInteger(a, b, da >> db); return true;
+    case LEX_RSHIFTUNSIGNED: *result = jsvMathsOpResultLongInteger(a, b, ((JsVarIntUnsigned)da) >> db); return true;
+    case LEX_EQUAL:
+    case LEX_TYPEEQUAL: *result = jsvMathsOpResultBool(a, b, da==db); return true;
+    case LEX_NEQUAL:
+    case LEX_NTYPEEQUAL: *result = jsvMathsOpResultBool(a, b, da!=db); return true;
+    case '<':           *result = jsvMathsOpResultBool(a, b, da<db); return true;
+    case LEX_LEQUAL:    *result = jsvMathsOpResultBool(a, b, da<=db); return true;
+    case '>':           *result = jsvMathsOpResultBool(a, b, da>db); return true;
+    case LEX_GEQUAL:    *result = jsvMathsOpResultBool(a, b, da>=db); return true;
+    default: return false;
+    }
+  } else if ((fa==JSV_INTEGER || fa==JSV_FLOAT) && (fb==JSV_INTEGER || fb==JSV_FLOAT)) {
+    JsVarFloat da = (fa==JSV_FLOAT) ? a->varData.floating : (JsVarFloat)a->varData.integer;
+    JsVarFloat db = (fb==JSV_FLOAT) ? b->varData.floating : (JsVarFloat)b->varData.integer;
+    switch (op) {
+    case '+': *result = jsvMathsOpResultFloat(a, b, da+db); return true;
+    case '-': *result = jsvMathsOpResultFloat(a, b, da-db); return true;
+    case '*': *result = jsvMathsOpResultFloat(a, b, da*db); return true;
+    case '/': *result = jsvMathsOpResultFloat(a, b, da/db); return true;
+    case '%': *result = jsvMathsOpResultFloat(a, b, jswrap_math_mod(da, db)); return true;
+    case LEX_EQUAL:
+    case LEX_TYPEEQUAL: *result = jsvMathsOpResultBool(a, b, da==db); return true;
+    case LEX_NEQUAL:
+    case LEX_NTYPEEQUAL: *result = jsvMathsOpResultBool(a, b, da!=db); return true;
+    case '<':           *result = jsvMathsOpResultBool(a, b, da<db); return true;
+    case LEX_LEQUAL:    *result = jsvMathsOpResultBool(a, b, da<=db); return true;
+    case '>':           *result = jsvMathsOpResultBool(a, b, da>db); return true;
+    case LEX_GEQUAL:    *result = jsvMathsOpResultBool(a, b, da>=db); return true;
+    default: return false; // bitwise ops need jsvGetInteger's conversion
+    }
+  }
+  return false;
+}
+
+/** Same as jsvMathsOpSkipNames, but 'a' and 'b' are unlocked. As they are
+ * consumed, if both are numbers and one is a temporary (eg. the result of a
+ * previous operation in a chain like `a*b+c*d`) the result is stored in it
+ * rather than allocating a new var. */
+JsVar *jsvMathsOpSkipNamesAndUnLock(JsVar *a, JsVar *b, int op) {
+  JsVar *pa = jsvSkipNameAndUnLock(a);
+  JsVar *pb = jsvSkipNameAndUnLock(b);
+  JsVar *res;
+  if (!jsvMathsOpNumeric(pa, pb, op, &res))
+    res = jsvMathsOpSkipNames(pa, pb, op);
+  jsvUnLock2(pa, pb);
+  return res;
+}
+
 
 JsVar *jsvMathsOpError(int op, const char *datatype) {
   char opName[32];
@@ -3942,10 +4927,8 @@ JsVar *jsvMathsOp(JsVar *a, JsVar *b, int op) {
 }
 
 JsVar *jsvNegateAndUnLock(JsVar *v) {
-  JsVar *zero = jsvNewFromInteger(0);
-  JsVar *res = jsvMathsOpSkipNames(zero, v, '-');
-  jsvUnLock2(zero, v);
-  return res;
+  // the zero we create here is temporary, so for numbers it'll be reused for the result
+  return jsvMathsOpSkipNamesAndUnLock(jsvNewFromInteger(0), v, '-');
 }
 
 /// see jsvGetPathTo
@@ -4154,47 +5137,159 @@ void jsvTrace(JsVar *var, int indent) {
 }
 
 
-/** Recursively mark the variable. Return false if it fails due to stack. */
-static bool jsvGarbageCollectMarkUsed(JsVar *var) {
+/// Mark a var (and any StringExts) as used. Returns false if it was already marked
+static ALWAYS_INLINE bool jsvGarbageCollectMarkVar(JsVar *var) {
+  if (!(var->flags & JSV_GARBAGE_COLLECT)) return false;
   var->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
-  JsVarRef child;
-  JsVar *childVar;
-
   if (jsvHasStringExt(var)) {
     // non-recursively scan strings
-    child = jsvGetLastChild(var);
+    JsVarRef child = jsvGetLastChild(var);
     while (child) {
-      childVar = jsvGetAddressOf(child);
+      JsVar *childVar = jsvGetAddressOf(child);
       childVar->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
       child = jsvGetLastChild(childVar);
     }
   }
-  // intentionally no else
-  if (jsvHasSingleChild(var)) {
-    if (jsvGetFirstChild(var)) {
-      childVar = jsvGetAddressOf(jsvGetFirstChild(var));
-      if (childVar->flags & JSV_GARBAGE_COLLECT)
-        if (!jsvGarbageCollectMarkUsed(childVar)) return false;
-    }
-  } else if (jsvHasChildren(var)) {
-    if (jsuGetFreeStack() < 256) return false;
+  return true;
+}
 
-    child = jsvGetFirstChild(var);
-    while (child) {
-      childVar = jsvGetAddressOf(child);
-      if (childVar->flags & JSV_GARBAGE_COLLECT)
-        if (!jsvGarbageCollectMarkUsed(childVar)) return false;
-      child = jsvGetNextSibling(childVar);
+/// Does this var link to others with firstChild (jsvHasSingleChild || jsvHasChildren)? Inlined as it's used so much
+static ALWAYS_INLINE bool jsvGarbageCollectHasLinks(const JsVar *v) {
+  char f = v->flags&JSV_VARTYPEMASK;
+  return JSV_IS_FUNCTION(f) || JSV_IS_OBJECT(f) || JSV_IS_ARRAY(f) ||
+         JSV_IS_ROOT(f) || JSV_IS_GETTER_OR_SETTER(f) || JSV_IS_ARRAYBUFFER(f) ||
+         (JSV_IS_NAME(f) && !JSV_IS_NAME_WITH_VALUE(f));
+}
+
+/** Put a var on the mark stack. Names on the stack are a list of children
+ * that's partly been marked, anything else needs its children marking */
+static ALWAYS_INLINE void jsvGarbageCollectPush(JsVarRef ref) {
+  if (jsvGCMarkStackCount < JSV_GC_MARK_STACK_SIZE)
+    jsvGCMarkStack[jsvGCMarkStackCount++] = ref;
+  else // no space - we'll find it when we rescan
+    jsvGCMarkStackOverflowed = true;
+}
+
+/// Mark a var as used, and if it links to other vars put it on the mark stack so they get marked too
+static void jsvGarbageCollectMarkRef(JsVarRef ref) {
+  assert(ref && ref<=jsVarsSize);
+  JsVar *var = jsvGetAddressOf(ref);
+  // names just link to one value, so mark that too rather than using the stack
+  while (jsvIsName(var) && jsvHasSingleChild(var)) {
+    if (!jsvGarbageCollectMarkVar(var) || !jsvGetFirstChild(var)) return;
+    ref = jsvGetFirstChild(var);
+    var = jsvGetAddressOf(ref);
+  }
+  if (!jsvGarbageCollectMarkVar(var)) return;
+  if (jsvGarbageCollectHasLinks(var))
+    jsvGarbageCollectPush(ref);
+}
+
+/** Mark a list of children (which are all names) and what they link to.
+ * When a child links to something with children of its own we mark that
+ * first, and put the rest of the list on the stack. That way the stack only
+ * gets deeper as objects nest, and not for big arrays of objects. Returns
+ * how many vars were looked at. */
+static unsigned int jsvGarbageCollectMarkList(JsVarRef child) {
+  unsigned int count = 0;
+  while (child) {
+    JsVar *childVar = jsvGetAddressOf(child);
+    jsvGarbageCollectMarkVar(childVar);
+    child = jsvGetNextSibling(childVar);
+    count++;
+    if (jsvHasSingleChild(childVar) && jsvGetFirstChild(childVar)) {
+      JsVarRef valueRef = jsvGetFirstChild(childVar);
+      JsVar *value = jsvGetAddressOf(valueRef);
+      if (child && (value->flags & JSV_GARBAGE_COLLECT) &&
+          jsvGarbageCollectHasLinks(value) &&
+          jsvGCMarkStackCount+2 <= JSV_GC_MARK_STACK_SIZE) {
+        jsvGarbageCollectPush(child); // do the rest of the list afterwards
+        jsvGarbageCollectMarkRef(valueRef);
+        return count;
+      }
+      jsvGarbageCollectMarkRef(valueRef);
     }
   }
+  return count;
+}
 
-  return true;
+/// Mark everything that this (already marked) var links to. Returns how many vars were looked at
+static unsigned int jsvGarbageCollectMarkChildren(JsVar *var) {
+  if (jsvHasSingleChild(var)) {
+    if (jsvGetFirstChild(var))
+      jsvGarbageCollectMarkRef(jsvGetFirstChild(var));
+  } else if (jsvHasChildren(var))
+    return 1+jsvGarbageCollectMarkList(jsvGetFirstChild(var));
+  return 1;
+}
+
+/** Mark everything that is referenced from a var that is locked. Stops after
+ * looking at roughly maxBlocks vars (or never if 0), and returns true if
+ * marking is complete. */
+static bool jsvGarbageCollectMark(unsigned int maxBlocks) {
+  unsigned int blocks = 0;
+  while (!maxBlocks || blocks<maxBlocks) {
+    if (jsvGCMarkStackCount) {
+      JsVarRef ref = jsvGCMarkStack[--jsvGCMarkStackCount];
+      if (!ref) continue; // ref=0 if it was freed while in the stack
+      JsVar *var = jsvGetAddressOf(ref);
+      if (jsvIsName(var)) // part way through a list of children
+        blocks += jsvGarbageCollectMarkList(ref);
+      else
+        blocks += jsvGarbageCollectMarkChildren(var);
+    } else if (jsvGCCursor <= jsVarsSize) {
+      JsVar *var = jsvGetAddressOf(jsvGCCursor);
+      if (jsvGCPhase == JSVGC_ROOTS) {
+        if ((var->flags & JSV_GARBAGE_COLLECT) && // not already marked
+            jsvGetLocks(var)>0) // and it is locked
+          jsvGarbageCollectMarkRef(jsvGCCursor);
+      } else { // JSVGC_RESCAN - anything that's marked may have children we didn't get to
+        if ((var->flags&JSV_VARTYPEMASK) != JSV_UNUSED &&
+            !(var->flags & JSV_GARBAGE_COLLECT))
+          jsvGarbageCollectMarkChildren(var);
+      }
+      // if we have a flat string, skip that many blocks
+      if (jsvIsFlatString(var))
+        jsvGCCursor = (JsVarRef)(jsvGCCursor+jsvGetFlatStringBlocks(var));
+      jsvGCCursor++;
+      blocks++;
+    } else if (jsvGCMarkStackOverflowed) {
+      // The stack wasn't big enough (eg. a big array of objects), so go over everything again
+      jsvGCMarkStackOverflowed = false;
+      jsvGCPhase = JSVGC_RESCAN;
+      jsvGCCursor = 1;
+    } else
+      return true;
+  }
+  return false;
 }
 
-/** Run a garbage collection sweep - return nonzero if things have been freed */
-int jsvGarbageCollect() {
-  if (isMemoryBusy) return 0;
-  isMemoryBusy = MEMBUSY_GC;
+/// Mark this var and everything that can be reached from it
+static void jsvGarbageCollectMarkFrom(JsVarRef ref) {
+  jsvGarbageCollectMarkRef(ref);
+  jsvGCPhase = JSVGC_RESCAN;
+  jsvGCCursor = (JsVarRef)(jsVarsSize+1); // nothing to scan unless the stack overflows
+  jsvGarbageCollectMark(0);
+  jsvGCPhase = JSVGC_IDLE;
+}
+
+#ifndef ESPR_NO_EVENT_RING
+static JsVarRef jsvGarbageCollectMarkEvent(JsVarRef ref, void *data) {
+  NOT_USED(data);
+  jsvGarbageCollectMarkRef(ref);
+  return ref;
+}
+#endif
+
+/// Mark vars that are referenced natively (rather than by being locked or from another var)
+static void jsvGarbageCollectMarkNative() {
+#ifndef ESPR_NO_EVENT_RING
+  jsiEventRingUpdateRefs(jsvGarbageCollectMarkEvent, NULL);
+#endif
+}
+
+/// Start a garbage collection by flagging everything as something that might be freed
+static void jsvGarbageCollectStart() {
   JsVarRef i;
   // Add GC flags to anything that is currently used
   for (i=1;i<=jsVarsSize;i++)  {
@@ -4206,22 +5301,76 @@ int jsvGarbageCollect() {
         i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
     }
   }
-  /* recursively remove anything that is referenced from a var that is locked. */
-  for (i=1;i<=jsVarsSize;i++)  {
-    JsVar *var = jsvGetAddressOf(i);
-    if ((var->flags & JSV_GARBAGE_COLLECT) && // not already GC'd
-        jsvGetLocks(var)>0) { // or it is locked
-      if (!jsvGarbageCollectMarkUsed(var)) {
-        // this could fail due to stack exhausted (eg big linked list)
-        // JSV_GARBAGE_COLLECT are left set, but not a big problem as next GC will clear them
-        isMemoryBusy = MEM_NOT_BUSY;
-        return 0;
-      }
-    }
-    // if we have a flat string, skip that many blocks
-    if (jsvIsFlatString(var))
-      i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+  jsvGCPhase = JSVGC_ROOTS;
+  jsvGCCursor = 1;
+  jsvGCMarkStackCount = 0;
+  jsvGCMarkStackOverflowed = false;
+#ifndef ESPR_NO_INCREMENTAL_GC
+  jsvGCIncremental = false;
+#endif
+  jsvGarbageCollectMarkNative();
+}
+
+static int jsvGarbageCollectSweep();
+
+#ifndef ESPR_NO_INCREMENTAL_GC
+static void jsvGarbageCollectWriteBarrier(JsVar *v, JsVarRef r) {
+  // if 'v' isn't marked yet, 'r' will be marked when 'v' is (if 'v' is still used)
+  if (v->flags & JSV_GARBAGE_COLLECT) return;
+  if (jsvIsName(jsvGetAddressOf(r))) {
+    /* A list of children changed, and we may have been part way through
+     * marking it - so mark everything from here to the end of the list */
+    jsvGarbageCollectPush(r);
+  } else
+    jsvGarbageCollectMarkRef(r);
+}
+
+bool jsvGarbageCollectInProgress() {
+  return jsvGCPhase != JSVGC_IDLE;
+}
+
+bool jsvGarbageCollectStep(unsigned int maxBlocks) {
+  if (isMemoryBusy) return jsvGCPhase != JSVGC_IDLE;
+  isMemoryBusy = MEMBUSY_GC;
+  if (jsvGCPhase == JSVGC_IDLE)
+    jsvGarbageCollectStart();
+  else
+    jsvGCIncremental = true; // JS code may have run since the last step
+  if (!jsvGarbageCollectMark(maxBlocks)) {
+    isMemoryBusy = MEM_NOT_BUSY;
+    return true;
   }
+  if (jsvGCIncremental) {
+    /* Anything JS code linked to from an already marked var has been marked
+     * by the write barrier, but vars that got locked (and new vars) still
+     * need checking, so go over the locks again */
+    jsvGCPhase = JSVGC_ROOTS;
+    jsvGCCursor = 1;
+    jsvGarbageCollectMarkNative();
+    jsvGarbageCollectMark(0);
+  }
+  jsvGarbageCollectSweep();
+  return false;
+}
+#endif
+
+/** Run a garbage collection sweep - return nonzero if things have been freed */
+int jsvGarbageCollect() {
+  if (isMemoryBusy) return 0;
+  isMemoryBusy = MEMBUSY_GC;
+  /* Start from scratch even if jsvGarbageCollectStep was part way through, as
+   * it'd miss anything that stopped being used since it started */
+  jsvGarbageCollectStart();
+  /* remove anything that is referenced from a var that is locked. We use a
+   * stack of vars rather than recursion, so even big linked lists get marked */
+  jsvGarbageCollectMark(0);
+  return jsvGarbageCollectSweep();
+}
+
+/// Free everything that wasn't marked by jsvGarbageCollectMark, and rebuild the free list
+static int jsvGarbageCollectSweep() {
+  JsVarRef i;
+  jsvGCPhase = JSVGC_IDLE;
   /* now sweep for things that we can GC!
    * Also update the free list - this means that every new variable that
    * gets allocated gets allocated towards the start of memory, which
@@ -4268,6 +5417,19 @@ int jsvGarbageCollect() {
               jsvUnRef(child);
           }
         }
+#ifndef ESPR_NO_ATOMS
+        if (jsvIsAtomName(var)) {
+          /* Same for the atom, which other names may still be using. Don't
+           * free it here even if this was the last reference (we'd add it to
+           * the free list twice) - jsvAtomTableFreeUnused removes it from the
+           * table, and it'll be freed when unlocked or by the next GC */
+          JsVar *atom = jsvGetAddressOf(jsvGetLastChild(var)); // not locked
+          JsVarRefCounter refs = jsvGetRefs(atom);
+          if (atom->flags!=JSV_UNUSED && !(atom->flags&JSV_GARBAGE_COLLECT) &&
+              refs && refs<JSVARREFCOUNT_MAX)
+            jsvSetRefs(atom, (JsVarRefCounter)(refs-1));
+        }
+#endif
         /* Sanity checks here. We're making sure that any variables that are
          * linked from this one have either already been garbage collected or
          * are marked for GC */
@@ -4306,18 +5468,142 @@ int jsvGarbageCollect() {
     }
   }
   if (lastEmpty) jsvSetNextSibling(lastEmpty, 0);
+  // cached array elements and lookups may refer to vars that have just been freed
+  if (freedCount) {
+    jsvArrayIndexCacheClear();
+    jsvStringEndCacheClear();
+    jspPropertyCacheClear();
+    jspScopeCacheClear();
+  }
   isMemoryBusy = MEM_NOT_BUSY;
+  // if any indexed objects were freed, remove their indices too
+  if (freedCount) jsvObjectIndexFreeUnused();
+  // atoms can also be removed outside of GC, so always check (this frees the table if it's empty)
+  jsvAtomTableFreeUnused();
   return (int)freedCount;
 }
 
 #ifndef SAVE_ON_FLASH
+#ifndef ESPR_NO_EVENT_RING
+static JsVarRef jsvDefragmentUpdateEventRef(JsVarRef ref, void *data) {
+  JsVarRef *fromTo = (JsVarRef*)data;
+  return (ref==fromTo[0]) ? fromTo[1] : ref;
+}
+#endif
+
+/// Update any references to 'fromRef' so they point to 'toRef' instead
+static void jsvDefragmentUpdateRefs(JsVarRef fromRef, JsVarRef toRef) {
+#ifndef ESPR_NO_EVENT_RING
+  JsVarRef fromTo[2] = {fromRef, toRef};
+  jsiEventRingUpdateRefs(jsvDefragmentUpdateEventRef, fromTo);
+#endif
+  for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
+    JsVarRef vr = (JsVarRef)(i+1);
+    JsVar *v = _jsvGetAddressOf(vr);
+    if ((v->flags&JSV_VARTYPEMASK)!=JSV_UNUSED) {
+      if (jsvIsFlatString(v)) {
+        i += (unsigned int)jsvGetFlatStringBlocks(v); // skip forward
+      } else {
+        if (jsvHasSingleChild(v))
+          if (jsvGetFirstChild(v)==fromRef)
+            jsvSetFirstChild(v,toRef);
+        if (jsvHasStringExt(v))
+          if (jsvGetLastChild(v)==fromRef)
+            jsvSetLastChild(v,toRef);
+        if (jsvHasChildren(v)) {
+          if (jsvGetFirstChild(v)==fromRef)
+            jsvSetFirstChild(v,toRef);
+          if (jsvGetLastChild(v)==fromRef)
+            jsvSetLastChild(v,toRef);
+        }
+        if (jsvIsName(v)) {
+          if (jsvGetNextSibling(v)==fromRef)
+            jsvSetNextSibling(v,toRef);
+          if (jsvGetPrevSibling(v)==fromRef)
+            jsvSetPrevSibling(v,toRef);
+        }
+      }
+    }
+  }
+}
+
+/* Can the flat string 'ref' be moved? Not if it's locked, or if whatever
+ * references it (eg. an ArrayBuffer) is locked, as then native code may have
+ * a pointer to its data. Strings used by Waveforms are also left alone as the
+ * utility timer reads them from an IRQ. */
+static bool jsvDefragmentCanMoveFlatString(JsVarRef ref) {
+  JsVar *flatString = _jsvGetAddressOf(ref);
+  if (jsvGetLocks(flatString)) return false;
+  UtilTimerTask task;
+  if (jstGetLastBufferTimerTask(flatString, &task)) return false;
+  for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
+    JsVar *v = _jsvGetAddressOf((JsVarRef)(i+1));
+    if ((v->flags&JSV_VARTYPEMASK)!=JSV_UNUSED) {
+      if (jsvIsFlatString(v)) {
+        i += (unsigned int)jsvGetFlatStringBlocks(v); // skip forward
+      } else if (jsvGetLocks(v) &&
+                 (((jsvHasSingleChild(v) || jsvHasChildren(v)) && jsvGetFirstChild(v)==ref) ||
+                  (jsvHasChildren(v) && jsvGetLastChild(v)==ref)))
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Move any flat strings that we can down into free space below them
+static void jsvDefragmentFlatStrings() {
+  for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
+    JsVarRef fromRef = (JsVarRef)(i+1);
+    JsVar *from = _jsvGetAddressOf(fromRef);
+    if ((from->flags&JSV_VARTYPEMASK)==JSV_UNUSED) continue;
+    if (!jsvIsFlatString(from)) continue;
+    size_t dataBlocks = jsvGetFlatStringBlocks(from);
+    i += (unsigned int)dataBlocks; // skip forward
+    size_t blocks = 1+dataBlocks;
+    if (!jsvFindFreeRun(blocks, fromRef) || !jsvDefragmentCanMoveFlatString(fromRef))
+      continue;
+    jshInterruptOff();
+    // check again, in case anything was allocated from an IRQ
+    JsVarRef toRef = jsvFindFreeRun(blocks, fromRef);
+    if (!toRef) {
+      jshInterruptOn();
+      continue;
+    }
+    // relocate! (the areas may overlap)
+    JsVar *to = _jsvGetAddressOf(toRef);
+    memmove(to, from, blocks*sizeof(JsVar));
+    // blocks that are no longer covered by the string are now free
+    JsVarRef r = (JsVarRef)(toRef+blocks);
+    if (r<fromRef) r = fromRef;
+    while (r<fromRef+blocks)
+      _jsvGetAddressOf(r++)->flags = JSV_UNUSED;
+    jsvDefragmentUpdateRefs(fromRef, toRef);
+    // fix up any native strings (eg. from E.memoryArea) that point into its data
+    jsvUpdateMemoryAddress((size_t)&from[1], dataBlocks*sizeof(JsVar), (size_t)&to[1]);
+    // the blocks we used were in the free list, and the ones we freed weren't
+    jsvCreateEmptyVarList();
+    jshInterruptOn();
+    // bump watchdog just in case it took too long
+    jshKickWatchDog();
+    jshKickSoftWatchDog();
+  }
+}
+
 void jsvDefragment() {
   /* FIXME: we should surely be able to go through without `defragVars`,
-  and just work from the beginning to the end. We really need to be able
-  to move flat strings: https://github.com/espruino/Espruino/issues/1740 */
+  and just work from the beginning to the end. */
+  // object indices and the atom table store references to vars that are about to move
+  jsvObjectIndexFreeAll();
+  jsvAtomTableFree();
   // garbage collect - removes cruft
   // also puts free list in order
   jsvGarbageCollect();
+  // vars are about to move, so any cached array elements or lookups will be wrong
+  jsvArrayIndexCacheClear();
+  jsvStringEndCacheClear();
+  jspPropertyCacheClear();
+  jspScopeCacheClear();
+  jsiWatchesChanged();
   // Fill defragVars with defraggable variables
   jshInterruptOff();
   const int DEFRAGVARS = 256; // POWER OF 2
@@ -4355,34 +5641,7 @@ void jsvDefragment() {
     *defragTo = *defragFrom;
     defragFrom->flags = JSV_UNUSED;
     // find references!
-    for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
-      JsVarRef vr = (JsVarRef)(i+1);
-      JsVar *v = _jsvGetAddressOf(vr);
-      if ((v->flags&JSV_VARTYPEMASK)!=JSV_UNUSED) {
-        if (jsvIsFlatString(v)) {
-          i += (unsigned int)jsvGetFlatStringBlocks(v); // skip forward
-        } else {
-          if (jsvHasSingleChild(v))
-            if (jsvGetFirstChild(v)==defragFromRef)
-              jsvSetFirstChild(v,defragToRef);
-          if (jsvHasStringExt(v))
-            if (jsvGetLastChild(v)==defragFromRef)
-              jsvSetLastChild(v,defragToRef);
-          if (jsvHasChildren(v)) {
-            if (jsvGetFirstChild(v)==defragFromRef)
-              jsvSetFirstChild(v,defragToRef);
-            if (jsvGetLastChild(v)==defragFromRef)
-              jsvSetLastChild(v,defragToRef);
-          }
-          if (jsvIsName(v)) {
-            if (jsvGetNextSibling(v)==defragFromRef)
-              jsvSetNextSibling(v,defragToRef);
-            if (jsvGetPrevSibling(v)==defragFromRef)
-              jsvSetPrevSibling(v,defragToRef);
-          }
-        }
-      }
-    }
+    jsvDefragmentUpdateRefs(defragFromRef, defragToRef);
     // zero element and move to next...
     defragVars[defragVarIdx] = 0;
     defragVarIdx--;
@@ -4394,6 +5653,172 @@ void jsvDefragment() {
   // rebuild free var list
   jsvCreateEmptyVarList();
   jshInterruptOn();
+  // now single vars have moved down, move flat strings down into any space left
+  jsvDefragmentFlatStrings();
+}
+#endif
+
+#ifndef ESPR_NO_NURSERY
+/* If 'ref' is a var in the nursery that jsvNurseryCollect has moved, return
+ * where it moved to. Moved vars are marked unused, with nextSibling set to
+ * their new location. */
+static ALWAYS_INLINE JsVarRef jsvNurseryForward(JsVarRef ref, JsVarRef nurserySize) {
+  if (ref && ref<=nurserySize) {
+    JsVar *v = jsvGetAddressOf(ref);
+    if ((v->flags&JSV_VARTYPEMASK)==JSV_UNUSED)
+      return jsvGetNextSibling(v);
+  }
+  return ref;
+}
+
+#ifndef ESPR_NO_EVENT_RING
+static JsVarRef jsvNurseryForwardEventRef(JsVarRef ref, void *data) {
+  return jsvNurseryForward(ref, *(JsVarRef*)data);
+}
+#endif
+
+static bool jsvNurseryBufferTaskChecker(UtilTimerTask *task, void *data) {
+  NOT_USED(data);
+  return UET_IS_BUFFER_EVENT(task->type);
+}
+
+/* Called for each var jsvNurseryCollect looks at. Every JS_NURSERY_IRQ_BLOCKS
+ * vars, let any pending interrupts run so we don't delay them for the whole
+ * collection. isMemoryBusy is still set, so they can't allocate vars. */
+static void jsvNurseryInterruptStep(unsigned int *count) {
+  if (++*count < JS_NURSERY_IRQ_BLOCKS) return;
+  *count = 0;
+  jshInterruptOn();
+  jshInterruptOff();
+}
+
+/* The first 1/JS_NURSERY_FRACTION of memory is a 'nursery'. Freed vars are
+ * pushed onto the front of the free list, so it is only in address order just
+ * after it has been rebuilt (by GC, defrag, or at the end of this function).
+ * From then on new vars get allocated in the nursery first, and most of them
+ * (temporary values, strings, arguments) are freed again almost immediately,
+ * so get reused before we move on to blocks further up.
+ * When idle, if a lot of vars have survived in the nursery we move them out
+ * into the first free blocks after it. This keeps the nursery free for new
+ * vars, and stops short-lived vars being scattered in between long-lived ones.
+ * Updating references means looking at every var, so this is only done if
+ * JSF_NURSERY is set, and interrupts are let in every JS_NURSERY_IRQ_BLOCKS vars.
+ * Returns true if anything was moved. */
+bool jsvNurseryCollect() {
+  if (isMemoryBusy || jsvGCPhase!=JSVGC_IDLE) return false;
+  // Waveforms read their buffers from an IRQ, so don't move anything while they're running
+  UtilTimerTask task;
+  if (utilTimerGetLastTask(jsvNurseryBufferTaskChecker, NULL, &task)) return false;
+  JsVarRef nurserySize = (JsVarRef)(jsVarsSize / JS_NURSERY_FRACTION);
+  JsVarRef i;
+  // Count vars that could be moved - if there aren't many it's not worth it
+  unsigned int movable = 0;
+  for (i=1;i<=nurserySize;i++) {
+    JsVar *v = jsvGetAddressOf(i);
+    if ((v->flags&JSV_VARTYPEMASK)==JSV_UNUSED) continue;
+    if (jsvIsFlatString(v))
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(v)); // skip over flat strings - we don't move them
+    else if (!jsvGetLocks(v)) // locked vars may have pointers to them, so can't be moved
+      movable++;
+  }
+  if (movable < (unsigned int)nurserySize/4) return false;
+  isMemoryBusy = MEMBUSY_SYSTEM;
+  /* Like jsvDefragment, keep interrupts off while vars are moving - except
+   * for short gaps in jsvNurseryInterruptStep */
+  jshInterruptOff();
+  unsigned int irqCount = 0;
+  // Move vars out of the nursery
+  JsVarRef to = 0;
+  unsigned int moved = 0;
+  for (i=1;i<=nurserySize;i++) {
+    jsvNurseryInterruptStep(&irqCount);
+    JsVar *v = jsvGetAddressOf(i);
+    if ((v->flags&JSV_VARTYPEMASK)==JSV_UNUSED) continue;
+    if (jsvIsFlatString(v)) {
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(v));
+      continue;
+    }
+    if (jsvGetLocks(v)) continue;
+    /* find the next free block after the nursery (searching from the start
+     * so we skip over any flat string that crosses the end of it) */
+    JsVar *dst = 0;
+    while (++to <= jsVarsSize) {
+      jsvNurseryInterruptStep(&irqCount);
+      dst = jsvGetAddressOf(to);
+      if ((dst->flags&JSV_VARTYPEMASK)==JSV_UNUSED) {
+        if (to > nurserySize) break;
+        continue;
+      }
+      if (jsvIsFlatString(dst))
+        to = (JsVarRef)(to+jsvGetFlatStringBlocks(dst));
+    }
+    if (to > jsVarsSize) break; // no space left
+    *dst = *v;
+    v->flags = JSV_UNUSED;
+    jsvSetNextSibling(v, to); // so we can find where it went
+    moved++;
+  }
+  if (!moved) {
+    isMemoryBusy = MEM_NOT_BUSY;
+    jshInterruptOn();
+    return false;
+  }
+  // Now update any references to the vars we moved
+  for (i=1;i<=jsVarsSize;i++) {
+    jsvNurseryInterruptStep(&irqCount);
+    JsVar *v = jsvGetAddressOf(i);
+    if ((v->flags&JSV_VARTYPEMASK)==JSV_UNUSED) continue;
+    if (jsvIsFlatString(v)) {
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(v));
+      continue;
+    }
+    if (jsvHasSingleChild(v) || jsvHasChildren(v))
+      jsvSetFirstChild(v, jsvNurseryForward(jsvGetFirstChild(v), nurserySize));
+    if (jsvHasStringExt(v) || jsvHasChildren(v))
+      jsvSetLastChild(v, jsvNurseryForward(jsvGetLastChild(v), nurserySize));
+    if (jsvIsName(v)) {
+      jsvSetNextSibling(v, jsvNurseryForward(jsvGetNextSibling(v), nurserySize));
+      jsvSetPrevSibling(v, jsvNurseryForward(jsvGetPrevSibling(v), nurserySize));
+    }
+  }
+  timerArray = jsvNurseryForward(timerArray, nurserySize);
+  watchArray = jsvNurseryForward(watchArray, nurserySize);
+#ifndef ESPR_NO_EVENT_RING
+  jsiEventRingUpdateRefs(jsvNurseryForwardEventRef, &nurserySize);
+#endif
+#ifndef ESPR_NO_OBJECT_INDEX
+  for (int n=0;n<JSV_OBJECT_INDEX_COUNT;n++) {
+    JsvObjectIndex *idx = &jsvObjectIndices[n];
+    if (!idx->obj) continue;
+    idx->obj = jsvGetAddressOf(jsvNurseryForward(jsvGetRef(idx->obj), nurserySize));
+    unsigned int mask;
+    JsVarRef *slots = jsvObjectIndexGetSlots(idx, &mask);
+    for (unsigned int s=0;s<=mask;s++)
+      slots[s] = jsvNurseryForward(slots[s], nurserySize);
+  }
+#endif
+#ifndef ESPR_NO_ATOMS
+  if (jsvAtomTable) {
+    unsigned int mask;
+    JsVarRef *slots = jsvAtomTableGetSlots(&mask);
+    for (unsigned int s=0;s<=mask;s++)
+      slots[s] = jsvNurseryForward(slots[s], nurserySize);
+  }
+#endif
+  isMemoryBusy = MEM_NOT_BUSY;
+  // the blocks we moved to were in the free list, and the ones we moved from weren't
+  jsvCreateEmptyVarList();
+  jshInterruptOn();
+  // bump watchdog just in case it took too long
+  jshKickWatchDog();
+  jshKickSoftWatchDog();
+  // vars have moved, so any cached array elements or lookups will be wrong
+  jsvArrayIndexCacheClear();
+  jsvStringEndCacheClear();
+  jspPropertyCacheClear();
+  jspScopeCacheClear();
+  jsiWatchesChanged();
+  return true;
 }
 #endif
 
@@ -4414,13 +5839,13 @@ void jsvDumpLockedVars() {
     }
   }
   // Add global
-  jsvGarbageCollectMarkUsed(execInfo.root);
+  jsvGarbageCollectMarkFrom(jsvGetRef(execInfo.root));
   // Now dump any that aren't used!
   for (i=1;i<=jsVarsSize;i++)  {
     JsVar *var = jsvGetAddressOf(i);
     if ((var->flags&JSV_VARTYPEMASK) != JSV_UNUSED) {
       if (var->flags & JSV_GARBAGE_COLLECT) {
-        jsvGarbageCollectMarkUsed(var);
+        jsvGarbageCollectMarkFrom(i);
         jsvTrace(var, 0);
       }
       // if we have a flat string, skip that many blocks
@@ -67,6 +67,9 @@ typedef enum {
   _JSV_NAME_WITH_VALUE_END = JSV_NAME_STRING_INT_MAX, ///< ---------- End of names that have literal values, NOT references, in firstChild
 #ifdef ESPR_UNICODE_SUPPORT
     JSV_NAME_UTF8_STRING, ///< UTF8 name that just points to a normal string with lastChild, but just tag that the string is a unicode one
+#endif
+#ifndef ESPR_NO_ATOMS
+    JSV_NAME_ATOM, ///< Long name that keeps its first characters inline, but points to a shared 'atom' string with all the characters with lastChild
 #endif
     JSV_NAME_STRING_0, // array/object index as string of length 0
     JSV_NAME_STRING_MAX  = JSV_NAME_STRING_0+JSVAR_DATA_STRING_NAME_LEN,
@@ -297,7 +300,10 @@ void jsvSoftKill(); ///< called when saving to flash - clears empty list to ensu
 JsVar *jsvFindOrCreateRoot(); ///< Find or create the ROOT variable item - used mainly if recovering from a saved state.
 unsigned int jsvGetMemoryUsage(); ///< Get number of memory records (JsVars) used
 unsigned int jsvGetMemoryTotal(); ///< Get total amount of memory records
+unsigned int jsvGetLargestFreeRun(unsigned int *runCount); ///< Get the size of the largest run of contiguous free blocks (roughly the biggest flat string that can be allocated), and optionally how many separate runs there are
 bool jsvIsMemoryFull(); ///< Get whether memory is full or not
+unsigned int jsvGetIndexedObjectCount(); ///< Get the number of objects that have a hash index of their children (see jsvFindChildFromString)
+unsigned int jsvGetAtomCount(); ///< Get the number of atoms - strings shared between long names (see jsvMakeIntoVariableName)
 bool jsvMoreFreeVariablesThan(unsigned int vars); ///< Return whether there are more free variables than the parameter (faster than checking no of vars used)
 void jsvShowAllocated(); ///< Show what is still allocated, for debugging memory problems
 /// Try and allocate more memory - only works if RESIZABLE_JSVARS is defined
@@ -407,6 +413,7 @@ bool jsvIsFloat(const JsVar *v);
 bool jsvIsBoolean(const JsVar *v);
 bool jsvIsString(const JsVar *v); ///< String, or a NAME too
 bool jsvIsUTF8String(const JsVar *v); ///< Just a unicode string (UTF8 JsVar, pointing to a string)
+bool jsvIsAtomName(const JsVar *v); ///< A long name that points to a shared atom string (see jsvAtomTable)
 bool jsvIsBasicString(const JsVar *v); ///< Just a string (NOT a name)
 bool jsvIsStringExt(const JsVar *v); ///< The extra bits dumped onto the end of a string to store more data
 bool jsvIsFlatString(const JsVar *v);
@@ -664,6 +671,8 @@ JsVar *jsvAsName(JsVar *var);
 
 /// MATHS!
 JsVar *jsvMathsOpSkipNames(JsVar *a, JsVar *b, int op);
+/// Same as jsvMathsOpSkipNames, but unlocks a and b (allowing a temporary number to be reused for the result)
+JsVar *jsvMathsOpSkipNamesAndUnLock(JsVar *a, JsVar *b, int op);
 bool jsvMathsOpTypeEqual(JsVar *a, JsVar *b);
 JsVar *jsvMathsOp(JsVar *a, JsVar *b, int op);
 /// Negates an integer/double value
@@ -685,6 +694,11 @@ JsVar *jsvAddNamedChild(JsVar *parent, JsVar *value, const char *name); // Add a
 void jsvAddNamedChildAndUnLock(JsVar *parent, JsVar *value, const char *name); // Add a child, and create a name for it AND unlock the value and name. DOES NOT CHECK FOR DUPLICATES
 JsVar *jsvSetValueOfName(JsVar *name, JsVar *src); // Set the value of a child created with jsvAddName,jsvAddNamedChild. Returns the UNLOCKED name argument
 JsVar *jsvFindChildFromString(JsVar *parent, const char *name); // Non-recursive finding of child with name. Returns a LOCKED var
+#ifndef ESPR_NO_FIELD_POSITION_CACHE
+/** Like jsvFindChildFromString, but first checks the child at '*position' (where it
+ * was found in a similar object last time). '*position' is updated with where the child was found */
+JsVar *jsvFindChildFromStringAtPosition(JsVar *parent, const char *name, unsigned char *position);
+#endif
 JsVar *jsvFindOrAddChildFromString(JsVar *parent, const char *name); // Non-recursive finding of child with name. Returns a LOCKED var
 JsVar *jsvFindChildFromStringI(JsVar *parent, const char *name); ///< Find a child with a matching name using a case insensitive search
 JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound); ///< Non-recursive finding of child with name. Returns a LOCKED var
@@ -757,9 +771,24 @@ void jsvTrace(JsVar *var, int indent);
 /** Run a garbage collection sweep - return nonzero if things have been freed */
 int jsvGarbageCollect();
 
+#ifndef ESPR_NO_INCREMENTAL_GC
+/** Do part of a garbage collection, starting one if needed. This looks at roughly
+ * maxBlocks vars and then returns true if there's more to do. Once marking is
+ * finished the sweep happens as in jsvGarbageCollect, and false is returned. */
+bool jsvGarbageCollectStep(unsigned int maxBlocks);
+/// Has jsvGarbageCollectStep started a garbage collection that isn't finished yet?
+bool jsvGarbageCollectInProgress();
+#endif
+
 /** Defragement memory - this could take a while with interrupts turned off! */
 void jsvDefragment();
 
+#ifndef ESPR_NO_NURSERY
+/** If lots of vars have survived in the nursery at the start of memory, move
+ * them out to leave it free for new vars. Returns true if anything moved */
+bool jsvNurseryCollect();
+#endif
+
 // Dump any locked variables that aren't referenced from `global` - for debugging memory leaks
 void jsvDumpLockedVars();
 // Dump the free list - in order
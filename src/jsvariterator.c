@@ -261,6 +261,11 @@ void jsvStringIteratorNew(JsvStringIterator *it, JsVar *str, size_t startIdx) {
     it->var =  jsvGetUTF8BackingString(str);
     assert(jsvHasCharacterData(it->var));
   } else
+#endif
+#ifndef ESPR_NO_ATOMS
+  if (jsvIsAtomName(str)) // the characters are all in the atom
+    it->var = jsvLock(jsvGetLastChild(str));
+  else
 #endif
     it->var = jsvLockAgain(str);
   it->varIndex = 0;
@@ -404,8 +409,43 @@ void jsvStringIteratorGetPtrAndNext(JsvStringIterator *it, unsigned char **data,
   jsvStringIteratorNextInline(it);
 }
 
+#ifndef SAVE_ON_FLASH
+/** Remember the last StringExt we found the last time we went to the end of
+ * a string, so building a string up by appending to it (eg. `s += "..."` in a
+ * loop) doesn't have to step through every StringExt each time. Strings only
+ * ever get StringExts added to the end, so the StringExt stays in the string
+ * until the string is freed or changed into a name (or vars are moved) - and
+ * jsvStringEndCacheRemove/jsvStringEndCacheClear are called then. */
+static JsVarRef jsvStringEndCacheStr; ///< The string
+static JsVarRef jsvStringEndCacheExt; ///< The last StringExt in the string when we last went to the end
+static size_t jsvStringEndCacheIndex; ///< The index in the string of the first character of jsvStringEndCacheExt
+
+void jsvStringEndCacheClear() {
+  jsvStringEndCacheStr = 0;
+}
+
+void jsvStringEndCacheRemove(JsVarRef str) {
+  if (jsvStringEndCacheStr == str)
+    jsvStringEndCacheStr = 0;
+}
+#endif
+
 void jsvStringIteratorGotoEnd(JsvStringIterator *it) {
   assert(it->var);
+#ifndef SAVE_ON_FLASH
+  JsVarRef strRef = 0;
+  if (it->varIndex==0 && jsvHasStringExt(it->var)) {
+    strRef = jsvGetRef(it->var);
+    if (strRef == jsvStringEndCacheStr && jsvGetLastChild(it->var)) {
+      // skip straight to the StringExt we found last time
+      JsVar *next = jsvLock(jsvStringEndCacheExt);
+      jsvUnLock(it->var);
+      it->var = next;
+      it->varIndex = jsvStringEndCacheIndex;
+      it->charsInVar = jsvGetCharactersInVar(it->var);
+    }
+  }
+#endif
   while (jsvGetLastChild(it->var)) {
     JsVar *next = jsvLock(jsvGetLastChild(it->var));
     jsvUnLock(it->var);
@@ -413,6 +453,13 @@ void jsvStringIteratorGotoEnd(JsvStringIterator *it) {
     it->varIndex += it->charsInVar;
     it->charsInVar = jsvGetCharactersInVar(it->var);
   }
+#ifndef SAVE_ON_FLASH
+  if (strRef && it->varIndex) {
+    jsvStringEndCacheStr = strRef;
+    jsvStringEndCacheExt = jsvGetRef(it->var);
+    jsvStringEndCacheIndex = it->varIndex;
+  }
+#endif
   it->ptr = &it->var->varData.str[0];
   if (it->charsInVar) it->charIdx = it->charsInVar-1;
   else it->charIdx = 0;
@@ -481,12 +528,45 @@ void jsvStringIteratorAppend(JsvStringIterator *it, char ch) {
   jsvSetCharactersInVar(it->var, it->charsInVar);
 }
 
+void jsvStringIteratorAppendBuf(JsvStringIterator *it, const char *str, size_t length) {
+  while (length && it->var) {
+    // Append one char (which adds a new StringExt if needed)...
+    jsvStringIteratorAppend(it, *(str++));
+    length--;
+    if (!it->var) return; // out of memory
+    // ...then copy as much as will fit in the rest of this block in one go
+    size_t maxChars = jsvGetMaxCharactersInVar(it->var);
+    size_t n = (maxChars > it->charsInVar) ? maxChars - it->charsInVar : 0;
+    if (n > length) n = length;
+    if (n) {
+      memcpy(&it->ptr[it->charsInVar], str, n);
+      str += n;
+      length -= n;
+      it->charsInVar += n;
+      it->charIdx = it->charsInVar-1;
+      jsvSetCharactersInVar(it->var, it->charsInVar);
+    }
+  }
+}
+
 void jsvStringIteratorAppendString(JsvStringIterator *it, JsVar *str, size_t startIdx, int maxLength) {
   JsvStringIterator sit;
   jsvStringIteratorNew(&sit, str, startIdx);
-  while (jsvStringIteratorHasChar(&sit) && maxLength>0) {
-    jsvStringIteratorAppend(it, jsvStringIteratorGetCharAndNext(&sit));
-    maxLength--;
+  if (jsvIsBasicString(sit.var) || jsvIsFlatString(sit.var)) {
+    // The data is all in RAM, so we can copy it a block at a time
+    while (jsvStringIteratorHasChar(&sit) && maxLength>0) {
+      unsigned char *data;
+      unsigned int len;
+      jsvStringIteratorGetPtrAndNext(&sit, &data, &len);
+      if (len > (unsigned int)maxLength) len = (unsigned int)maxLength;
+      jsvStringIteratorAppendBuf(it, (const char*)data, len);
+      maxLength -= (int)len;
+    }
+  } else {
+    while (jsvStringIteratorHasChar(&sit) && maxLength>0) {
+      jsvStringIteratorAppend(it, jsvStringIteratorGetCharAndNext(&sit));
+      maxLength--;
+    }
   }
   jsvStringIteratorFree(&sit);
 }
@@ -189,9 +189,22 @@ void jsvStringIteratorGotoUTF8(JsvStringIterator *it, JsVar *str, size_t idx);
 /// Append a character TO THE END of a string iterator
 void jsvStringIteratorAppend(JsvStringIterator *it, char ch);
 
+/// Append a buffer of characters TO THE END of a string iterator (copying a block at a time)
+void jsvStringIteratorAppendBuf(JsvStringIterator *it, const char *str, size_t length);
+
 /// Append an entire JsVar string TO THE END of a string iterator
 void jsvStringIteratorAppendString(JsvStringIterator *it, JsVar *str, size_t startIdx, int maxLength);
 
+#ifndef SAVE_ON_FLASH
+/// Forget where the end of the last string we appended to was (eg. after vars have moved)
+void jsvStringEndCacheClear();
+/// Forget where the end of this string was, if we remembered it (it's being freed or changed)
+void jsvStringEndCacheRemove(JsVarRef str);
+#else
+#define jsvStringEndCacheClear()
+#define jsvStringEndCacheRemove(str)
+#endif
+
 static ALWAYS_INLINE void jsvStringIteratorFree(JsvStringIterator *it) {
   jsvUnLock(it->var);
 }
@@ -739,6 +739,7 @@ JsVar *jswrap_espruino_getErrorFlags() {
 /*TYPESCRIPT
 type Flag =
   | "deepSleep"
+  | "nursery"
   | "pretokenise"
   | "unsafeFlash"
   | "unsyncFiles";
@@ -755,6 +756,10 @@ Get Espruino's interpreter flags that control the way it handles your JavaScript
 code.
 
 * `deepSleep` - Allow deep sleep modes (also set by setDeepSleep)
+* `nursery` - When idle, move variables that have survived at the start of
+  memory (where new variables are allocated first) further up, so short-lived
+  variables don't fragment memory. This has to look at every variable, so while
+  it's running events are delayed by a time proportional to the amount of memory
 * `pretokenise` - When adding functions, pre-minify them and tokenise reserved
   words
 * `unsafeFlash` - Some platforms stop writes/erases to interpreter memory to
@@ -1446,6 +1451,10 @@ Show fragmentation.
 * `#` is a normal variable
 * `L` is a locked variable (address used, cannot be moved)
 * `=` represents data in a Flat String (must be contiguous)
+
+This is followed by a summary of how many separate runs of free blocks there
+are, and the size of the largest one (which limits the size of Flat Strings
+such as `ArrayBuffer`s that can be allocated).
  */
 void jswrap_e_dumpFragmentation() {
   int l = 0;
@@ -1469,6 +1478,9 @@ void jswrap_e_dumpFragmentation() {
     }
   }
   jsiConsolePrint("\n");
+  unsigned int runCount;
+  unsigned int largest = jsvGetLargestFreeRun(&runCount);
+  jsiConsolePrintf("%d free blocks in %d runs, largest %d blocks\n", jsvGetMemoryTotal()-jsvGetMemoryUsage(), runCount, largest);
 }
 
 /*JSON{
@@ -1540,6 +1552,10 @@ void jswrap_e_dumpVariables() {
   "generate" : "jsvDefragment"
 }
 BETA: defragment memory!
+
+Flat Strings (such as the data for `ArrayBuffer`s) are moved too, so addresses
+returned by `E.getAddressOf(..., true)` may change. Flat Strings that are
+locked, or that are referenced by a locked variable, are not moved.
 */
 
 /*TYPESCRIPT
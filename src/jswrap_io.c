@@ -700,7 +700,7 @@ void jswrap_io_shiftOut(JsVar *pins, JsVar *options, JsVar *data) {
     ["options", "JsVar","If a boolean or integer, it determines whether to call this once (false = default) or every time a change occurs (true). Can be an object of the form `{ repeat: true/false(default), edge:'rising'/'falling'/'both'(default), debounce:10}` - see below for more information."]
   ],
   "return" : ["JsVar","An ID that can be passed to clearWatch"],
-  "typescript" : "declare function setWatch(func: ((arg: { state: boolean, time: number, lastTime: number }) => void) | string, pin: Pin, options?: boolean | { repeat?: boolean, edge?: \"rising\" | \"falling\" | \"both\", debounce?: number, irq?: boolean, data?: Pin, hispeed?: boolean }): number;"
+  "typescript" : "declare function setWatch(func: ((arg: { state: boolean, time: number, lastTime: number }) => void) | string, pin: Pin, options?: boolean | { repeat?: boolean, edge?: \"rising\" | \"falling\" | \"both\", debounce?: number, irq?: boolean, data?: Pin, hispeed?: boolean, batch?: boolean }): number;"
 }
 Call the function specified when the pin changes. Watches set with `setWatch`
 can be removed using `clearWatch`.
@@ -728,6 +728,10 @@ information (all optional):
    // high speed pulses (less than 25us) may not be reliably received. Setting hispeed=true
    // allows for detecting high speed pulses at the expense of higher idle power consumption
    hispeed : true
+   // Advanced: If true, when a pin changes several times before the callback can
+   // be run, the edges are passed to one callback with `time` as a Float64Array
+   // of the times of each edge (up to 16 at once) - see below
+   batch : false(default)
 }
 ```
 
@@ -742,6 +746,13 @@ The `function` callback is called with an argument, which is an object of type
  * `data` is included if `data:pin` was specified in the options, and can be
    used for reading in clocked data
 
+If `batch:true` was specified, `time` is always a `Float64Array` of the times
+of each edge, `state` is the state after the last of them, and `lastTime` is
+the time of the change before the first of them. Edges are only batched when
+nothing else is watching the same pin (or a pin with the same number), and
+`batch` is ignored if `debounce` is set (built-in buttons use `debounce:25`
+unless you specify `debounce:0`).
+
 For instance, if you want to measure the length of a positive pulse you could
 use `setWatch(function(e) { console.log(e.time-e.lastTime); }, BTN, {
 repeat:true, edge:'falling' });`. This will only be called on the falling edge
@@ -785,6 +796,9 @@ JsVar *jswrap_interface_setWatch(
   JsVarFloat debounce = 0;
   int edge = 0;
   bool isIRQ = false, isHighSpeed = false;
+#ifndef ESPR_NO_WATCH_BATCH
+  bool isBatch = false;
+#endif
   Pin dataPin = PIN_UNDEFINED;
   if (IS_PIN_A_BUTTON(pin)) {
     edge = 1;
@@ -818,6 +832,9 @@ JsVar *jswrap_interface_setWatch(
     }
     isIRQ = jsvObjectGetBoolChild(repeatOrObject, "irq");
     isHighSpeed = jsvObjectGetBoolChild(repeatOrObject, "hispeed");
+#ifndef ESPR_NO_WATCH_BATCH
+    isBatch = jsvObjectGetBoolChild(repeatOrObject, "batch");
+#endif
     dataPin = jshGetPinFromVarAndUnLock(jsvObjectGetChildIfExists(repeatOrObject, "data"));
   } else
     repeat = jsvGetBool(repeatOrObject);
@@ -836,6 +853,10 @@ JsVar *jswrap_interface_setWatch(
       jsvObjectSetChildAndUnLock(watchPtr, "state", jsvNewFromBool(jshPinInput(pin)));
       if (isHighSpeed)
         jsvObjectSetChildAndUnLock(watchPtr, "hispeed", jsvNewFromBool(true));
+#ifndef ESPR_NO_WATCH_BATCH
+      if (isBatch)
+        jsvObjectSetChildAndUnLock(watchPtr, "batch", jsvNewFromBool(true));
+#endif
     }
 
     // If nothing already watching the pin, set up a watch
@@ -865,6 +886,7 @@ JsVar *jswrap_interface_setWatch(
     JsVar *watchArrayPtr = jsvLock(watchArray);
     itemIndex = jsvArrayAddToEnd(watchArrayPtr, watchPtr, 1) - 1;
     jsvUnLock2(watchArrayPtr, watchPtr);
+    jsiWatchesChanged();
 
 
   }
@@ -905,6 +927,7 @@ void jswrap_interface_clearWatch(JsVar *idVarArr) {
     // remove all items
     jsvRemoveAllChildren(watchArrayPtr);
     jsvUnLock(watchArrayPtr);
+    jsiWatchesChanged();
   } else {
     JsVar *idVar = jsvGetArrayItem(idVarArr, 0);
     if (jsvIsUndefined(idVar)) {
@@ -922,6 +945,7 @@ void jswrap_interface_clearWatch(JsVar *idVarArr) {
       JsVar *watchArrayPtr = jsvLock(watchArray);
       jsvRemoveChildAndUnLock(watchArrayPtr, watchNamePtr);
       jsvUnLock(watchArrayPtr);
+      jsiWatchesChanged();
 
       // Now check if this pin is still being watched
       if (!jsiIsWatchingPin(pin))
@@ -25,6 +25,7 @@ const unsigned int JSON_LIMIT_STRING_AMOUNT = 40; // how big are strings before
 const unsigned int JSON_LIMITED_STRING_AMOUNT = 17; // When limited, how many chars do we show at the beginning and end
 const unsigned int JSON_ITEMS_ON_LINE_OBJECT = 4; // How many items are allowed end to end on a line.
 const char *JSON_LIMIT_TEXT = " ... ";
+#define JSON_BUFFER_SIZE 64 ///< How many characters of JSON jsfGetJSONWithBuffer collects before flushing them
 
 
 /*JSON{
@@ -55,118 +56,701 @@ with JSON.parse or eval.
 * Typed arrays like `new Uint8Array(5)` will be dumped as if they were arrays,
   not as if they were objects (since it is more compact)
  */
+/// Work out the whitespace to use from JSON.stringify's 'space' argument, and return the flags to use
+static JSONFlags jswrap_json_getWhitespace(JsVar *space, char whitespace[11]) {
+  JSONFlags flags = JSON_IGNORE_FUNCTIONS|JSON_NO_UNDEFINED|JSON_ARRAYBUFFER_AS_ARRAY|JSON_JSON_COMPATIBILE|JSON_ALLOW_TOJSON;
+  whitespace[0] = 0;
+  if (jsvIsUndefined(space) || jsvIsNull(space)) {
+    // nothing
+  } else if (jsvIsNumeric(space)) {
+    int s = (int)jsvGetInteger(space);
+    if (s<0) s=0;
+    if (s>10) s=10;
+    whitespace[s] = 0;
+    while (s) whitespace[--s]=' ';
+  } else {
+    size_t l = jsvGetString(space, whitespace, 10);
+    whitespace[l]=0; // add trailing 0
+  }
+  if (strlen(whitespace)) flags |= JSON_ALL_NEWLINES|JSON_PRETTY;
+  return flags;
+}
+
 JsVar *jswrap_json_stringify(JsVar *v, JsVar *replacer, JsVar *space) {
   NOT_USED(replacer);
-  JSONFlags flags = JSON_IGNORE_FUNCTIONS|JSON_NO_UNDEFINED|JSON_ARRAYBUFFER_AS_ARRAY|JSON_JSON_COMPATIBILE|JSON_ALLOW_TOJSON;
   JsVar *result = jsvNewFromEmptyString();
   if (result) {// could be out of memory
-    char whitespace[11] = "";
-    if (jsvIsUndefined(space) || jsvIsNull(space)) {
-      // nothing
-    } else if (jsvIsNumeric(space)) {
-      int s = (int)jsvGetInteger(space);
-      if (s<0) s=0;
-      if (s>10) s=10;
-      whitespace[s] = 0;
-      while (s) whitespace[--s]=' ';
-    } else {
-      size_t l = jsvGetString(space, whitespace, sizeof(whitespace)-1);
-      whitespace[l]=0; // add trailing 0
-    }
-    if (strlen(whitespace)) flags |= JSON_ALL_NEWLINES|JSON_PRETTY;
+    char whitespace[11];
+    JSONFlags flags = jswrap_json_getWhitespace(space, whitespace);
     jsfGetJSONWhitespace(v, result, flags, whitespace);
   }
   return result;
 }
 
+#ifndef ESPR_NO_JSON_STREAM
+/*JSON{
+  "type" : "staticmethod",
+  "class" : "JSON",
+  "name" : "stringifyTo",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)",
+  "generate" : "jswrap_json_stringifyTo",
+  "params" : [
+    ["destination","JsVar","An object with a `write` method, eg. `Serial1`, a socket or a `StorageFile`"],
+    ["data","JsVar","The data to be converted to JSON"],
+    ["options","JsVar","[optional] An object containing `{space, chunkSize}` (see below)"]
+  ]
+}
+(2v22+ only) Convert the given object into JSON like `JSON.stringify`, but
+rather than returning a String, pass the JSON to `destination.write` a chunk at
+a time. This means that a big Object or Array can be sent or saved without
+having to store the whole JSON string in RAM.
+
+```
+JSON.stringifyTo(Serial1, bigArray);
+var f = require("Storage").open("data.json","w");
+JSON.stringifyTo(f, bigArray);
+```
 
-/* Parse JSON from the current lexer. unquoted fields aren't normally allowed,
-   but if flags&JSON_DROP_QUOTES we'll allow them */
-JsVar *jswrap_json_parse_internal(JSONFlags flags) {
-  switch (lex->tk) {
-  case LEX_R_TRUE:  jslGetNextToken(); return jsvNewFromBool(true);
-  case LEX_R_FALSE: jslGetNextToken(); return jsvNewFromBool(false);
-  case LEX_R_NULL:  jslGetNextToken(); return jsvNewWithFlags(JSV_NULL);
-  case '-': {
-    jslGetNextToken();
-    if (lex->tk!=LEX_INT && lex->tk!=LEX_FLOAT) return 0;
-    JsVar *v = jswrap_json_parse_internal(flags);
-    JsVar *zero = jsvNewFromInteger(0);
-    JsVar *r = jsvMathsOp(zero, v, '-');
-    jsvUnLock2(v, zero);
-    return r;
-  }
-  case LEX_INT: {
-    long long v = stringToInt(jslGetTokenValueAsString());
-    jslGetNextToken();
-    return jsvNewFromLongInteger(v);
-  }
-  case LEX_FLOAT: {
-    JsVarFloat v = stringToFloat(jslGetTokenValueAsString());
-    jslGetNextToken();
-    return jsvNewFromFloat(v);
-  }
-  case LEX_STR: {
-    JsVar *a = jslGetTokenValueAsVar();
-#ifdef ESPR_UNICODE_SUPPORT
-    if (lex->isUTF8)  // If the parsed string was UTF8, we should wrap it up
-      a = jsvNewUTF8StringAndUnLock(a);
+`options` can contain:
+
+* `space` - the number of spaces to use for padding, or a string (as for `JSON.stringify`)
+* `chunkSize` - (default 256) how many characters to pass to each call of `destination.write`
+ */
+typedef struct {
+  JsVar *destination;
+  JsVar *writeFn;
+  JsVar *chunk;          ///< The String we're adding JSON to before it's passed to 'writeFn'
+  JsvStringIterator it;  ///< Iterator at the end of 'chunk'
+  size_t chunkLen;       ///< How many characters are in 'chunk'
+  size_t chunkSize;      ///< How many characters we pass to 'writeFn' at once
+} JsonStreamOutput;
+
+static void jswrap_json_stringifyTo_write(JsonStreamOutput *s) {
+  jsvStringIteratorFree(&s->it);
+  if (!jspHasError()) // don't keep writing if there was an error
+    jsvUnLock(jspExecuteFunction(s->writeFn, s->destination, 1, &s->chunk));
+  jsvUnLock(s->chunk);
+  s->chunk = 0;
+  s->chunkLen = 0;
+}
+
+static void jswrap_json_stringifyTo_flush(const char *data, size_t len, void *user_data) {
+  JsonStreamOutput *s = (JsonStreamOutput*)user_data;
+  while (len) {
+    if (!s->chunk) {
+      s->chunk = jsvNewFromEmptyString();
+      if (!s->chunk) return; // out of memory
+      jsvStringIteratorNew(&s->it, s->chunk, 0);
+    }
+    size_t n = s->chunkSize - s->chunkLen;
+    if (n > len) n = len;
+    jsvStringIteratorAppendBuf(&s->it, data, n);
+    data += n;
+    len -= n;
+    s->chunkLen += n;
+    if (s->chunkLen >= s->chunkSize)
+      jswrap_json_stringifyTo_write(s);
+  }
+}
+
+void jswrap_json_stringifyTo(JsVar *destination, JsVar *v, JsVar *options) {
+  JsVar *space = 0;
+  int chunkSize = 256;
+  jsvConfigObject configs[] = {
+      {"space", JSV_OBJECT, &space},
+      {"chunkSize", JSV_INTEGER, &chunkSize},
+  };
+  if (!jsvReadConfigObject(options, configs, sizeof(configs) / sizeof(jsvConfigObject)))
+    return;
+  JsonStreamOutput s;
+  s.destination = destination;
+  s.writeFn = jspGetNamedField(destination, "write", false);
+  s.chunk = 0;
+  s.chunkLen = 0;
+  s.chunkSize = (size_t)chunkSize;
+  if (!jsvIsFunction(s.writeFn)) {
+    jsExceptionHere(JSET_ERROR, "Destination Stream does not implement the required write(buffer) method");
+  } else if (chunkSize<=0) {
+    jsExceptionHere(JSET_ERROR, "Invalid chunkSize %d", chunkSize);
+  } else {
+    char whitespace[11];
+    JSONFlags flags = jswrap_json_getWhitespace(space, whitespace);
+    jsfGetJSONWithBuffer(v, flags, whitespace, jswrap_json_stringifyTo_flush, &s);
+    if (s.chunk) jswrap_json_stringifyTo_write(&s);
+  }
+  jsvUnLock2(space, s.writeFn);
+}
 #endif
-    jslGetNextToken();
-    return a;
-  }
-  case '[': {
-    JsVar *arr = jsvNewEmptyArray(); if (!arr) return 0;
-    jslGetNextToken(); // [
-    while (lex->tk != ']' && !jspHasError()) {
-      JsVar *value = jswrap_json_parse_internal(flags);
-      if (!value ||
-          (lex->tk!=']' && !jslMatch(','))) {
-        jsvUnLock2(value, arr);
-        return 0;
+
+/* JSON parser. This doesn't use the JavaScript lexer - characters are fed in
+ * one at a time with jsonpChar, so that data can be parsed as it arrives in
+ * chunks (see JSONParser) as well as all at once with JSON.parse.
+ *
+ * The container we're filling in (and the key we're reading the value for if
+ * it's an Object) are kept in 'container' and 'key'. When a new container is
+ * opened they're pushed onto the stack, and popped when it closes. For
+ * JSON.parse the first few levels of the stack are kept in 'nested' so we
+ * don't have to allocate anything for them - the rest go in the 'stack' array
+ * (which is all JSONParser uses, as it has to be saved between chunks). */
+
+#define JSONP_BUF_SIZE 64 ///< Characters of a token we keep before adding them to a String (numbers must fit in this)
+#define JSONP_NESTED_SIZE 8 ///< How many containers/keys we can keep in JsonParser.nested
+
+typedef enum {
+  JSONP_VALUE,         ///< Expecting a value (or ']' in an array)
+  JSONP_AFTER_VALUE,   ///< Expecting ',' or the end of the container
+  JSONP_KEY,           ///< Expecting a key (or '}')
+  JSONP_COLON,         ///< Expecting the ':' after a key
+  JSONP_STRING,        ///< In a quoted string
+  JSONP_STRING_ESCAPE, ///< Just had a '\' in a string
+  JSONP_STRING_HEX,    ///< In the digits of a \x or \u escape
+  JSONP_STRING_OCTAL,  ///< In the digits of an octal escape
+  JSONP_NUMBER,        ///< In a number
+  JSONP_WORD,          ///< In true/false/null, or an unquoted key
+  JSONP_COMMENT_START, ///< Just had a '/'
+  JSONP_LINE_COMMENT,  ///< In a '//' comment
+  JSONP_BLOCK_COMMENT, ///< In a '/*' comment
+  JSONP_BLOCK_COMMENT_STAR, ///< Just had a '*' in a '/*' comment
+  JSONP_DONE,          ///< Got a value and we only wanted one (JSON.parse)
+} PACKED_FLAGS JsonpState;
+
+typedef enum {
+  JSONPF_KEY            = 1, ///< The string/word we're reading is a key
+  JSONPF_UNICODE_ESCAPE = 2, ///< The escape we're reading is \u (not \x)
+  JSONPF_UTF8           = 4, ///< The string we're reading has had UTF8 in it
+  JSONPF_HAD_HIGH_CHARS = 8, ///< The string we're reading has had chars in the UTF8 range that weren't UTF8
+} PACKED_FLAGS JsonpFlags;
+
+/// The state of the parser that isn't JsVars (so can be saved between chunks)
+typedef struct {
+  JsonpState state;
+  JsonpState afterComment; ///< The state to go back to after a comment
+  JsonpFlags flags;
+  char quote;              ///< The quote character the current string started with
+  unsigned char bufLen;    ///< How many characters are in 'buf'
+  unsigned char escLen;    ///< How many more digits we want for an escape, or how long the UTF8 sequence in 'utf8' is
+  unsigned char utf8Len;   ///< How many bytes of a UTF8 sequence we have in 'utf8'
+  char utf8[4];            ///< A UTF8 sequence we haven't got all of yet
+  unsigned short depth;    ///< How many containers are open
+  unsigned short emitDepth;///< If we have an 'owner', values this deep are passed to it rather than added to their container
+  int escValue;            ///< The value of the escape we're reading
+  int highSurrogate;       ///< The first half of a \u surrogate pair, or 0
+  char buf[JSONP_BUF_SIZE];///< Characters of the current token that aren't in 'token' yet
+} JsonpData;
+
+typedef struct {
+  JsonpData d;
+  JSONFlags flags;
+  JsVar *nested[JSONP_NESTED_SIZE]; ///< The bottom of the stack of containers (and keys) outside 'container'
+  unsigned char nestedLen; ///< How many items are in 'nested'
+  unsigned char nestedMax; ///< How many items we can put in 'nested' (0 for JSONParser)
+  JsVar *stack;  ///< Array of the containers (and keys) outside 'container' that are above 'nested'
+  JsVar *container; ///< The Object/Array we're reading values for
+  JsVar *key;    ///< If 'container' is an Object, the key we're reading the value for
+  JsVar *token;  ///< The string/key we're reading, if it's too long for 'buf'
+  JsVar *owner;  ///< The JSONParser we emit values on, or 0 for JSON.parse
+  JsVar *result; ///< For JSON.parse, the value we parsed
+} JsonParser;
+
+static void jsonpInit(JsonParser *p, JsVar *owner, JSONFlags flags) {
+  memset(p, 0, sizeof(JsonParser));
+  p->flags = flags;
+  p->owner = owner;
+  if (!owner) p->nestedMax = JSONP_NESTED_SIZE;
+}
+
+static void jsonpKill(JsonParser *p) {
+  jsvUnLock3(p->stack, p->token, p->result);
+  jsvUnLock2(p->container, p->key);
+  jsvUnLockMany(p->nestedLen, p->nested);
+}
+
+static bool jsonpUnexpected(char ch) {
+  if (ch) jsExceptionHere(JSET_SYNTAXERROR, "Unexpected '%c' in JSON", ch);
+  else jsExceptionHere(JSET_SYNTAXERROR, "Unexpected end of JSON");
+  return false;
+}
+
+/// Add the characters in 'buf' to 'token'
+static bool jsonpTokenFlush(JsonParser *p) {
+  if (!p->token) {
+    // not jsvNewStringOfLength, as that may make a flat string we can't append to
+    p->token = jsvNewFromEmptyString();
+    if (!p->token) return false; // out of memory
+  }
+  jsvAppendStringBuf(p->token, p->d.buf, p->d.bufLen);
+  p->d.bufLen = 0;
+  return true;
+}
+
+static ALWAYS_INLINE bool jsonpTokenAppend(JsonParser *p, char ch) {
+  if (p->d.bufLen>=JSONP_BUF_SIZE && !jsonpTokenFlush(p)) return false;
+  p->d.buf[p->d.bufLen++] = ch;
+  return true;
+}
+
+/// Get the String we've read (and reset it ready for the next one)
+static JsVar *jsonpTokenGet(JsonParser *p) {
+  if ((p->d.bufLen || !p->token) && !jsonpTokenFlush(p)) return 0;
+  JsVar *token = p->token;
+  p->token = 0;
+  return token;
+}
+
+/// A value has been read - add it to its container (or pass it on). Unlocks 'value'
+static bool jsonpValue(JsonParser *p, JsVar *value) {
+  if (!value) return false; // out of memory
+  JsVar *container = p->container;
+  JsVar *key = p->key;
+  p->key = 0;
+  if (p->owner && p->d.depth<=p->d.emitDepth) {
+    if (!key && jsvIsArray(container)) {
+      // don't store the value, but keep the length so we know the index
+      JsVarInt idx = jsvGetArrayLength(container);
+      jsvSetArrayLength(container, idx+1, false);
+      key = jsvNewFromInteger(idx);
+    }
+    if (p->d.depth==p->d.emitDepth) {
+      JsVar *args[2] = { value, key };
+      jsiExecuteEventCallbackName(p->owner, JS_EVENT_PREFIX"value", 2, args);
+      if (jspHasError()) {
+        jsvUnLock2(value, key);
+        return false;
       }
-      jsvArrayPush(arr, value);
-      jsvUnLock(value);
     }
-    if (!jslMatch(']')) {
-      jsvUnLock(arr);
-      return 0;
+  } else if (!p->d.depth) { // JSON.parse - we only want one value
+    p->result = jsvLockAgain(value);
+    p->d.state = JSONP_DONE;
+  } else if (key) {
+    key = jsvMakeIntoVariableName(jsvAsArrayIndexAndUnLock(key), value);
+    jsvAddName(container, key);
+  } else
+    jsvArrayPush(container, value);
+  jsvUnLock2(value, key);
+  if (p->d.state!=JSONP_DONE)
+    p->d.state = p->d.depth ? JSONP_AFTER_VALUE : JSONP_VALUE;
+  return true;
+}
+
+/// Push onto the stack of containers/keys. Unlocks 'v'
+static bool jsonpPush(JsonParser *p, JsVar *v) {
+  if (p->nestedLen<p->nestedMax && !p->stack) {
+    p->nested[p->nestedLen++] = v;
+    return true;
+  }
+  if (!p->stack) p->stack = jsvNewEmptyArray();
+  if (!p->stack) { // out of memory
+    jsvUnLock(v);
+    return false;
+  }
+  jsvArrayPushAndUnLock(p->stack, v);
+  return true;
+}
+
+static JsVar *jsonpPop(JsonParser *p) {
+  if (p->stack && jsvGetArrayLength(p->stack)) {
+    JsVar *v = jsvSkipNameAndUnLock(jsvArrayPop(p->stack));
+    if (!jsvGetArrayLength(p->stack) && p->nestedMax) {
+      jsvUnLock(p->stack); // so we use 'nested' again
+      p->stack = 0;
     }
-    return arr;
-  }
-  case '{': {
-    JsVar *obj = jsvNewObject(); if (!obj) return 0;
-    jslGetNextToken(); // {
-    while ((lex->tk == LEX_STR || lex->tk == LEX_INT || jslIsIDOrReservedWord()) && !jspHasError()) {
-      if (!(flags&JSON_DROP_QUOTES) && (jslIsIDOrReservedWord() || lex->tk == LEX_INT)) {
-	      jslMatch(LEX_STR);
-        return obj;
-      }
-      JsVar *key = jsvAsArrayIndexAndUnLock(jslGetTokenValueAsVar());
-      jslGetNextToken();
-      JsVar *value = 0;
-      if (!jslMatch(':') ||
-          !(value=jswrap_json_parse_internal(flags)) ||
-          (lex->tk!='}' && !jslMatch(','))) {
-        jsvUnLock3(key, value, obj);
-        return 0;
+    return v;
+  }
+  if (p->nestedLen) return p->nested[--p->nestedLen];
+  return 0;
+}
+
+static bool jsonpOpen(JsonParser *p, JsVar *container) {
+  if (!container) return false; // out of memory
+  if (p->container) {
+    bool ok = jsonpPush(p, p->container);
+    p->container = 0;
+    if (ok && p->key) ok = jsonpPush(p, p->key);
+    p->key = 0;
+    if (!ok) {
+      jsvUnLock(container);
+      return false;
+    }
+  }
+  p->container = container;
+  p->key = 0;
+  p->d.depth++;
+  return true;
+}
+
+static bool jsonpClose(JsonParser *p, char ch) {
+  if (!p->d.depth || (ch==']') != jsvIsArray(p->container))
+    return jsonpUnexpected(ch);
+  JsVar *value = p->container;
+  p->container = 0;
+  p->d.depth--;
+  if (p->d.depth) { // get the container this was in back off the stack
+    JsVar *v = jsonpPop(p);
+    if (jsvIsString(v)) {
+      p->key = v;
+      v = jsonpPop(p);
+    }
+    p->container = v;
+  }
+  return jsonpValue(p, value);
+}
+
+static bool jsonpStringEnd(JsonParser *p) {
+  if (p->d.highSurrogate) {
+    jsExceptionHere(JSET_ERROR, "Unmatched Unicode surrogate");
+    return false;
+  }
+  JsVar *str = jsonpTokenGet(p);
+  if (!str) return false;
+  JsonpFlags flags = p->d.flags;
+  p->d.flags = 0;
+  if (flags & JSONPF_KEY) {
+    p->key = str;
+    p->d.state = JSONP_COLON;
+    return true;
+  }
+#ifdef ESPR_UNICODE_SUPPORT
+  if (flags & JSONPF_UTF8)
+    str = jsvNewUTF8StringAndUnLock(str);
+#endif
+  return jsonpValue(p, str);
+}
+
+static bool jsonpWordEnd(JsonParser *p) {
+  if (p->d.flags & JSONPF_KEY) // unquoted key
+    return jsonpStringEnd(p);
+  if (!p->token && p->d.bufLen<JSONP_BUF_SIZE) {
+    p->d.buf[p->d.bufLen] = 0;
+    JsVar *v = 0;
+    if (!strcmp(p->d.buf, "true")) v = jsvNewFromBool(true);
+    else if (!strcmp(p->d.buf, "false")) v = jsvNewFromBool(false);
+    else if (!strcmp(p->d.buf, "null")) v = jsvNewWithFlags(JSV_NULL);
+    if (v) {
+      p->d.bufLen = 0;
+      return jsonpValue(p, v);
+    }
+  }
+  jsExceptionHere(JSET_SYNTAXERROR, "Expecting valid value, got %q", jsonpTokenFlush(p) ? p->token : 0);
+  return false;
+}
+
+static bool jsonpNumberEnd(JsonParser *p) {
+  if (p->d.bufLen>=JSONP_BUF_SIZE) {
+    jsExceptionHere(JSET_SYNTAXERROR, "Number too long in JSON");
+    return false;
+  }
+  char *s = p->d.buf;
+  s[p->d.bufLen] = 0;
+  p->d.bufLen = 0;
+  const char *endOfNumber = 0;
+  bool isHex = strchr(s, 'x') || strchr(s, 'X');
+  if (!isHex && (strchr(s, '.') || strchr(s, 'e') || strchr(s, 'E'))) {
+    JsVarFloat f = stringToFloatWithRadix(s, 0, &endOfNumber);
+    if (!*endOfNumber) return jsonpValue(p, jsvNewFromFloat(f));
+  } else {
+    bool hasError = false;
+    long long v = stringToIntWithRadix(s, 0, &hasError, &endOfNumber);
+    if (!hasError && !*endOfNumber) return jsonpValue(p, jsvNewFromLongInteger(v));
+  }
+  jsExceptionHere(JSET_SYNTAXERROR, "Invalid number '%s' in JSON", s);
+  return false;
+}
+
+#ifdef ESPR_UNICODE_SUPPORT
+/// We're about to add UTF8 to the string - convert anything we already have to UTF8 if needed
+static bool jsonpStringMakeUTF8(JsonParser *p) {
+  if (!(p->d.flags & JSONPF_UTF8) && (p->d.flags & JSONPF_HAD_HIGH_CHARS)) {
+    if (!jsonpTokenFlush(p)) return false;
+    p->token = jsvConvertToUTF8AndUnLock(p->token);
+    if (!p->token) return false;
+  }
+  p->d.flags |= JSONPF_UTF8;
+  return true;
+}
+
+/// We got part of a UTF8 sequence that wasn't valid, so just add the bytes
+static bool jsonpStringFlushUTF8(JsonParser *p) {
+  bool ok = true;
+  for (int i=0;i<p->d.utf8Len;i++)
+    ok &= jsonpTokenAppend(p, p->d.utf8[i]);
+  p->d.utf8Len = 0;
+  p->d.flags |= JSONPF_HAD_HIGH_CHARS;
+  return ok;
+}
+#endif
+
+/// We've got all the digits of a \x or \u escape
+static bool jsonpStringEscapeEnd(JsonParser *p) {
+  int codepoint = p->d.escValue;
+  p->d.state = JSONP_STRING;
+#ifdef ESPR_UNICODE_SUPPORT
+  bool isUnicode = p->d.flags & JSONPF_UNICODE_ESCAPE;
+  if (isUnicode) {
+    if (p->d.highSurrogate) {
+      if (!jsUnicodeIsLowSurrogate(codepoint)) {
+        jsExceptionHere(JSET_ERROR, "Unmatched Unicode surrogate");
+        return false;
       }
-      jsvAddName(obj, jsvMakeIntoVariableName(key, value));
-      jsvUnLock2(value, key);
+      codepoint = 0x10000 + ((codepoint & 0x03FF) | ((p->d.highSurrogate & 0x03FF) << 10));
+      p->d.highSurrogate = 0;
+    } else if (jsUnicodeIsHighSurrogate(codepoint)) {
+      p->d.highSurrogate = codepoint;
+      return true;
+    } else if (jsUnicodeIsLowSurrogate(codepoint)) {
+      jsExceptionHere(JSET_ERROR, "Unmatched Unicode surrogate");
+      return false;
     }
-    if (!jslMatch('}')) {
-      jsvUnLock(obj);
-      return 0;
+  }
+  /* As with the lexer, a char written with \x is copied in verbatim but
+   * \u is UTF8 encoded (as are \x chars once the string is UTF8) */
+  if (isUnicode || (p->d.flags & JSONPF_UTF8)) {
+    char buf[4];
+    unsigned int len = jsUTF8Encode(codepoint, buf);
+    if (jsUTF8IsStartChar(buf[0]) && !jsonpStringMakeUTF8(p)) return false;
+    for (unsigned int i=0;i<len;i++)
+      if (!jsonpTokenAppend(p, buf[i])) return false;
+    return true;
+  }
+  if (jsUTF8IsStartChar((char)codepoint)) p->d.flags |= JSONPF_HAD_HIGH_CHARS;
+#endif
+  return jsonpTokenAppend(p, (char)codepoint);
+}
+
+static bool jsonpStringChar(JsonParser *p, char ch) {
+#ifdef ESPR_UNICODE_SUPPORT
+  if (p->d.highSurrogate && ch!='\\') {
+    jsExceptionHere(JSET_ERROR, "Unmatched Unicode surrogate");
+    return false;
+  }
+  if (p->d.utf8Len) { // in a UTF8 sequence
+    if ((ch&0xC0)==0x80) {
+      p->d.utf8[p->d.utf8Len++] = ch;
+      if (p->d.utf8Len<p->d.escLen) return true;
+      // got the whole sequence
+      if (!jsonpStringMakeUTF8(p)) return false;
+      p->d.utf8Len = 0;
+      bool ok = true;
+      for (int i=0;i<p->d.escLen;i++)
+        ok &= jsonpTokenAppend(p, p->d.utf8[i]);
+      return ok;
     }
-    return obj;
+    // not valid UTF8 - just carry on as if we weren't handling UTF8
+    if (!jsonpStringFlushUTF8(p)) return false;
+  }
+#endif
+  if (ch==p->d.quote) return jsonpStringEnd(p);
+  if (ch=='\\') {
+    p->d.state = JSONP_STRING_ESCAPE;
+    return true;
+  }
+  if (ch=='\n') {
+    jsExceptionHere(JSET_SYNTAXERROR, "Unfinished string in JSON");
+    return false;
+  }
+#ifdef ESPR_UNICODE_SUPPORT
+  if (jsUTF8IsStartChar(ch)) {
+    p->d.utf8[0] = ch;
+    p->d.utf8Len = 1;
+    p->d.escLen = (unsigned char)jsUTF8LengthFromChar(ch);
+    return true;
+  }
+#endif
+  return jsonpTokenAppend(p, ch);
+}
+
+static bool jsonpStringEscapeChar(JsonParser *p, char ch) {
+#ifdef ESPR_UNICODE_SUPPORT
+  if (p->d.highSurrogate && ch!='u') {
+    jsExceptionHere(JSET_ERROR, "Unmatched Unicode surrogate");
+    return false;
+  }
+#endif
+  p->d.state = JSONP_STRING;
+  switch (ch) {
+    case 'n': ch = 0x0A; break;
+    case 'b': ch = 0x08; break;
+    case 'f': ch = 0x0C; break;
+    case 'r': ch = 0x0D; break;
+    case 't': ch = 0x09; break;
+    case 'v': ch = 0x0B; break;
+    case 'u':
+    case 'x':
+      if (ch=='u') p->d.flags |= JSONPF_UNICODE_ESCAPE;
+      else p->d.flags &= (JsonpFlags)~JSONPF_UNICODE_ESCAPE;
+      p->d.state = JSONP_STRING_HEX;
+      p->d.escLen = (ch=='u') ? 4 : 2;
+      p->d.escValue = 0;
+      return true;
+    default:
+      if (ch>='0' && ch<='7') {
+        p->d.state = JSONP_STRING_OCTAL;
+        p->d.escLen = 2; // up to 2 more digits
+        p->d.escValue = ch-'0';
+        return true;
+      }
+      break; // anything else is just added
+  }
+  return jsonpTokenAppend(p, ch);
+}
+
+static bool jsonpChar(JsonParser *p, char ch);
+
+/// Start reading a string/number/word/container/comment - or skip whitespace
+static bool jsonpValueChar(JsonParser *p, char ch) {
+  if (ch=='"' || ch=='\'') {
+    p->d.state = JSONP_STRING;
+    p->d.quote = ch;
+  } else if (isNumericInline(ch) || ch=='-') {
+    p->d.state = JSONP_NUMBER;
+    p->d.buf[p->d.bufLen++] = ch;
+  } else if (isAlphaInline(ch)) {
+    p->d.state = JSONP_WORD;
+    p->d.buf[p->d.bufLen++] = ch;
+  } else if (ch=='{') {
+    if (!jsonpOpen(p, jsvNewObject())) return false;
+    p->d.state = JSONP_KEY;
+  } else if (ch=='[') {
+    return jsonpOpen(p, jsvNewEmptyArray());
+  } else if (ch==']') { // empty array, or a trailing comma
+    return jsonpClose(p, ch);
+  } else if (!isWhitespace(ch))
+    return jsonpUnexpected(ch);
+  return true;
+}
+
+/// Handle one character of JSON. Returns false on error
+static bool jsonpChar(JsonParser *p, char ch) {
+  switch (p->d.state) {
+    case JSONP_STRING:
+      return jsonpStringChar(p, ch);
+    case JSONP_STRING_ESCAPE:
+      return jsonpStringEscapeChar(p, ch);
+    case JSONP_STRING_HEX:
+      if (!isHexadecimal(ch)) {
+        jsExceptionHere(JSET_ERROR, "Invalid escape sequence");
+        return false;
+      }
+      p->d.escValue = p->d.escValue*16 + chtod(ch);
+      if (--p->d.escLen) return true;
+      return jsonpStringEscapeEnd(p);
+    case JSONP_STRING_OCTAL:
+      if (p->d.escLen && ch>='0' && ch<='7') {
+        p->d.escValue = p->d.escValue*8 + ch-'0';
+        if (--p->d.escLen) return true;
+        p->d.state = JSONP_STRING;
+        return jsonpTokenAppend(p, (char)p->d.escValue);
+      }
+      p->d.state = JSONP_STRING;
+      return jsonpTokenAppend(p, (char)p->d.escValue) && jsonpStringChar(p, ch);
+    case JSONP_NUMBER:
+      // also allow letters for hex/binary numbers - they're checked when we parse it
+      if (isNumericInline(ch) || isAlphaInline(ch) || ch=='.' || ch=='+' || ch=='-') {
+        if (p->d.bufLen<JSONP_BUF_SIZE) p->d.buf[p->d.bufLen++] = ch;
+        else return jsonpNumberEnd(p); // too long - will error
+        return true;
+      }
+      return jsonpNumberEnd(p) && jsonpChar(p, ch);
+    case JSONP_WORD:
+      if (isNumericInline(ch) || isAlphaInline(ch) || ch=='$')
+        return jsonpTokenAppend(p, ch);
+      return jsonpWordEnd(p) && jsonpChar(p, ch);
+    case JSONP_COMMENT_START:
+      if (ch=='/') p->d.state = JSONP_LINE_COMMENT;
+      else if (ch=='*') p->d.state = JSONP_BLOCK_COMMENT;
+      else return jsonpUnexpected('/');
+      return true;
+    case JSONP_LINE_COMMENT:
+      if (ch=='\n') p->d.state = p->d.afterComment;
+      return true;
+    case JSONP_BLOCK_COMMENT:
+      if (ch=='*') p->d.state = JSONP_BLOCK_COMMENT_STAR;
+      return true;
+    case JSONP_BLOCK_COMMENT_STAR:
+      if (ch=='/') p->d.state = p->d.afterComment;
+      else if (ch!='*') p->d.state = JSONP_BLOCK_COMMENT;
+      return true;
+    case JSONP_DONE:
+      return true;
+    default: break;
+  }
+  // Everything else can have whitespace or comments in it
+  if (ch=='/') {
+    p->d.afterComment = p->d.state;
+    p->d.state = JSONP_COMMENT_START;
+    return true;
   }
-  default: {
-    char buf[32];
-    jslTokenAsString(lex->tk, buf, 32);
-    jsExceptionHere(JSET_SYNTAXERROR, "Expecting valid value, got %s", buf);
-    return 0; // undefined = error
+  switch (p->d.state) {
+    case JSONP_VALUE:
+      return jsonpValueChar(p, ch);
+    case JSONP_AFTER_VALUE:
+      if (ch==',')
+        p->d.state = jsvIsArray(p->container) ? JSONP_VALUE : JSONP_KEY;
+      else if (ch=='}' || ch==']')
+        return jsonpClose(p, ch);
+      else if (!isWhitespace(ch))
+        return jsonpUnexpected(ch);
+      return true;
+    case JSONP_KEY:
+      if (ch=='"' || ch=='\'') {
+        p->d.state = JSONP_STRING;
+        p->d.quote = ch;
+        p->d.flags = JSONPF_KEY;
+      } else if ((p->flags&JSON_DROP_QUOTES) && (isAlphaInline(ch) || isNumericInline(ch) || ch=='$')) {
+        p->d.state = JSONP_WORD;
+        p->d.flags = JSONPF_KEY;
+        p->d.buf[p->d.bufLen++] = ch;
+      } else if (ch=='}')
+        return jsonpClose(p, ch);
+      else if (!isWhitespace(ch))
+        return jsonpUnexpected(ch);
+      return true;
+    case JSONP_COLON:
+      if (ch==':') p->d.state = JSONP_VALUE;
+      else if (!isWhitespace(ch))
+        return jsonpUnexpected(ch);
+      return true;
+    default:
+      assert(0);
+      return false;
   }
+}
+
+/// Parse all the characters in 'data'. Returns false on error
+static bool jsonpWrite(JsonParser *p, JsVar *data) {
+  JsVar *str = jsvAsString(data);
+  if (!str) return false;
+  bool ok = true;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  while (ok && p->d.state!=JSONP_DONE && jsvStringIteratorHasChar(&it)) {
+    ok = jsonpChar(p, jsvStringIteratorGetChar(&it));
+    jsvStringIteratorNext(&it);
   }
+  jsvStringIteratorFree(&it);
+  jsvUnLock(str);
+  return ok;
+}
+
+/// There's no more data - finish anything we were reading. Returns false on error
+static bool jsonpEnd(JsonParser *p) {
+  if (p->d.state==JSONP_NUMBER && !jsonpNumberEnd(p)) return false;
+  if (p->d.state==JSONP_WORD && !jsonpWordEnd(p)) return false;
+  if (p->d.state==JSONP_LINE_COMMENT) p->d.state = p->d.afterComment;
+  if (p->d.state==JSONP_DONE || (p->d.state==JSONP_VALUE && !p->d.depth && (p->owner || p->result)))
+    return true;
+  return jsonpUnexpected(0);
+}
+
+/* Parse JSON from the given string. unquoted fields aren't normally allowed,
+   but if flags&JSON_DROP_QUOTES we'll allow them */
+JsVar *jswrap_json_parse_ext(JsVar *v, JSONFlags flags) {
+  JsonParser p;
+  jsonpInit(&p, 0, flags);
+  JsVar *res = 0;
+  if (jsonpWrite(&p, v) && jsonpEnd(&p))
+    res = jsvLockAgainSafe(p.result);
+  jsonpKill(&p);
+  return res;
 }
 
 /*JSON{
@@ -181,24 +765,195 @@ JsVar *jswrap_json_parse_internal(JSONFlags flags) {
 }
 Parse the given JSON string into a JavaScript object
 
-NOTE: This implementation uses eval() internally, and as such it is unsafe as it
-can allow arbitrary JS commands to be executed.
+To parse data that arrives in chunks (or that is too big to keep in memory as
+one String) see `JSONParser`.
  */
-JsVar *jswrap_json_parse_ext(JsVar *v, JSONFlags flags) {
-  JsLex lex;
-  JsVar *str = jsvAsString(v);
-  JsLex *oldLex = jslSetLex(&lex);
-  jslInit(str);
-  jsvUnLock(str);
-  JsVar *res = jswrap_json_parse_internal(flags);
-  jslKill();
-  jslSetLex(oldLex);
-  return res;
-}
 JsVar *jswrap_json_parse(JsVar *v) {
   return jswrap_json_parse_ext(v, 0);
 }
 
+#ifndef ESPR_NO_JSON_STREAM
+#define JSONPARSER_STATE_NAME JS_HIDDEN_CHAR_STR"st" ///< JSONParser: String containing JsonpData
+#define JSONPARSER_STACK_NAME JS_HIDDEN_CHAR_STR"stk" ///< JSONParser: Array of open containers
+#define JSONPARSER_CONTAINER_NAME JS_HIDDEN_CHAR_STR"cnt" ///< JSONParser: the container we're reading values for
+#define JSONPARSER_KEY_NAME JS_HIDDEN_CHAR_STR"key" ///< JSONParser: the key we're reading the value for
+#define JSONPARSER_TOKEN_NAME JS_HIDDEN_CHAR_STR"tok" ///< JSONParser: the String we're in the middle of reading
+
+/*JSON{
+  "type" : "class",
+  "class" : "JSONParser",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)"
+}
+(2v22+ only) Parses JSON that arrives in chunks - for example from a `Serial`
+port, a socket or a `StorageFile` - without having to store all of it first.
+
+```
+var p = new JSONParser();
+p.on('value', function(v) { print(v); });
+p.write('{"a":1');
+p.write(',"b":2}[1,2,3]');
+// prints {"a":1,"b":2} and then [1,2,3]
+```
+
+Any number of values can be written one after the other (eg. one per line).
+Parsing a big Array or Object while only keeping one element of it in memory
+at a time can be done with the `depth` option:
+
+```
+var p = new JSONParser({depth:1});
+p.on('value', function(v, key) { print(key, v); });
+require("Storage").open("log.json","r").pipe(p);
+```
+ */
+/*JSON{
+  "type" : "event",
+  "class" : "JSONParser",
+  "name" : "value",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)",
+  "params" : [
+    ["value","JsVar","The value that was parsed"],
+    ["key","JsVar","The key (or index) of the value in its Object (or Array), or `undefined` for top-level values"]
+  ]
+}
+Called when a value at the depth given in the constructor (by default, a
+top-level value) has been parsed.
+ */
+/*JSON{
+  "type" : "constructor",
+  "class" : "JSONParser",
+  "name" : "JSONParser",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)",
+  "generate" : "jswrap_jsonparser_constructor",
+  "params" : [
+    ["options","JsVar","[optional] An object containing `{depth:0}` (see below)"]
+  ],
+  "return" : ["JsVar","A JSONParser object"]
+}
+Create a parser for JSON data. `options` can contain:
+
+* `depth` - (default 0) the nesting depth of the values that are passed to the
+  `value` event. With `0` each top-level value is passed when it is complete.
+  With `1` each element of a top-level Array or Object is passed, and is not
+  stored in its container afterwards (so the container itself is never
+  passed). Values that are less deeply nested than `depth` are ignored.
+ */
+/// Reset the parser ready for new data
+static void jswrap_jsonparser_reset(JsVar *parser, unsigned short emitDepth) {
+  JsonParser p;
+  jsonpInit(&p, parser, JSON_NONE);
+  p.d.emitDepth = emitDepth;
+  jsvObjectSetChildAndUnLock(parser, JSONPARSER_STATE_NAME, jsvNewStringOfLength(sizeof(JsonpData), (char*)&p.d));
+  jsvObjectRemoveChild(parser, JSONPARSER_STACK_NAME);
+  jsvObjectRemoveChild(parser, JSONPARSER_CONTAINER_NAME);
+  jsvObjectRemoveChild(parser, JSONPARSER_KEY_NAME);
+  jsvObjectRemoveChild(parser, JSONPARSER_TOKEN_NAME);
+  jsonpKill(&p);
+}
+
+JsVar *jswrap_jsonparser_constructor(JsVar *options) {
+  int depth = 0;
+  jsvConfigObject configs[] = {
+      {"depth", JSV_INTEGER, &depth},
+  };
+  if (!jsvReadConfigObject(options, configs, sizeof(configs) / sizeof(jsvConfigObject)))
+    return 0;
+  if (depth<0 || depth>0xFFFF) {
+    jsExceptionHere(JSET_ERROR, "Invalid depth %d", depth);
+    return 0;
+  }
+  JsVar *parser = jspNewObject(0, "JSONParser");
+  if (!parser) return 0; // out of memory
+  jswrap_jsonparser_reset(parser, (unsigned short)depth);
+  return parser;
+}
+
+/// Get the parser's state out of 'parser' (removing it so we know it's in use). Returns false if we couldn't
+static bool jswrap_jsonparser_load(JsVar *parser, JsonParser *p) {
+  JsVar *state = jsvObjectGetChildIfExists(parser, JSONPARSER_STATE_NAME);
+  if (!state) {
+    jsExceptionHere(JSET_ERROR, "JSONParser is busy (can't write from a 'value' handler)");
+    return false;
+  }
+  jsonpInit(p, parser, JSON_NONE);
+  jsvGetStringChars(state, 0, (char*)&p->d, sizeof(JsonpData));
+  jsvUnLock(state);
+  p->stack = jsvObjectGetChildIfExists(parser, JSONPARSER_STACK_NAME);
+  p->container = jsvObjectGetChildIfExists(parser, JSONPARSER_CONTAINER_NAME);
+  p->key = jsvObjectGetChildIfExists(parser, JSONPARSER_KEY_NAME);
+  p->token = jsvObjectGetChildIfExists(parser, JSONPARSER_TOKEN_NAME);
+  jsvObjectRemoveChild(parser, JSONPARSER_STATE_NAME);
+  // 'key' (and 'token', which becomes the key) mustn't be referenced when it's made into a name
+  jsvObjectRemoveChild(parser, JSONPARSER_KEY_NAME);
+  jsvObjectRemoveChild(parser, JSONPARSER_TOKEN_NAME);
+  return true;
+}
+
+static void jswrap_jsonparser_setOrRemove(JsVar *parser, const char *name, JsVar *value) {
+  if (value) jsvObjectSetChild(parser, name, value);
+  else jsvObjectRemoveChild(parser, name);
+}
+
+/// Store the parser's state back in 'parser' - or reset it if there was an error
+static void jswrap_jsonparser_save(JsVar *parser, JsonParser *p, bool ok) {
+  if (ok) {
+    jsvObjectSetChildAndUnLock(parser, JSONPARSER_STATE_NAME, jsvNewStringOfLength(sizeof(JsonpData), (char*)&p->d));
+    jswrap_jsonparser_setOrRemove(parser, JSONPARSER_STACK_NAME, p->stack);
+    jswrap_jsonparser_setOrRemove(parser, JSONPARSER_CONTAINER_NAME, p->container);
+    jswrap_jsonparser_setOrRemove(parser, JSONPARSER_KEY_NAME, p->key);
+    jswrap_jsonparser_setOrRemove(parser, JSONPARSER_TOKEN_NAME, p->token);
+  } else
+    jswrap_jsonparser_reset(parser, p->d.emitDepth);
+  jsonpKill(p);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "JSONParser",
+  "name" : "write",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)",
+  "generate" : "jswrap_jsonparser_write",
+  "params" : [
+    ["data","JsVar","A String containing the next part of the JSON data"]
+  ]
+}
+Parse more JSON data. The `value` event is called for each value that is
+completed.
+
+If the data isn't valid JSON an exception is thrown, and the parser is reset
+ready for new data.
+ */
+void jswrap_jsonparser_write(JsVar *parser, JsVar *data) {
+  JsonParser p;
+  if (!jswrap_jsonparser_load(parser, &p)) return;
+  jswrap_jsonparser_save(parser, &p, jsonpWrite(&p, data));
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "JSONParser",
+  "name" : "end",
+  "#if" : "!defined(SAVE_ON_FLASH) && !defined(ESPR_NO_JSON_STREAM)",
+  "generate" : "jswrap_jsonparser_end",
+  "params" : [
+    ["data","JsVar","[optional] A String containing the last part of the JSON data"]
+  ]
+}
+Parse the last of the JSON data. This finishes off any value that didn't have
+anything after it (eg. a number), and throws an exception if the data ended in
+the middle of a value. The parser is then reset ready for new data.
+ */
+void jswrap_jsonparser_end(JsVar *parser, JsVar *data) {
+  JsonParser p;
+  if (!jswrap_jsonparser_load(parser, &p)) return;
+  if (!jsvIsUndefined(data) && !jsonpWrite(&p, data)) {
+    jswrap_jsonparser_save(parser, &p, false);
+    return;
+  }
+  jsonpEnd(&p);
+  jswrap_jsonparser_save(parser, &p, false); // reset
+}
+#endif // ESPR_NO_JSON_STREAM
+
 /* This is like jsfGetJSONWithCallback, but handles ONLY functions (and does not print the initial 'function' text) */
 void jsfGetJSONForFunctionWithCallback(JsVar *var, JSONFlags flags, vcbprintf_callback user_callback, void *user_data) {
   assert(jsvIsFunction(var));
@@ -503,6 +1258,11 @@ void jsfGetJSONWithCallback(JsVar *var, JsVar *varName, JSONFlags flags, const c
     }
   } else if ((flags&JSON_NO_NAN) && jsvIsFloat(var) && !isfinite(jsvGetFloat(var))) {
     cbprintf(user_callback, user_data, "null");
+  } else if (jsvIsSimpleInt(var) || jsvIsFloat(var)) {
+    // print numbers directly rather than allocating a String for them with %v
+    char buf[JS_NUMBER_BUFFER_SIZE];
+    jsvGetString(var, buf, sizeof(buf));
+    user_callback(buf, user_data);
   } else {
     cbprintf(user_callback, user_data, "%v", var);
   }
@@ -510,13 +1270,44 @@ void jsfGetJSONWithCallback(JsVar *var, JsVar *varName, JSONFlags flags, const c
   var->flags &= ~JSV_IS_RECURSING;
 }
 
+typedef struct {
+  jsfGetJSONFlushCallback flush;
+  void *user_data;
+  size_t len;                 ///< How many characters are in 'buf'
+  char buf[JSON_BUFFER_SIZE];
+} JsonBuffer;
+
+static void jsfGetJSONBufferCallback(const char *str, void *user_data) {
+  JsonBuffer *b = (JsonBuffer*)user_data;
+  while (*str) {
+    if (b->len>=JSON_BUFFER_SIZE) {
+      b->flush(b->buf, b->len, b->user_data);
+      b->len = 0;
+    }
+    b->buf[b->len++] = *(str++);
+  }
+}
+
+void jsfGetJSONWithBuffer(JsVar *var, JSONFlags flags, const char *whitespace, jsfGetJSONFlushCallback flush, void *user_data) {
+  JsonBuffer b;
+  b.flush = flush;
+  b.user_data = user_data;
+  b.len = 0;
+  jsfGetJSONWithCallback(var, NULL, flags, whitespace, jsfGetJSONBufferCallback, &b);
+  if (b.len) flush(b.buf, b.len, user_data);
+}
+
+static void jsfGetJSONFlushToString(const char *data, size_t len, void *user_data) {
+  jsvStringIteratorAppendBuf((JsvStringIterator*)user_data, data, len);
+}
+
 void jsfGetJSONWhitespace(JsVar *var, JsVar *result, JSONFlags flags, const char *whitespace) {
   assert(jsvIsString(result));
   JsvStringIterator it;
   jsvStringIteratorNew(&it, result, 0);
   jsvStringIteratorGotoEnd(&it);
 
-  jsfGetJSONWithCallback(var, NULL, flags, whitespace, (vcbprintf_callback)&jsvStringIteratorPrintfCallback, &it);
+  jsfGetJSONWithBuffer(var, flags, whitespace, jsfGetJSONFlushToString, &it);
 
   jsvStringIteratorFree(&it);
 }
@@ -41,6 +41,13 @@ JsVar *jswrap_json_stringify(JsVar *v, JsVar *replacer, JsVar *space);
 JsVar *jswrap_json_parse_ext(JsVar *v, JSONFlags flags);
 JsVar *jswrap_json_parse(JsVar *v);
 
+#ifndef ESPR_NO_JSON_STREAM
+JsVar *jswrap_jsonparser_constructor(JsVar *options);
+void jswrap_jsonparser_write(JsVar *parser, JsVar *data);
+void jswrap_jsonparser_end(JsVar *parser, JsVar *data);
+void jswrap_json_stringifyTo(JsVar *destination, JsVar *v, JsVar *options);
+#endif
+
 /* This is like jsfGetJSONWithCallback, but handles ONLY functions (and does not print the initial 'function' text) */
 void jsfGetJSONForFunctionWithCallback(JsVar *var, JSONFlags flags, vcbprintf_callback user_callback, void *user_data);
 /* Dump to JSON, using the given callbacks for printing data
@@ -51,6 +58,12 @@ flags = control how stuff is rendered
 */
 void jsfGetJSONWithCallback(JsVar *var, JsVar *varName, JSONFlags flags, const char *whitespace, vcbprintf_callback user_callback, void *user_data);
 
+/// Called by jsfGetJSONWithBuffer with each block of JSON
+typedef void (*jsfGetJSONFlushCallback)(const char *data, size_t len, void *user_data);
+/* Like jsfGetJSONWithCallback, but the JSON is collected in a buffer on the stack and
+ * passed to 'flush' a block at a time (rather than calling a callback for every few characters) */
+void jsfGetJSONWithBuffer(JsVar *var, JSONFlags flags, const char *whitespace, jsfGetJSONFlushCallback flush, void *user_data);
+
 /* Convenience function for using jsfGetJSONWithCallback - print to var */
 void jsfGetJSONWhitespace(JsVar *var, JsVar *result, JSONFlags flags, const char *whitespace);
 /* Convenience function for using jsfGetJSONWithCallback - print to var */
@@ -186,6 +186,22 @@ memory usage.
 * `gc` : Memory freed during the GC pass
 * `gctime` : Time taken for GC pass (in milliseconds)
 * `blocksize` : Size of a block (variable) in bytes
+* `indexedObjects` : How many large objects currently have a hash table of
+  their children to speed up lookups. Each table uses some memory (a few
+  blocks) which is included in `usage`
+* `atoms` : How many long property names are currently shared between objects.
+  Each one is stored once, however many objects have a property with that name
+* `largestFree` : The size of the largest run of contiguous free blocks. Flat
+  Strings (used for `ArrayBuffer`s and Graphics) need contiguous blocks, so this
+  limits how big they can be.
+* `eventsQueued` : How many events (eg. `Serial.on('data',...)` callbacks) have
+  been queued since startup
+* `eventsOverflowed` : How many of those events couldn't be queued without
+  allocating memory, because too many events were waiting or they had too many
+  arguments
+* `eventsExecuted` : How many queued events have been taken off the queue and
+  executed since startup. `eventsQueued-eventsExecuted` is how many are waiting
+  (plus any discarded when `reset()` was called)
 * `stackEndAddress` : (on ARM) the address (that can be used with peek/poke/etc)
   of the END of the stack. The stack grows down, so unless you do a lot of
   recursion the bytes above this can be used.
@@ -234,6 +250,12 @@ JsVar *jswrap_process_memory(JsVar *gc) {
       jsvObjectSetChildAndUnLock(obj, "gctime", jsvNewFromFloat(jshGetMillisecondsFromTime(time2-time1)));
     }
     jsvObjectSetChildAndUnLock(obj, "blocksize", jsvNewFromInteger(sizeof(JsVar)));
+    jsvObjectSetChildAndUnLock(obj, "indexedObjects", jsvNewFromInteger((JsVarInt)jsvGetIndexedObjectCount()));
+    jsvObjectSetChildAndUnLock(obj, "atoms", jsvNewFromInteger((JsVarInt)jsvGetAtomCount()));
+    jsvObjectSetChildAndUnLock(obj, "largestFree", jsvNewFromInteger((JsVarInt)jsvGetLargestFreeRun(NULL)));
+    jsvObjectSetChildAndUnLock(obj, "eventsQueued", jsvNewFromLongInteger(jsiEventsQueued));
+    jsvObjectSetChildAndUnLock(obj, "eventsOverflowed", jsvNewFromLongInteger(jsiEventsOverflowed));
+    jsvObjectSetChildAndUnLock(obj, "eventsExecuted", jsvNewFromLongInteger(jsiEventsExecuted));
 
 #ifdef ARM
     extern uint32_t LINKER_END_VAR; // end of ram used (variables) - should be 'void', but 'int' avoids warnings
@@ -25,246 +25,694 @@
  * lastIndex support?
  */
 
+/* Regular expressions are compiled (once, when the RegExp is created) into a
+ * small program which is stored in the RegExp. This is run by a 'Pike VM' -
+ * rather than backtracking, every way the regex could match is followed in
+ * step for each character of the String, so matching takes time proportional
+ * to the length of the String, and stack usage is bounded.
+ *
+ * The program starts with a header:
+ *
+ * [0] RegexFlags
+ * [1] number of capturing groups
+ * [2,3] number of instructions (plus group starts/ends cleared by RE_RESET, for sizing the stack)
+ * [4,5] number of 'states' (instructions that consume a character, or RE_MATCH)
+ *
+ * and instructions are one RegexOp byte followed by their arguments. Jumps are
+ * signed 16 bit offsets from the start of the instruction. */
+
 #define MAX_GROUPS 9
-#define NO_RANGE  256
+#define REGEX_CODE_NAME JS_HIDDEN_CHAR_STR"code" ///< RegExp: the compiled program
+#define REGEX_HEADER_SIZE 6
+#define REGEX_CLASS_SIZE 32 ///< Bytes in a character class bitmap
+#define REGEX_MAX_CODE 0x7FFF ///< Max size of program (so jumps fit in 16 bits)
+#define REGEX_MAX_REPEAT 255 ///< Max count for {n,m}
+#define REGEX_UNSET ((size_t)-1) ///< Group start/end that wasn't matched
+
+typedef enum {
+  RE_MATCH,       ///< The regex has matched
+  RE_CHAR,        ///< [char] Match a character (lowercase if ignoring case)
+  RE_ANY,         ///< Match any character
+  RE_CLASS,       ///< [32 byte bitmap] Match any character in the set
+  RE_BOL,         ///< Beginning of the String
+  RE_EOL,         ///< End of the String
+  RE_WORD_BOUNDARY,     ///< \b
+  RE_NOT_WORD_BOUNDARY, ///< \B
+  RE_SAVE,        ///< [slot] Store the current position in the given group start/end
+  RE_RESET,       ///< [from][to] Clear group starts/ends from..to (each time a repeated group is entered)
+  RE_SPLIT,       ///< [x16][y16] Try x, then (with lower priority) y
+  RE_JMP,         ///< [x16] Jump to x
+} PACKED_FLAGS RegexOp;
+
+typedef enum {
+  REF_IGNORE_CASE = 1, ///< 'i' flag
+  REF_ANCHORED    = 2, ///< Program starts with '^', so can only match at the start of the String
+} PACKED_FLAGS RegexFlags;
+
+// ---------------------------------------------------------------------------- Compiler
 
 typedef struct {
-  JsVar *sourceStr;
-  size_t startIndex;
+  const char *src;       ///< The regex source
+  size_t srcLen, srcIdx;
+  unsigned char *code;   ///< The program, or 0 if we're just working out how big it'll be
+  size_t pc;             ///< Where we are in the program
+  unsigned int instrs;   ///< Number of instructions in the program
+  unsigned int states;   ///< Number of instructions that consume a character, or RE_MATCH
+  int groups;            ///< Number of capturing groups
   bool ignoreCase;
-  bool rangeMatch;
-  short rangeFirstChar;
-  int groups;
-  size_t groupStart[MAX_GROUPS];
-  size_t groupEnd[MAX_GROUPS];
-} matchInfo;
+  bool error;
+} RegexCompiler;
 
-static JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info);
+static bool regexIsWordChar(int ch) {
+  return ch>=0 && (isNumeric((char)ch) || isAlpha((char)ch));
+}
 
-static JsVar *matchfound(JsvStringIterator *txtIt, matchInfo info) {
-  JsVar *rmatch = jsvNewEmptyArray();
-  size_t endIndex = jsvStringIteratorGetIndex(txtIt);
-  JsVar *matchStr = jsvNewFromStringVar(info.sourceStr, info.startIndex, endIndex-info.startIndex);
-  jsvSetArrayItem(rmatch, 0, matchStr);
-  jsvUnLock(matchStr);
-  int i;
-  for (i=0;i<info.groups;i++) {
-    matchStr = jsvNewFromStringVar(info.sourceStr, info.groupStart[i], info.groupEnd[i]-info.groupStart[i]);
-    jsvSetArrayItem(rmatch, i+1, matchStr);
-    jsvUnLock(matchStr);
+static int regexPeek(RegexCompiler *c) {
+  return (c->srcIdx < c->srcLen) ? (unsigned char)c->src[c->srcIdx] : -1;
+}
+
+static int regexNext(RegexCompiler *c) {
+  return (c->srcIdx < c->srcLen) ? (unsigned char)c->src[c->srcIdx++] : -1;
+}
+
+static void regexError(RegexCompiler *c, const char *msg) {
+  if (!c->error) jsExceptionHere(JSET_SYNTAXERROR, "%s in RegEx", msg);
+  c->error = true;
+}
+
+static void regexEmit(RegexCompiler *c, int byte) {
+  if (c->pc >= REGEX_MAX_CODE) {
+    regexError(c, "Too big");
+    return;
   }
-  jsvObjectSetChildAndUnLock(rmatch, "index", jsvNewFromInteger((JsVarInt)info.startIndex));
-  jsvObjectSetChild(rmatch, "input", info.sourceStr);
+  if (c->code) c->code[c->pc] = (unsigned char)byte;
+  c->pc++;
+}
 
-  return rmatch;
+/// Set the jump at 'at' to go to 'to' (relative to 'instr')
+static void regexSetJump(RegexCompiler *c, size_t instr, size_t at, size_t to) {
+  if (!c->code || c->error) return;
+  int offset = (int)to - (int)instr;
+  c->code[at] = (unsigned char)(offset & 0xFF);
+  c->code[at+1] = (unsigned char)((offset >> 8) & 0xFF);
 }
 
-// No match found, so search to end of regex to see if there's an '|'
-static JsVar *nomatchfound(char *regexp, matchInfo info) {
-  if (!jspCheckStackPosition()) return 0;
-  // TODO: | inside a group?
-  while (*regexp && *regexp!='|') {
-    if (*regexp=='\\') {
-      regexp++; // end of regex after escape char!
-      if (!*regexp) return 0;
-    }
-    regexp++;
+/// Emit RE_SPLIT - the first jump target is the next instruction, the second is 'y'. If !greedy they're swapped
+static void regexEmitSplit(RegexCompiler *c, size_t y, bool greedy) {
+  size_t instr = c->pc;
+  regexEmit(c, RE_SPLIT);
+  regexEmit(c, 0);regexEmit(c, 0);
+  regexEmit(c, 0);regexEmit(c, 0);
+  regexSetJump(c, instr, instr+(greedy?1:3), instr+5);
+  regexSetJump(c, instr, instr+(greedy?3:1), y);
+  c->instrs++;
+}
+
+/// Make room for 'len' bytes of code at 'at'
+static void regexInsert(RegexCompiler *c, size_t at, size_t len) {
+  if (c->pc+len > REGEX_MAX_CODE) {
+    regexError(c, "Too big");
+    return;
   }
-  if (*regexp != '|') return 0;
-  regexp++;
+  if (c->code) memmove(&c->code[at+len], &c->code[at], c->pc-at);
+  c->pc += len;
+}
 
-  JsvStringIterator txtIt;
-  jsvStringIteratorNew(&txtIt,  info.sourceStr, info.startIndex);
-  JsVar *rmatch = matchhere(regexp, &txtIt, info);
-  jsvStringIteratorFree(&txtIt);
-  return rmatch;
+static void regexClassAdd(unsigned char *bitmap, int ch) {
+  bitmap[ch>>3] = (unsigned char)(bitmap[ch>>3] | (1<<(ch&7)));
+}
+
+static bool regexClassHas(const unsigned char *bitmap, int ch) {
+  return (bitmap[ch>>3] & (1<<(ch&7))) != 0;
 }
 
-/* match: search for regexp anywhere in text */
-static JsVar *match(char *regexp, JsVar *str, size_t startIndex, bool ignoreCase) {
-  matchInfo info;
-  info.sourceStr = str;
-  info.startIndex = startIndex;
-  info.ignoreCase = ignoreCase;
-  info.rangeMatch = false;
-  info.rangeFirstChar = NO_RANGE;
-  info.groups = 0;
-
-  JsVar *rmatch;
-  JsvStringIterator txtIt, txtIt2;
-  jsvStringIteratorNew(&txtIt, str, startIndex);
-  /* must look even if string is empty */
-  jsvStringIteratorClone(&txtIt2, &txtIt);
-  rmatch = matchhere(regexp, &txtIt2, info);
-  jsvStringIteratorFree(&txtIt2);
-  jsvStringIteratorNext(&txtIt);
-  while (!rmatch && jsvStringIteratorHasChar(&txtIt)) {
-    info.startIndex++;
-    jsvStringIteratorClone(&txtIt2, &txtIt);
-    rmatch = matchhere(regexp, &txtIt2, info);
-    jsvStringIteratorFree(&txtIt2);
-    jsvStringIteratorNext(&txtIt);
+/// Add the characters for \d,\s,\w (and their inverses) to a class. Returns false if 'ch' isn't one of them
+static bool regexClassAddEscape(unsigned char *bitmap, int ch) {
+  char lower = charToLowerCase((char)ch);
+  if (lower!='d' && lower!='s' && lower!='w') return false;
+  bool invert = lower!=ch;
+  for (int i=0;i<256;i++) {
+    bool has;
+    if (lower=='d') has = isNumeric((char)i);
+    else if (lower=='s') has = isWhitespace((char)i);
+    else has = regexIsWordChar(i);
+    if (has != invert) regexClassAdd(bitmap, i);
   }
-  jsvStringIteratorFree(&txtIt);
-  return rmatch;
+  return true;
 }
 
-/* Match one character. Doesn't modify txtIt, returns length of regexp char in *length  */
-bool matchcharacter(char *regexp, JsvStringIterator *txtIt, int *length, matchInfo *info) {
-  *length = 1;
-  char ch = jsvStringIteratorGetChar(txtIt);
-  if (regexp[0]=='.') return true;
-  if (regexp[0]=='[') { // Character set (any char inside '[]')
-    info->rangeMatch = true;
-    bool inverted = regexp[1]=='^';
-    if (inverted) (*length)++;
-    bool matchAny = false;
-    while (regexp[*length] && regexp[*length]!=']') {
-      int matchLen;
-      if (regexp[*length]=='.') { // https://github.com/espruino/Espruino/issues/1948
-        matchAny |= ch=='.';
-        (*length)++;
+/// Emit a class. If 'invert', match everything that isn't in 'bitmap'
+static void regexEmitClass(RegexCompiler *c, const unsigned char *bitmap, bool invert) {
+  unsigned char folded[REGEX_CLASS_SIZE];
+  memset(folded, 0, sizeof(folded));
+  for (int i=0;i<256;i++) {
+    bool has = regexClassHas(bitmap, i);
+    if (c->ignoreCase)
+      has |= regexClassHas(bitmap, (unsigned char)charToLowerCase((char)i)) ||
+             regexClassHas(bitmap, (unsigned char)charToUpperCase((char)i));
+    if (has != invert) regexClassAdd(folded, i);
+  }
+  regexEmit(c, RE_CLASS);
+  for (int i=0;i<REGEX_CLASS_SIZE;i++)
+    regexEmit(c, folded[i]);
+  c->instrs++;
+  c->states++;
+}
+
+static void regexEmitChar(RegexCompiler *c, int ch) {
+  regexEmit(c, RE_CHAR);
+  regexEmit(c, c->ignoreCase ? (unsigned char)charToLowerCase((char)ch) : ch);
+  c->instrs++;
+  c->states++;
+}
+
+/// Parse the character after a '\' that's just a character (not \d/\b/etc). Returns -1 on error
+static int regexParseEscapeChar(RegexCompiler *c, int ch) {
+  switch (ch) {
+    case 'f': return 0x0C;
+    case 'n': return 0x0A;
+    case 'r': return 0x0D;
+    case 't': return 0x09;
+    case 'v': return 0x0B;
+    case '0': return 0;
+    case 'x':
+      if (c->srcIdx+1 < c->srcLen) {
+        int v = hexToByte(c->src[c->srcIdx], c->src[c->srcIdx+1]);
+        if (v>=0) {
+          c->srcIdx += 2;
+          return v;
+        }
+      }
+      return 'x';
+    case -1:
+      regexError(c, "Unfinished escape");
+      return -1;
+    default:
+      if (ch>='1' && ch<='9') {
+        regexError(c, "Backreferences not supported");
+        return -1;
+      }
+      return ch; // the quoted character (e.g. /,-,? etc.)
+  }
+}
+
+/// Parse a character set (we're just after the '[')
+static void regexParseClass(RegexCompiler *c) {
+  unsigned char bitmap[REGEX_CLASS_SIZE];
+  memset(bitmap, 0, sizeof(bitmap));
+  bool invert = regexPeek(c)=='^';
+  if (invert) c->srcIdx++;
+  while (regexPeek(c)>=0 && regexPeek(c)!=']') {
+    int ch = regexNext(c);
+    if (ch=='\\') {
+      ch = regexNext(c);
+      if (regexClassAddEscape(bitmap, ch)) continue;
+      if (ch=='b') ch = 0x08; // backspace inside a set
+      else ch = regexParseEscapeChar(c, ch);
+      if (ch<0) return;
+    }
+    // Character set range?
+    if (regexPeek(c)=='-' && c->srcIdx+1<c->srcLen && c->src[c->srcIdx+1]!=']') {
+      c->srcIdx++; // '-'
+      int last = regexNext(c);
+      if (last=='\\') {
+        last = regexParseEscapeChar(c, regexNext(c));
+        if (last<0) return;
+      }
+      for (int i=ch;i<=last;i++)
+        regexClassAdd(bitmap, i);
+    } else
+      regexClassAdd(bitmap, ch);
+  }
+  if (regexNext(c)!=']') {
+    regexError(c, "Unfinished character set");
+    return;
+  }
+  regexEmitClass(c, bitmap, invert);
+}
+
+static void regexParseAlternation(RegexCompiler *c);
+
+/// Parse one item of the regex (not including '*'/'+'/etc after it). Returns false if there wasn't one
+static bool regexParseAtom(RegexCompiler *c) {
+  int ch = regexPeek(c);
+  if (ch<0 || ch=='|' || ch==')') return false;
+  c->srcIdx++;
+  switch (ch) {
+    case '^': regexEmit(c, RE_BOL); c->instrs++; break;
+    case '$': regexEmit(c, RE_EOL); c->instrs++; break;
+    case '.': regexEmit(c, RE_ANY); c->instrs++; c->states++; break;
+    case '[': regexParseClass(c); break;
+    case '*': case '+': case '?':
+      regexError(c, "Nothing to repeat");
+      break;
+    case '(': {
+      int group = 0;
+      if (regexPeek(c)=='?') {
+        if (c->srcIdx+1<c->srcLen && c->src[c->srcIdx+1]==':') {
+          c->srcIdx += 2; // non-capturing
+        } else {
+          regexError(c, "Unsupported group");
+          break;
+        }
+      } else if (c->groups < MAX_GROUPS)
+        group = ++c->groups;
+      if (group) {
+        regexEmit(c, RE_SAVE); regexEmit(c, group*2); c->instrs++;
+      }
+      if (!jspCheckStackPosition()) {
+        c->error = true;
+        break;
+      }
+      regexParseAlternation(c);
+      if (regexNext(c)!=')') {
+        regexError(c, "Unfinished group");
+        break;
+      }
+      if (group) {
+        regexEmit(c, RE_SAVE); regexEmit(c, group*2+1); c->instrs++;
+      }
+    } break;
+    case '\\': {
+      ch = regexNext(c);
+      unsigned char bitmap[REGEX_CLASS_SIZE];
+      memset(bitmap, 0, sizeof(bitmap));
+      if (ch=='b' || ch=='B') {
+        regexEmit(c, (ch=='b') ? RE_WORD_BOUNDARY : RE_NOT_WORD_BOUNDARY);
+        c->instrs++;
+      } else if (regexClassAddEscape(bitmap, ch)) {
+        regexEmitClass(c, bitmap, false);
       } else {
-        matchAny |= matchcharacter(&regexp[*length], txtIt, &matchLen, info);
-        (*length) += matchLen;
+        ch = regexParseEscapeChar(c, ch);
+        if (ch>=0) regexEmitChar(c, ch);
       }
+    } break;
+    default:
+      regexEmitChar(c, ch);
+      break;
+  }
+  return !c->error;
+}
+
+/// Parse a number for {n,m}, or return -1
+static int regexParseCount(RegexCompiler *c) {
+  int n = -1;
+  while (c->srcIdx<c->srcLen && isNumeric(c->src[c->srcIdx])) {
+    n = ((n<0)?0:n*10) + (c->src[c->srcIdx++]-'0');
+    if (n>REGEX_MAX_REPEAT) n = REGEX_MAX_REPEAT+1;
+  }
+  return n;
+}
+
+/// Parse '*'/'+'/'?'/'{n,m}' after an atom. Returns false if there wasn't one
+static bool regexParseQuantifier(RegexCompiler *c, int *min, int *max) {
+  int ch = regexPeek(c);
+  if (ch=='*') { *min = 0; *max = -1; }
+  else if (ch=='+') { *min = 1; *max = -1; }
+  else if (ch=='?') { *min = 0; *max = 1; }
+  else if (ch=='{') {
+    size_t start = c->srcIdx++;
+    *min = regexParseCount(c);
+    *max = *min;
+    if (regexPeek(c)==',') {
+      c->srcIdx++;
+      *max = regexParseCount(c); // -1 = no limit
     }
-    if (regexp[*length]==']') {
-      (*length)++;
-    } else {
-      jsExceptionHere(JSET_ERROR, "Unfinished character set in RegEx");
+    if (*min<0 || regexPeek(c)!='}') { // not valid - so treat '{' as a normal character
+      c->srcIdx = start;
       return false;
     }
-    info->rangeMatch = false;
-    return matchAny != inverted;
-  }
-  char cH = regexp[0];
-  if (cH=='\\') { // escape character
-    *length = 2;
-    // fallback to the quoted character (e.g. /,-,? etc.)
-    cH = regexp[1];
-    // missing quite a few here
-    // https://developer.mozilla.org/en-US/docs/Web/JavaScript/Guide/Regular_Expressions
-    if (cH=='d') return isNumeric(ch);
-    if (cH=='D') return !isNumeric(ch);
-    if (cH=='f') { cH=0x0C; goto haveCode; }
-    if (cH=='b') { cH=0x08; goto haveCode; }
-    if (cH=='n') { cH=0x0A; goto haveCode; }
-    if (cH=='r') { cH=0x0D; goto haveCode; }
-    if (cH=='s') return isWhitespace(ch);
-    if (cH=='S') return !isWhitespace(ch);
-    if (cH=='t') { cH=0x09; goto haveCode; }
-    if (cH=='v') { cH=0x0B; goto haveCode; }
-    if (cH=='w') return isNumeric(ch) || isAlpha(ch) || ch=='_';
-    if (cH=='W') return !(isNumeric(ch) || isAlpha(ch) || ch=='_');
-    if (cH=='0') { cH=0; goto haveCode; }
-    if (cH>='1' && cH<='9') {
-      jsExceptionHere(JSET_ERROR, "Backreferences not supported");
+    if (*min>REGEX_MAX_REPEAT || *max>REGEX_MAX_REPEAT || (*max>=0 && *max<*min)) {
+      regexError(c, "Invalid repeat count");
       return false;
-      // we could implement this if needed by matching against info->groupStart/End
     }
-    if (cH=='x' && regexp[2] && regexp[3]) {
-      *length = 4;
-      cH = (char)hexToByte(regexp[2],regexp[3]);
-      goto haveCode;
+  } else return false;
+  c->srcIdx++;
+  return true;
+}
+
+/// Parse an item and anything that repeats it
+static void regexParseTerm(RegexCompiler *c) {
+  size_t start = c->pc;
+  unsigned int instrs = c->instrs, states = c->states;
+  int groups = c->groups;
+  if (!regexParseAtom(c)) return;
+  int min, max;
+  if (!regexParseQuantifier(c, &min, &max)) return;
+  if (c->groups>groups && (max<0 || max>1)) {
+    // groups inside are cleared each time round, so /((a)|b)+/.exec("ab") gives ["ab","b",undefined]
+    regexInsert(c, start, 3);
+    if (c->code) {
+      c->code[start] = RE_RESET;
+      c->code[start+1] = (unsigned char)((groups+1)*2);
+      c->code[start+2] = (unsigned char)(c->groups*2+1);
     }
+    c->instrs += (unsigned int)(c->groups-groups)*2;
   }
-haveCode:
-  if (info->rangeMatch && regexp[*length] == '-' && regexp[1+*length] != ']') { // Character set range start
-    info->rangeFirstChar = cH;
-    (*length)++;
-    int matchLen;
-    bool match = matchcharacter(&regexp[*length], txtIt, &matchLen, info);
-    (*length)+=matchLen;
-    return match;
+  bool greedy = true;
+  if (regexPeek(c)=='?') {
+    c->srcIdx++;
+    greedy = false;
   }
-  if (info->ignoreCase) {
-    ch = charToLowerCase(ch);
-    cH = charToLowerCase(cH);
-  }
-  if (info->rangeFirstChar != NO_RANGE) { // Character set range
-    char cL = (char)info->rangeFirstChar;
-    if (info->ignoreCase) {
-      cL = charToLowerCase(cL);
+  // Take the code for the atom out, and then add as many copies as we need
+  size_t len = c->pc - start;
+  unsigned int atomInstrs = c->instrs - instrs, atomStates = c->states - states;
+  unsigned char *atom = 0;
+  if (c->code) {
+    if (len+256 > jsuGetFreeStack()) {
+      regexError(c, "Too big");
+      return;
     }
-    info->rangeFirstChar = NO_RANGE;
-    return (ch >= cL && ch <= cH && cL < cH);
+    atom = (unsigned char*)alloca(len);
+    memcpy(atom, &c->code[start], len);
   }
-  return cH==ch;
-}
-
-/* matchhere: search for regexp at beginning of text. Only handles up to '|' character. Modifies txtIt */
-static JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info) {
-  if (jspIsInterrupted()) return 0;
-  if (regexp[0] == '\0' || // end of regex
-      regexp[0] == '|') // end of this 'or' section of regex
-    return matchfound(txtIt, info);
-  if (regexp[0] == '^') { // must be beginning of String
-    if (jsvStringIteratorGetIndex(txtIt)!=0)
-      return 0; // no match
-    if (!jspCheckStackPosition()) return 0;
-    return matchhere(regexp+1, txtIt, info);
+  c->pc = start;
+  c->instrs = instrs;
+  c->states = states;
+  int copies = (max<0) ? ((min>0) ? min : 1) : max;
+  for (int i=0;i<copies && !c->error;i++) {
+    bool optional = i>=min;
+    size_t atomStart = c->pc;
+    if (optional) // skip over the atom (and the jump back if there's no limit)
+      regexEmitSplit(c, c->pc + 5 + len + ((max<0)?3:0), greedy);
+    if (c->pc+len > REGEX_MAX_CODE) {
+      regexError(c, "Too big");
+      return;
+    }
+    if (c->code) memcpy(&c->code[c->pc], atom, len);
+    c->pc += len;
+    c->instrs += atomInstrs;
+    c->states += atomStates;
+    if (max<0 && i==copies-1) {
+      if (optional) { // jump back to the split
+        size_t instr = c->pc;
+        regexEmit(c, RE_JMP); regexEmit(c, 0); regexEmit(c, 0);
+        regexSetJump(c, instr, instr+1, atomStart);
+        c->instrs++;
+      } else { // match the last copy again?
+        size_t instr = c->pc;
+        regexEmitSplit(c, c->pc + 5, greedy);
+        regexSetJump(c, instr, instr+(greedy?1:3), atomStart);
+      }
+    }
   }
-  // Marker for end of String
-  if (regexp[0] == '$') {
-    if (!jsvStringIteratorHasChar(txtIt))
-      return matchhere(regexp+1, txtIt, info);
-    else
-      return nomatchfound(regexp+1, info); // not the end, it's a fail
+}
+
+/// Parse items up until a '|' or ')'
+static void regexParseSequence(RegexCompiler *c) {
+  while (!c->error && regexPeek(c)>=0 && regexPeek(c)!='|' && regexPeek(c)!=')')
+    regexParseTerm(c);
+}
+
+/// Parse sequences separated by '|'
+static void regexParseAlternation(RegexCompiler *c) {
+  size_t start = c->pc;
+  regexParseSequence(c);
+  if (c->error || regexPeek(c)!='|') return;
+  c->srcIdx++;
+  // Try this sequence first, otherwise jump to the rest of the alternatives
+  regexInsert(c, start, 5);
+  size_t jmp = c->pc;
+  regexEmit(c, RE_JMP); regexEmit(c, 0); regexEmit(c, 0);
+  c->instrs++;
+  size_t split = c->pc;
+  c->pc = start; // fill in the split we made room for
+  regexEmitSplit(c, split, true);
+  c->pc = split;
+  regexParseAlternation(c);
+  regexSetJump(c, jmp, jmp+1, c->pc); // after the first sequence, jump to the end
+}
+
+/// Compile the regex. Returns the size of the program, and writes it to 'code' if it's nonzero
+static size_t regexCompile(RegexCompiler *c, const char *src, size_t srcLen, bool ignoreCase, unsigned char *code) {
+  memset(c, 0, sizeof(RegexCompiler));
+  c->src = src;
+  c->srcLen = srcLen;
+  c->ignoreCase = ignoreCase;
+  c->code = code ? &code[REGEX_HEADER_SIZE] : 0;
+  regexEmit(c, RE_SAVE); regexEmit(c, 0); c->instrs++;
+  regexParseAlternation(c);
+  if (!c->error && regexPeek(c)==')') regexError(c, "Unmatched ')'");
+  regexEmit(c, RE_SAVE); regexEmit(c, 1); c->instrs++;
+  regexEmit(c, RE_MATCH); c->instrs++; c->states++;
+  if (c->error) return 0;
+  if (code) {
+    RegexFlags flags = 0;
+    if (ignoreCase) flags |= REF_IGNORE_CASE;
+    if (c->code[2]==RE_BOL) flags |= REF_ANCHORED;
+    code[0] = flags;
+    code[1] = (unsigned char)c->groups;
+    code[2] = (unsigned char)(c->instrs & 0xFF);
+    code[3] = (unsigned char)(c->instrs >> 8);
+    code[4] = (unsigned char)(c->states & 0xFF);
+    code[5] = (unsigned char)(c->states >> 8);
   }
-  if (regexp[0] == '(') {
-    info.groupStart[info.groups] = jsvStringIteratorGetIndex(txtIt);
-    info.groupEnd[info.groups] = info.groupStart[info.groups];
-    if (info.groups<MAX_GROUPS) info.groups++;
-    if (!jspCheckStackPosition()) return 0;
-    return matchhere(regexp+1, txtIt, info);
+  return REGEX_HEADER_SIZE + c->pc;
+}
+
+/// Compile the regex in 'source' into a String, or return 0 (with an exception) on error
+static JsVar *regexCompileVar(JsVar *source, bool ignoreCase) {
+  size_t srcLen = jsvGetStringLength(source);
+  if (srcLen+256 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "Not enough stack memory for RegEx");
+    return 0;
   }
-  if (regexp[0] == ')') {
-    if (info.groups>0)
-      info.groupEnd[info.groups-1] = jsvStringIteratorGetIndex(txtIt);
-    if (!jspCheckStackPosition()) return 0;
-    return matchhere(regexp+1, txtIt, info);
+  char *src = (char *)alloca(srcLen+1);
+  jsvGetString(source, src, srcLen+1);
+  RegexCompiler c;
+  size_t len = regexCompile(&c, src, srcLen, ignoreCase, 0);
+  if (!len) return 0;
+  JsVar *codeVar = jsvNewFlatStringOfLength((unsigned int)len);
+  if (codeVar) {
+    regexCompile(&c, src, srcLen, ignoreCase, (unsigned char*)jsvGetFlatStringPointer(codeVar));
+  } else { // couldn't get a flat string - use a normal one
+    if (len+256 > jsuGetFreeStack()) {
+      jsExceptionHere(JSET_ERROR, "Not enough stack memory for RegEx");
+      return 0;
+    }
+    unsigned char *code = (unsigned char *)alloca(len);
+    regexCompile(&c, src, srcLen, ignoreCase, code);
+    codeVar = jsvNewStringOfLength((unsigned int)len, (char*)code);
   }
-  int charLength;
-  bool charMatched = matchcharacter(regexp, txtIt, &charLength, &info);
-  if (regexp[charLength] == '*' || regexp[charLength] == '+') {
-    char op = regexp[charLength];
-    if (!charMatched && op=='+') {
-      // with '+' operator it has to match at least once
-      return nomatchfound(&regexp[charLength+1], info);
+  return codeVar;
+}
+
+// ---------------------------------------------------------------------------- Matcher
+
+typedef struct {
+  unsigned int count;
+  unsigned short *pc;
+  size_t *caps;          ///< 'capCount' group starts/ends for each thread
+} RegexThreadList;
+
+typedef struct {
+  unsigned short pc;     ///< Instruction to run, or REGEX_RESTORE
+  unsigned char slot;    ///< For REGEX_RESTORE, the group start/end to restore
+  size_t value;          ///< For REGEX_RESTORE, the value to restore
+} RegexStackEntry;
+#define REGEX_RESTORE 0xFFFF
+
+typedef struct {
+  const unsigned char *code; ///< Program (not including header)
+  unsigned int capCount;     ///< Number of group starts/ends
+  unsigned char *marks;      ///< Bitmap of instructions that we've already added to the current list
+  RegexStackEntry *stack;
+  size_t pos;                ///< Index in the String
+  int prevCh, ch;            ///< Characters before and at 'pos' (or -1)
+} RegexMatcher;
+
+static int regexGetJump(const unsigned char *code, unsigned int pc, unsigned int at) {
+  return (int)pc + (short)(code[at] | (code[at+1]<<8));
+}
+
+/* Follow everything that doesn't consume a character from 'pc', adding the
+ * instructions that do (in priority order) to 'list'. 'caps' is left unchanged. */
+static void regexAddThread(RegexMatcher *m, RegexThreadList *list, unsigned int pc, size_t *caps) {
+  const unsigned char *code = m->code;
+  unsigned int sp = 0;
+  m->stack[sp++].pc = (unsigned short)pc;
+  while (sp) {
+    RegexStackEntry *e = &m->stack[--sp];
+    if (e->pc == REGEX_RESTORE) {
+      caps[e->slot] = e->value;
+      continue;
     }
-    char *regexpAfterStar = regexp+charLength+1;
-    JsvStringIterator txtIt2;
-    // Try and match everything after right now
-    jsvStringIteratorClone(&txtIt2, txtIt);
-    JsVar *lastrmatch = matchhere(regexpAfterStar, &txtIt2, info);
-    jsvStringIteratorFree(&txtIt2);
-    // Otherwise try and match more than one
-    while (jsvStringIteratorHasChar(txtIt) && charMatched) {
-      // We had this character matched, so move on and see if we can match with the new one
-      jsvStringIteratorNext(txtIt);
-      charMatched = matchcharacter(regexp, txtIt, &charLength, &info);
-      // See if we can match after the character...
-      jsvStringIteratorClone(&txtIt2, txtIt);
-      JsVar *rmatch = matchhere(regexpAfterStar, &txtIt2, info);
-      jsvStringIteratorFree(&txtIt2);
-      // can't match with this - use the last one
-      if (rmatch) {
-        jsvUnLock(lastrmatch);
-        lastrmatch = rmatch;
-      }
+    pc = e->pc;
+    if (m->marks[pc>>3] & (1<<(pc&7))) continue; // already added
+    m->marks[pc>>3] = (unsigned char)(m->marks[pc>>3] | (1<<(pc&7)));
+    switch ((RegexOp)code[pc]) {
+      case RE_JMP:
+        m->stack[sp++].pc = (unsigned short)regexGetJump(code, pc, pc+1);
+        break;
+      case RE_SPLIT: // push the lower priority one first
+        m->stack[sp++].pc = (unsigned short)regexGetJump(code, pc, pc+3);
+        m->stack[sp++].pc = (unsigned short)regexGetJump(code, pc, pc+1);
+        break;
+      case RE_SAVE: {
+        unsigned char slot = code[pc+1];
+        e = &m->stack[sp++];
+        e->pc = REGEX_RESTORE;
+        e->slot = slot;
+        e->value = caps[slot];
+        caps[slot] = m->pos;
+        m->stack[sp++].pc = (unsigned short)(pc+2);
+      } break;
+      case RE_RESET: {
+        for (unsigned char slot=code[pc+1];slot<=code[pc+2];slot++) {
+          e = &m->stack[sp++];
+          e->pc = REGEX_RESTORE;
+          e->slot = slot;
+          e->value = caps[slot];
+          caps[slot] = REGEX_UNSET;
+        }
+        m->stack[sp++].pc = (unsigned short)(pc+3);
+      } break;
+      case RE_BOL:
+        if (m->pos==0) m->stack[sp++].pc = (unsigned short)(pc+1);
+        break;
+      case RE_EOL:
+        if (m->ch<0) m->stack[sp++].pc = (unsigned short)(pc+1);
+        break;
+      case RE_WORD_BOUNDARY:
+      case RE_NOT_WORD_BOUNDARY:
+        if ((regexIsWordChar(m->prevCh) != regexIsWordChar(m->ch)) == (code[pc]==RE_WORD_BOUNDARY))
+          m->stack[sp++].pc = (unsigned short)(pc+1);
+        break;
+      default: // consumes a character, or RE_MATCH
+        list->pc[list->count] = (unsigned short)pc;
+        memcpy(&list->caps[list->count*m->capCount], caps, m->capCount*sizeof(size_t));
+        list->count++;
+        break;
     }
-    return lastrmatch;
   }
+}
 
-  // This character is matched
-  if (jsvStringIteratorHasChar(txtIt) && charMatched) {
-    jsvStringIteratorNext(txtIt);
-    if (!jspCheckStackPosition()) return 0;
-    return matchhere(regexp+charLength, txtIt, info);
+static JsVar *regexMatchFound(JsVar *str, size_t *caps, unsigned int groups) {
+  JsVar *rmatch = jsvNewEmptyArray();
+  if (!rmatch) return 0;
+  for (unsigned int i=0;i<=groups;i++) {
+    JsVar *matchStr = 0;
+    if (caps[i*2]!=REGEX_UNSET && caps[i*2+1]!=REGEX_UNSET)
+      matchStr = jsvNewFromStringVar(str, caps[i*2], caps[i*2+1]-caps[i*2]);
+    jsvSetArrayItem(rmatch, (JsVarInt)i, matchStr); // unmatched groups are undefined
+    jsvUnLock(matchStr);
   }
-  // No match
-  return nomatchfound(&regexp[charLength], info);
+  jsvSetArrayLength(rmatch, (JsVarInt)groups+1, false);
+  jsvObjectSetChildAndUnLock(rmatch, "index", jsvNewFromInteger((JsVarInt)caps[0]));
+  jsvObjectSetChild(rmatch, "input", str);
+  return rmatch;
+}
+
+/* Search for the regex in 'str' starting at 'startIndex' */
+static JsVar *regexMatch(const unsigned char *program, size_t programLen, JsVar *str, size_t startIndex) {
+  RegexFlags flags = program[0];
+  unsigned int groups = program[1];
+  unsigned int instrs = (unsigned int)(program[2] | (program[3]<<8));
+  unsigned int states = (unsigned int)(program[4] | (program[5]<<8));
+  size_t codeLen = programLen - REGEX_HEADER_SIZE;
+  RegexMatcher m;
+  m.code = &program[REGEX_HEADER_SIZE];
+  m.capCount = (groups+1)*2;
+  // Work out how much memory we need and allocate it on the stack
+  size_t capsSize = m.capCount*sizeof(size_t);
+  size_t listSize = states*(sizeof(unsigned short) + capsSize);
+  size_t stackSize = (instrs*2+1)*sizeof(RegexStackEntry);
+  size_t marksSize = (codeLen+7)>>3;
+  if (3*listSize + 2*capsSize + stackSize + marksSize + 256 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "RegEx too complex");
+    return 0;
+  }
+  RegexThreadList lists[3];
+  for (int i=0;i<3;i++) {
+    lists[i].count = 0;
+    lists[i].caps = (size_t*)alloca(states*capsSize);
+    lists[i].pc = (unsigned short*)alloca(states*sizeof(unsigned short));
+  }
+  RegexThreadList *pending = &lists[0]; // threads waiting to run at 'pos'
+  RegexThreadList *run = &lists[1];     // threads that run at 'pos'
+  RegexThreadList *next = &lists[2];    // threads waiting to run at pos+1
+  size_t *caps = (size_t*)alloca(capsSize);
+  size_t *matchCaps = (size_t*)alloca(capsSize);
+  m.stack = (RegexStackEntry*)alloca(stackSize);
+  m.marks = (unsigned char*)alloca(marksSize);
+  // If the program starts with a character, we can skip to where that is
+  int firstChar = (m.code[2]==RE_CHAR) ? m.code[3] : -1;
+
+  bool matched = false;
+  m.pos = startIndex;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, startIndex ? startIndex-1 : 0);
+  m.prevCh = -1;
+  if (startIndex) {
+    m.prevCh = (unsigned char)jsvStringIteratorGetChar(&it);
+    jsvStringIteratorNext(&it);
+  }
+  while (!jspIsInterrupted()) {
+    m.ch = jsvStringIteratorHasChar(&it) ? (unsigned char)jsvStringIteratorGetChar(&it) : -1;
+    if (!matched && !pending->count) {
+      if ((flags&REF_ANCHORED) && m.pos>0) break; // can't start matching now
+      if (firstChar>=0) { // skip to where the first character is
+        while (m.ch>=0 && ((flags&REF_IGNORE_CASE) ? (unsigned char)charToLowerCase((char)m.ch) : m.ch)!=firstChar) {
+          m.prevCh = m.ch;
+          jsvStringIteratorNext(&it);
+          m.pos++;
+          m.ch = jsvStringIteratorHasChar(&it) ? (unsigned char)jsvStringIteratorGetChar(&it) : -1;
+        }
+        if (m.ch<0) break;
+      }
+    }
+    // Follow everything that doesn't consume a character
+    memset(m.marks, 0, marksSize);
+    run->count = 0;
+    for (unsigned int i=0;i<pending->count;i++)
+      regexAddThread(&m, run, pending->pc[i], &pending->caps[i*m.capCount]);
+    if (!matched) { // try matching from here, with lower priority than anything that started earlier
+      for (unsigned int i=0;i<m.capCount;i++) caps[i] = REGEX_UNSET;
+      regexAddThread(&m, run, 0, caps);
+    }
+    // Now run the instructions that consume a character
+    next->count = 0;
+    for (unsigned int i=0;i<run->count;i++) {
+      unsigned int pc = run->pc[i];
+      size_t *tcaps = &run->caps[i*m.capCount];
+      bool ok = false;
+      switch ((RegexOp)m.code[pc]) {
+        case RE_MATCH:
+          matched = true;
+          memcpy(matchCaps, tcaps, capsSize);
+          i = run->count; // threads after this one have lower priority, so ignore them
+          break;
+        case RE_CHAR:
+          if (m.ch>=0)
+            ok = ((flags&REF_IGNORE_CASE) ? (unsigned char)charToLowerCase((char)m.ch) : m.ch) == m.code[pc+1];
+          pc += 2;
+          break;
+        case RE_ANY:
+          ok = m.ch>=0;
+          pc += 1;
+          break;
+        case RE_CLASS:
+          ok = m.ch>=0 && regexClassHas(&m.code[pc+1], m.ch);
+          pc += 1+REGEX_CLASS_SIZE;
+          break;
+        default: assert(0); break;
+      }
+      if (ok) {
+        next->pc[next->count] = (unsigned short)pc;
+        memcpy(&next->caps[next->count*m.capCount], tcaps, capsSize);
+        next->count++;
+      }
+    }
+    if (m.ch<0 || (matched && !next->count)) break; // end of String, or nothing can match better
+    m.prevCh = m.ch;
+    jsvStringIteratorNext(&it);
+    m.pos++;
+    RegexThreadList *t = pending;
+    pending = next;
+    next = t;
+  }
+  jsvStringIteratorFree(&it);
+  return matched ? regexMatchFound(str, matchCaps, groups) : 0;
 }
 
 /*JSON{
@@ -276,7 +724,13 @@ The built-in class for handling Regular Expressions
 
 **Note:** Espruino's regular expression parser does not contain all the features
 present in a full ES6 JS engine. However it does contain support for the all the
-basics.
+basics - character classes, `.`, `^`, `$`, `\b`, `*`, `+`, `?`, `{n,m}` (and
+lazy versions), `|`, and capturing/non-capturing groups. Backreferences and
+lookahead aren't supported.
+
+The expression is compiled when the RegExp is created, and matching uses a
+fixed amount of memory and time proportional to the length of the String, so
+expressions like `/(a*)*b/` can't hang the interpreter.
 */
 
 /*JSON{
@@ -312,6 +766,12 @@ JsVar *jswrap_regexp_constructor(JsVar *str, JsVar *flags) {
       jsvObjectSetChild(r, "flags", flags);
   }
   jsvObjectSetChildAndUnLock(r, "lastIndex", jsvNewFromInteger(0));
+  JsVar *code = regexCompileVar(str, jswrap_regexp_hasFlag(r,'i'));
+  if (!code) { // error compiling
+    jsvUnLock(r);
+    return 0;
+  }
+  jsvObjectSetChildAndUnLock(r, REGEX_CODE_NAME, code);
   return r;
 }
 
@@ -354,21 +814,35 @@ Or with groups `/W(o)rld/.exec("Hello World")` returns:
 JsVar *jswrap_regexp_exec(JsVar *parent, JsVar *arg) {
   JsVar *str = jsvAsString(arg);
   JsVarInt lastIndex = jsvObjectGetIntegerChild(parent, "lastIndex");
-  JsVar *regex = jsvObjectGetChildIfExists(parent, "source");
-  if (!jsvIsString(regex) || lastIndex>(JsVarInt)jsvGetStringLength(str)) {
-    jsvUnLock2(str,regex);
-    return 0;
+  JsVar *code = jsvObjectGetChildIfExists(parent, REGEX_CODE_NAME);
+  if (!code) { // not compiled yet (eg. the RegExp wasn't made with the constructor)
+    JsVar *regex = jsvObjectGetChildIfExists(parent, "source");
+    if (jsvIsString(regex)) {
+      code = regexCompileVar(regex, jswrap_regexp_hasFlag(parent,'i'));
+      if (code) jsvObjectSetChild(parent, REGEX_CODE_NAME, code);
+    }
+    jsvUnLock(regex);
   }
-  size_t regexLen = jsvGetStringLength(regex);
-  char *regexPtr = (char *)alloca(regexLen+1);
-  if (!regexPtr) {
-    jsvUnLock2(str,regex);
+  if (!jsvIsString(code) || !jsvIsString(str) || lastIndex>(JsVarInt)jsvGetStringLength(str)) {
+    jsvUnLock2(str,code);
     return 0;
   }
-  jsvGetString(regex, regexPtr, regexLen+1);
-  jsvUnLock(regex);
-  JsVar *rmatch = match(regexPtr, str, (size_t)lastIndex, jswrap_regexp_hasFlag(parent,'i'));
-  jsvUnLock(str);
+  size_t codeLen = jsvGetStringLength(code);
+  const unsigned char *program;
+  if (jsvIsFlatString(code)) {
+    program = (const unsigned char*)jsvGetFlatStringPointer(code);
+  } else {
+    if (codeLen+256 > jsuGetFreeStack()) {
+      jsExceptionHere(JSET_ERROR, "Not enough stack memory for RegEx");
+      jsvUnLock2(str,code);
+      return 0;
+    }
+    unsigned char *p = (unsigned char*)alloca(codeLen);
+    jsvGetStringChars(code, 0, (char*)p, codeLen);
+    program = p;
+  }
+  JsVar *rmatch = regexMatch(program, codeLen, str, (size_t)lastIndex);
+  jsvUnLock2(str, code);
   if (!rmatch) {
     rmatch = jsvNewWithFlags(JSV_NULL);
     lastIndex = 0;
@@ -68,6 +68,8 @@ JshPinState gpioState[JSH_PIN_COUNT]; // will be set to UNDEFINED if it isn't ex
 
 bool gpioShouldWatch[JSH_PIN_COUNT]; // whether we should watch this pin for changes
 bool gpioLastState[JSH_PIN_COUNT]; // the last state of this pin
+bool gpioValue[JSH_PIN_COUNT]; // the last value written, read back if we can't access the pin (eg. not on real hardware)
+bool gpioEmulated[JSH_PIN_COUNT]; // we can't access this pin, so watch events are pushed when it's written rather than polled
 
 
 // functions for accessing the sysfs GPIO
@@ -89,7 +91,8 @@ void sysfs_write_int(const char *path, JsVarInt val) {
   sysfs_write(path, buf);
 }
 
-void sysfs_read(const char *path, char *data, unsigned int len) {
+/// Read from the given path, return false if it couldn't be opened
+bool sysfs_read(const char *path, char *data, unsigned int len) {
   int amt = 0;
   int f = open(path, O_RDONLY);
   if (f>=0) {
@@ -98,12 +101,7 @@ void sysfs_read(const char *path, char *data, unsigned int len) {
   }
   if (amt<0) amt=0;
   data[amt]=0;
-}
-
-JsVarInt sysfs_read_int(const char *path) {
-  char buf[20];
-  sysfs_read(path, buf, sizeof(buf));
-  return stringToIntWithRadix(buf, 10, NULL, NULL);
+  return f>=0;
 }
 #endif
 
@@ -299,7 +297,7 @@ void jshInputThread() {
 #ifdef SYSFS_GPIO_DIR
     Pin pin;
     for (pin=0;pin<JSH_PIN_COUNT;pin++)
-      if (gpioShouldWatch[pin]) {
+      if (gpioShouldWatch[pin] && !gpioEmulated[pin]) {
         shortSleep = true;
         bool state = jshPinGetValue(pin);
         if (state != gpioLastState[pin]) {
@@ -494,6 +492,12 @@ void jshPinSetValue(Pin pin, bool value) {
   itostr(pin, &path[strlen(path)], 10);
   strcat(&path[strlen(path)], "/value");
   sysfs_write_int(path, value?1:0);
+  gpioValue[pin] = value;
+  if (gpioEmulated[pin] && gpioShouldWatch[pin] && gpioLastState[pin]!=value) {
+    // no GPIO, so push the edge now - then each write is seen, however quickly they happen
+    gpioLastState[pin] = value;
+    jshPushIOEvent(pinToEVEXTI(pin) | (value?EV_EXTI_IS_HIGH:0), jshGetSystemTime());
+  }
 #endif
 #ifdef USE_WIRINGPI
   digitalWrite(pin,value);
@@ -505,7 +509,12 @@ bool jshPinGetValue(Pin pin) {
   char path[64] = SYSFS_GPIO_DIR"/gpio";
   itostr(pin, &path[strlen(path)], 10);
   strcat(&path[strlen(path)], "/value");
-  return sysfs_read_int(path);
+  char buf[20];
+  if (!sysfs_read(path, buf, sizeof(buf))) {
+    gpioEmulated[pin] = true;
+    return gpioValue[pin]; // no GPIO - just read back what was written, so setWatch/etc can be tested
+  }
+  return stringToIntWithRadix(buf, 10, NULL, NULL)!=0;
 #elif defined(USE_WIRINGPI)
   return digitalRead(pin);
 #else
@@ -596,8 +605,8 @@ IOEventFlags jshPinWatch(Pin pin, bool shouldWatch, JshPinWatchFlags flags) {
         gpioEventFlags[pin] = exti;
         jshPinSetState(pin, JSHPINSTATE_GPIO_IN);
 #ifdef SYSFS_GPIO_DIR
-        gpioShouldWatch[pin] = true;
         gpioLastState[pin] = jshPinGetValue(pin);
+        gpioShouldWatch[pin] = true;
 #endif
 #ifdef USE_WIRINGPI
         wiringPiISR(pin, INT_EDGE_BOTH, irqEXTIs[exti-EV_EXTI0]);
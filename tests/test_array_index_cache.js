@@ -0,0 +1,38 @@
+// Check that array lookups stay correct when elements are accessed in various orders and the array changes
+var a = [];
+for (var i=0;i<100;i++) a.push(i*2);
+var ok = true;
+// forwards, backwards and random access
+for (i=0;i<100;i++) ok &= a[i]==i*2;
+for (i=99;i>=0;i--) ok &= a[i]==i*2;
+for (i=0;i<100;i++) { var j = (i*37)%100; ok &= a[j]==j*2; }
+// interleave with another array
+var b = [5,6,7];
+for (i=0;i<3;i++) ok &= a[i]==i*2 && b[i]==5+i;
+// modify while accessing
+a.shift();
+ok &= a[0]==2 && a[1]==4 && a[98]==198 && a[99]===undefined;
+a.splice(10,5);
+ok &= a[9]==20 && a[10]==32 && a.length==94;
+a.unshift("x","y");
+ok &= a[0]=="x" && a[1]=="y" && a[2]==2 && a[11]==20;
+a.reverse();
+ok &= a[0]==198 && a[a.length-1]=="x";
+a.pop();
+ok &= a[a.length-1]=="y" && a[a.length]===undefined;
+// sparse arrays and string keys
+var s = [];
+s[3] = "a"; s[100] = "b"; s.foo = "c"; s[-1] = "d";
+ok &= s[3]=="a" && s[4]===undefined && s[50]===undefined && s[100]=="b" && s[-1]=="d" && s.foo=="c" && s[101]===undefined;
+s[50] = "e";
+ok &= s[50]=="e" && s[49]===undefined && s[51]===undefined;
+delete s[50];
+ok &= s[50]===undefined && s[100]=="b";
+var t = []; t.bar = 1;
+ok &= t[-1]===undefined && t[0]===undefined;
+// arrays freed and reused
+for (i=0;i<10;i++) {
+  var c = [i,i+1,i+2];
+  ok &= c[1]==i+1 && c[2]==i+2;
+}
+result = ok;
@@ -0,0 +1,49 @@
+// Names longer than fit in a single var share their text via an 'atom'
+
+var json = '[';
+for (var i=0;i<20;i++) json += (i?',':'')+'{"temperature":'+i+',"humidityPercent":'+(i*2)+'}';
+json += ']';
+var atomsBefore = process.memory().atoms;
+var records = JSON.parse(json);
+var r = records.length==20;
+for (var i=0;i<20;i++)
+  r = r && records[i].temperature==i && records[i].humidityPercent==i*2;
+// 20 records, but only two new atoms
+r = r && (process.memory().atoms-atomsBefore)==2;
+r = r && Object.keys(records[5]).join(",")=="temperature,humidityPercent";
+r = r && ("temperature" in records[3]) && !("temperatures" in records[3]) && !("temperatur" in records[3]);
+
+// modifying the key of one object doesn't affect the others
+var k = Object.keys(records[0])[0];
+k += "X";
+r = r && k=="temperatureX" && Object.keys(records[1])[0]=="temperature";
+
+// delete and re-add
+delete records[2].temperature;
+r = r && records[2].temperature===undefined && records[3].temperature==3;
+records[2].temperature = 42;
+r = r && records[2].temperature==42 && Object.keys(records[2]).join(",")=="humidityPercent,temperature";
+
+// copying
+var copy = Object.assign({}, records[7]);
+r = r && copy.temperature==7 && copy.humidityPercent==14;
+copy.temperature = 1;
+r = r && records[7].temperature==7;
+
+// long parameter and global names
+function longParams(firstParameter, secondParameter) { return firstParameter+secondParameter; }
+var aVeryLongGlobalName = 5;
+r = r && longParams(1,2)==3 && aVeryLongGlobalName==5 && this["aVeryLongGlobalName"]==5;
+var err;
+try { notDefinedAnywhere; } catch (e) { err = e; }
+r = r && err instanceof ReferenceError && err.message.indexOf("notDefinedAnywhere")>=0;
+
+// when everything using them has gone, atoms are freed
+var atomsUsed = process.memory().atoms;
+records = undefined;
+copy = undefined;
+k = undefined;
+process.memory(); // forces a GC
+r = r && process.memory().atoms==atomsUsed-2;
+
+result = r;
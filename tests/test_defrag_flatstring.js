@@ -0,0 +1,21 @@
+// E.defrag() should be able to move Flat Strings (ArrayBuffers) down into
+// free space, so they don't split up the heap
+
+var a = [];
+for (var i=0;i<300;i++) a.push("Hello World "+i);
+var buf = new Uint8Array(200);
+for (var i=0;i<buf.length;i++) buf[i] = i;
+var keep = [];
+for (var i=0;i<20;i++) keep.push("Keep me "+i);
+a = undefined; // leaves a hole below the ArrayBuffer
+
+var addrBefore = E.getAddressOf(buf,true);
+var freeBefore = process.memory().largestFree;
+E.defrag();
+var addrAfter = E.getAddressOf(buf,true);
+var freeAfter = process.memory().largestFree;
+
+var ok = buf.length==200 && keep[19]=="Keep me 19";
+for (var i=0;i<buf.length;i++) if (buf[i]!=i) ok = false;
+
+result = ok && addrBefore-addrAfter>0 && freeAfter>freeBefore;
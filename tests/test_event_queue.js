@@ -0,0 +1,32 @@
+// Events queued with emit run in order, with their arguments kept alive, even when there are too many for the event queue
+
+var o = {};
+var got = [];
+o.on('x', function(a, b) {
+  got.push(a.n + (b ? b.s : ""));
+});
+o.on('y', function(a,b,c,d) { got.push("y"+a+b+c+d); });
+
+var m = process.memory();
+for (var i=0;i<40;i++) {
+  o.emit('x', {n:i}, (i&1) ? {s:"!"} : undefined);
+  if (i==5) o.emit('y', 1, 2, 3, 4); // too many args for the queue
+  if (i==10) process.memory(); // GC while events are queued
+  if (i==20) E.defrag();
+}
+var m2 = process.memory();
+
+var expected = [];
+for (i=0;i<40;i++) {
+  expected.push(i + ((i&1) ? "!" : ""));
+  if (i==5) expected.push("y1234");
+}
+
+setTimeout(function() {
+  var m3 = process.memory();
+  result = got.join()==expected.join() &&
+    m2.eventsExecuted == m.eventsExecuted && // nothing run until we're idle
+    (m3.eventsExecuted - m.eventsExecuted) == 41 &&
+    (m2.eventsQueued - m.eventsQueued) == 41 &&
+    m2.eventsOverflowed > m.eventsOverflowed;
+}, 10);
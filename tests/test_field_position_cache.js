@@ -0,0 +1,31 @@
+// Field lookups remember the position a field was found at in similar objects
+// - make sure objects with different layouts still find the right fields
+
+function Rec(i) { this.time = i; this.temp = i*2; this.humidity = i*3; }
+var recs = [];
+for (var i=0;i<10;i++) recs.push(new Rec(i));
+recs.push({humidity:100, time:10, temp:20}); // different order
+recs.push({temp:22, extra:1, time:11, humidity:33}); // extra field
+recs.push({time:12}); // missing fields
+
+var r = true;
+for (var i=0;i<10;i++)
+  r = r && recs[i].time==i && recs[i].temp==i*2 && recs[i].humidity==i*3;
+r = r && recs[10].time==10 && recs[10].temp==20 && recs[10].humidity==100;
+r = r && recs[11].time==11 && recs[11].temp==22 && recs[11].humidity==33;
+r = r && recs[12].time==12 && recs[12].temp===undefined && recs[12].humidity===undefined;
+
+// found at the same position, but a different name that starts the same
+var a = {x:1, tempX:2}, b = {x:1, temp:3};
+r = r && a.tempX==2 && b.tempX===undefined && b.temp==3 && a.temp===undefined;
+
+// fields that get removed and re-added move to the end
+delete recs[0].time;
+recs[0].time = 42;
+r = r && recs[0].time==42 && recs[1].time==1 && Object.keys(recs[0]).join()=="temp,humidity,time";
+
+// assigning through a remembered position
+for (var i=0;i<10;i++) recs[i].temp = -i;
+for (var i=0;i<10;i++) r = r && recs[i].temp==-i;
+
+result = r;
@@ -0,0 +1,22 @@
+// Flat strings (ArrayBuffers) need contiguous free blocks. Once single vars
+// have been freed the free list is no longer in address order, but we should
+// still be able to find space without having to garbage collect first
+
+process.memory(); // GC, so the free list starts off in order
+var a = [];
+for (var i=0;i<200;i++) a.push("Hello World "+i);
+a = undefined; // frees all the strings onto the front of the free list
+
+// some circular garbage that only a GC will free
+var g = {};
+g.g = g;
+g = undefined;
+
+var before = process.memory(false);
+var buf = new Uint8Array(1000);
+var after = process.memory(false);
+var gc = process.memory().gc; // there should still be garbage to collect
+
+result = buf.length==1000 && gc>0 &&
+  before.largestFree>=after.largestFree && after.largestFree>0 &&
+  after.free+1000/after.blocksize <= before.free;
@@ -0,0 +1,29 @@
+// Garbage collection of long linked lists - marking used to give up when
+// it ran out of stack, leaving unreferenced lists uncollected
+
+var before = process.memory().usage;
+
+function makeList(n) {
+  var first = {n:0}, last = first;
+  for (var i=1;i<n;i++) last = last.next = {n:i};
+  last.next = first; // cycle, so it can only be freed by GC
+  return first;
+}
+
+var list = makeList(5000);
+var used = process.memory().usage;
+// list is still referenced, so must be kept
+var l = list, count = 0;
+do { count++; l = l.next; } while (l!==list);
+l = undefined;
+list = undefined;
+var after = process.memory().usage;
+
+// lots of objects in one array (more than will fit on the mark stack)
+var arr = [];
+for (var i=0;i<500;i++) arr.push({a:{b:i}});
+arr[0].loop = arr;
+arr = undefined;
+var after2 = process.memory().usage;
+
+result = count==5000 && used-before > 5000 && after-before < 100 && after2-before < 100;
@@ -0,0 +1,81 @@
+// Check fills, scrolls and blits on flat ArrayBuffers (which work on whole words where they can) against setPixel/getPixel
+var ok = true;
+var seed = 1;
+function rnd(n) { seed = (seed*1103515245 + 12345) & 0x7FFFFFFF; return seed % n; }
+
+function fail(name) {
+  console.log(name, "failed");
+  ok = false;
+}
+function snapshot(g) {
+  var p = [];
+  for (var y=0;y<g.getHeight();y++)
+    for (var x=0;x<g.getWidth();x++)
+      p.push(g.getPixel(x,y));
+  return p;
+}
+function pattern(g) {
+  for (var y=0;y<g.getHeight();y++)
+    for (var x=0;x<g.getWidth();x++)
+      g.setPixel(x,y,(x*7+y*13+(x>>2))*2654435761);
+}
+
+function check(name, bpp, opts) {
+  var W = 45, H = 16;
+  var a = Graphics.createArrayBuffer(W,H,bpp,opts);
+  var b = Graphics.createArrayBuffer(W,H,bpp,opts);
+  if (!E.getAddressOf(a.buffer,true)) fail(name+" not flat");
+  // fillRect
+  for (var i=0;i<40;i++) {
+    var x1 = rnd(W+4)-2, y1 = rnd(H+2)-1, x2 = x1+rnd(W), y2 = y1+rnd(4);
+    var col = (i==3) ? 0 : ((i==4) ? -1 : rnd(0x7FFFFFFF));
+    a.setColor(col).fillRect(x1,y1,x2,y2);
+    col = a.getColor();
+    for (var y=y1;y<=y2;y++)
+      for (var x=x1;x<=x2;x++)
+        b.setPixel(x,y,col);
+  }
+  a.setColor(0x12345678).fillRect(0,2,W-1,9); // whole rows
+  for (var y=2;y<=9;y++) for (var x=0;x<W;x++) b.setPixel(x,y,a.getColor());
+  if (E.CRC32(a.buffer)!=E.CRC32(b.buffer)) fail(name+" fillRect");
+  a.setBgColor(5).clear();
+  if (JSON.stringify(snapshot(a))!=JSON.stringify(new Array(W*H).fill(a.getBgColor()))) fail(name+" clear");
+  // scroll
+  pattern(a);
+  [[3,0],[-5,0],[0,2],[0,-3],[9,1],[-1,-1],[8,0],[-16,2],[0,-9]].forEach(function(d) {
+    var before = snapshot(a);
+    a.scroll(d[0],d[1]);
+    var after = snapshot(a);
+    for (var y=0;y<H;y++)
+      for (var x=0;x<W;x++) {
+        var sx = x-d[0], sy = y-d[1];
+        var expect = (sx>=0 && sy>=0 && sx<W && sy<H) ? before[sx+sy*W] : a.getBgColor();
+        if (after[x+y*W]!==expect) { fail(name+" scroll "+d); x=W; y=H; }
+      }
+  });
+  // blit
+  pattern(a);
+  [[0,0,10,3,5,4],[3,1,20,5,1,0],[1,0,30,16,4,0],[9,2,8,4,0,2],[2,3,40,10,0,5]].forEach(function(r) {
+    var before = snapshot(a);
+    a.blit({x1:r[0],y1:r[1],w:r[2],h:r[3],x2:r[4],y2:r[5]});
+    var after = snapshot(a);
+    for (var y=0;y<H;y++)
+      for (var x=0;x<W;x++) {
+        var expect = before[x+y*W];
+        if (x>=r[4] && y>=r[5] && x<r[4]+r[2] && y<r[5]+r[3])
+          expect = before[(x-r[4]+r[0]) + (y-r[5]+r[1])*W];
+        if (after[x+y*W]!==expect) { fail(name+" blit "+r); x=W; y=H; }
+      }
+  });
+}
+
+[1,2,4,8,16,24,32].forEach(function(bpp) {
+  check(bpp+"bpp", bpp, {});
+  check(bpp+"bpp msb", bpp, {msb:true});
+});
+[1,2,4].forEach(function(bpp) {
+  check(bpp+"bpp interleavex", bpp, {interleavex:true});
+  check(bpp+"bpp interleavex msb", bpp, {interleavex:true,msb:true});
+});
+
+result = ok;
@@ -0,0 +1,42 @@
+// drawImage sends rows of pixels to the backend - check it matches setPixel for different formats
+var ok = true;
+
+function check(name, bpp, opts, ibpp, x, y, transparent, clip) {
+  var src = Graphics.createArrayBuffer(45,7,ibpp,{msb:true});
+  for (var i=0;i<src.getHeight();i++) src.setColor(i*37+5).drawLine(0,i,44-i*3,i+20);
+  src.setColor(0).drawLine(3,0,9,6);
+  var img = src.asImage();
+  if (transparent!==undefined) img.transparent = transparent;
+  var a = Graphics.createArrayBuffer(40,16,bpp,opts);
+  var b = Graphics.createArrayBuffer(40,16,bpp,opts);
+  if (clip) { a.setClipRect(3,2,30,9); b.setClipRect(3,2,30,9); }
+  a.drawImage(img, x, y);
+  for (var iy=0;iy<img.height;iy++)
+    for (var ix=0;ix<img.width;ix++) {
+      var c = src.getPixel(ix,iy);
+      if (c===transparent) continue;
+      if (ibpp==1 && bpp>1) c = c ? a.getColor() : a.getBgColor(); // 1bpp images use foreground/background
+      b.setPixel(x+ix, y+iy, c);
+    }
+  if (E.CRC32(a.buffer)!=E.CRC32(b.buffer)) {
+    console.log(name, "failed");
+    ok = false;
+  }
+}
+
+[1,2,4,8,16,24,32].forEach(function(bpp) {
+  [{},{msb:true}].forEach(function(opts) {
+    (bpp>16 ? [bpp] : [1,bpp]).forEach(function(ibpp) { // 1bpp images use a 16 bit palette
+      var n = bpp+"bpp"+(opts.msb?" msb":"")+" from "+ibpp+"bpp";
+      check(n, bpp, opts, ibpp, 0, 0);
+      check(n+" offset", bpp, opts, ibpp, -3, 2);
+      check(n+" transparent", bpp, opts, ibpp, 5, -1, 0);
+      check(n+" clipped", bpp, opts, ibpp, 1, 1, undefined, true);
+    });
+  });
+});
+check("vertical_byte", 1, {vertical_byte:true}, 1, 2, 1, 0);
+check("zigzag", 8, {zigzag:true}, 8, -1, 1);
+check("interleavex", 2, {interleavex:true}, 1, 1, 0, 0);
+
+result = ok;
@@ -0,0 +1,47 @@
+// fillPoly with more than 64 points and crossings per scanline, and fillPolyAA coverage
+var ok = true;
+function check(name, got, expected) {
+  got = JSON.stringify(got);
+  expected = JSON.stringify(expected);
+  if (got!=expected) {
+    console.log(name, "got", got, "expected", expected);
+    ok = false;
+  }
+}
+
+// A comb with 40 teeth - 162 points, 80 crossings on each of the top rows
+var W = 160, TEETH = 40;
+var poly = [0,20];
+for (var i=0;i<TEETH;i++)
+  poly.push(i*4,0, i*4+2,0, i*4+2,10, i*4+4,10);
+poly.push(W,20);
+var g = Graphics.createArrayBuffer(W,24,1);
+g.fillPoly(poly);
+var expected = Graphics.createArrayBuffer(W,24,1);
+expected.fillRect(0,10,W-1,19);
+for (i=0;i<TEETH;i++) expected.fillRect(i*4,0,i*4+1,9);
+check("comb", E.CRC32(g.buffer), E.CRC32(expected.buffer));
+
+if (g.fillPolyAA) {
+  g = Graphics.createArrayBuffer(16,16,8);
+  expected = Graphics.createArrayBuffer(16,16,8);
+  // whole pixels are filled just like fillPoly
+  g.setColor(255).fillPolyAA([2,3, 12,3, 12,9, 2,9]);
+  expected.setColor(255).fillPoly([2,3, 12,3, 12,9, 2,9]);
+  check("rect", E.CRC32(g.buffer), E.CRC32(expected.buffer));
+  // half covered pixels are half blended
+  g.clear().fillPolyAA([2.5,3, 12,3, 12,9.5, 2.5,9.5]);
+  check("half", [g.getPixel(2,5), g.getPixel(3,5), g.getPixel(11,5), g.getPixel(12,5), g.getPixel(5,9), g.getPixel(2,9)], [127,255,255,0,127,64]);
+  // total coverage of a triangle matches its area
+  g = Graphics.createArrayBuffer(40,40,8);
+  g.setColor(255).fillPolyAA([1.3,2.1, 37.7,9.4, 12.2,36.8]);
+  var sum = 0;
+  for (var y=0;y<40;y++) for (var x=0;x<40;x++) sum += g.getPixel(x,y);
+  var area = Math.abs((37.7-1.3)*(36.8-2.1) - (12.2-1.3)*(9.4-2.1))/2;
+  if (Math.abs(sum/255 - area) > area*0.02) {
+    console.log("triangle coverage", sum/255, "expected", area);
+    ok = false;
+  }
+}
+
+result = ok;
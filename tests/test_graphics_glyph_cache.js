@@ -0,0 +1,95 @@
+// Check characters drawn from the glyph cache match those drawn without it
+var ok = true;
+function check(name, got, expected) {
+  got = JSON.stringify(got);
+  expected = JSON.stringify(expected);
+  if (got!=expected) {
+    console.log(name, "got", got, "expected", expected);
+    ok = false;
+  }
+}
+
+// Vector font, with the cache empty and then full. CRCs are from before the cache existed
+function drawVector(rot, fontRotate) {
+  var g = Graphics.createArrayBuffer(80,60,1);
+  g.setRotation(rot).setFont("Vector:20x24").setFontAlign(-1,-1,fontRotate);
+  g.drawString("12:34",4,3);
+  g.drawString("56",-6,30,true); // partly offscreen
+  return E.CRC32(g.buffer);
+}
+var cases = [[0,0],[1,0],[2,1],[3,3]];
+var crcs = [1882774800,2486210766,756865416,3624006643];
+Graphics.getGlyphCacheInfo(true);
+cases.forEach(function(c,i) { check("vector "+c, drawVector(c[0],c[1]), crcs[i]); });
+var info = Graphics.getGlyphCacheInfo();
+check("vector entries", info.entries, info.misses); // nothing removed yet
+cases.forEach(function(c,i) { check("vector cached "+c, drawVector(c[0],c[1]), crcs[i]); });
+var info2 = Graphics.getGlyphCacheInfo(true);
+check("vector cached misses", info2.misses, info.misses);
+check("vector cached hits", info2.hits, info.hits*2 + info.misses);
+check("reset", Graphics.getGlyphCacheInfo(), {hits:0,misses:0,entries:0,used:0,size:info.size});
+
+// PBF font with 1bpp and 2bpp glyphs
+function glyph(w,h,x,y,advance,bpp,pixel) {
+  var d = new Uint8Array(5+((w*h*bpp+7)>>3));
+  d.set([w,h,x&255,y&255,bpp==2?advance|128:advance]);
+  for (var i=0;i<w*h;i++)
+    d[5+((i*bpp)>>3)] |= pixel(i%w,(i/w)|0) << ((i*bpp)&7);
+  return d;
+}
+var glyphs = [
+  [65, glyph(5,7,0,1,6,1,function(x,y){return ((x*3+y*5)%7<3)?1:0;})],
+  [66, glyph(6,6,1,2,8,2,function(x,y){return (x+y*2)%4;})],
+  [67, glyph(3,4,-1,0,3,1,function(x,y){return 1;})]
+];
+// version 2, one hash table entry, 16 bit codepoints
+var font = [2,10,glyphs.length,0,0,0,1,2, 0,glyphs.length,0,0];
+var offset = 0;
+glyphs.forEach(function(g) {
+  font.push(g[0]&255,g[0]>>8,offset&255,offset>>8,0,0);
+  offset += g[1].length;
+});
+glyphs.forEach(function(g) { font = font.concat([].slice.call(g[1])); });
+var flatFont = E.toString(new Uint8Array(font)); // flat, so can be cached
+var fragmentedFont = "";
+font.forEach(function(c) { fragmentedFont += String.fromCharCode(c); }); // never cached
+check("flat", E.getAddressOf(flatFont,true)!=0, true);
+
+function drawPBF(f, bpp, scale, solid) {
+  var g = Graphics.createArrayBuffer(60,40,bpp);
+  g.setFontPBF(f,scale).setColor(-1).setBgColor(1);
+  g.drawString("ABCA",1,2,solid);
+  g.drawString("BBA",-3,20,solid);
+  return E.CRC32(g.buffer);
+}
+[1,2,4].forEach(function(bpp) {
+  [1,2].forEach(function(scale) {
+    [false,true].forEach(function(solid) {
+      check("pbf "+[bpp,scale,solid], drawPBF(flatFont,bpp,scale,solid), drawPBF(fragmentedFont,bpp,scale,solid));
+    });
+  });
+});
+info = Graphics.getGlyphCacheInfo(true);
+check("pbf entries", info.entries, 3);
+check("pbf misses", info.misses, 3);
+check("pbf hits", info.hits, 12*7-3);
+
+// A different font of the same length mustn't get the first font's glyphs
+var inverseFont = E.toString(font.map(function(c,i) { return i>=12+6*glyphs.length+5 && i<12+6*glyphs.length+glyphs[0][1].length ? c^255 : c; })); // invert the pixels of 'A'
+var inverseFragmented = "";
+inverseFont.split("").forEach(function(c) { inverseFragmented += c; });
+check("inverse length", inverseFont.length, flatFont.length);
+check("inverse", drawPBF(inverseFont,1,1,false), drawPBF(inverseFragmented,1,1,false));
+check("inverse differs", drawPBF(inverseFont,1,1,false)!=drawPBF(flatFont,1,1,false), true);
+
+// ... even when it's at the same address as a font that has been freed
+var bytes = new Uint8Array(font);
+var reusedFont = E.toString(bytes);
+var addr = E.getAddressOf(reusedFont,true);
+reusedFont = undefined;
+for (var i=12+6*glyphs.length+5;i<12+6*glyphs.length+glyphs[0][1].length;i++) bytes[i]^=255;
+reusedFont = E.toString(bytes);
+check("reused address", E.getAddressOf(reusedFont,true), addr);
+check("reused", drawPBF(reusedFont,1,1,false), drawPBF(inverseFont,1,1,false));
+
+result = ok;
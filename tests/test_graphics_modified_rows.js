@@ -0,0 +1,51 @@
+// Check Graphics.getModified reports separate runs of modified rows
+var ok = true;
+function check(name, got, expected) {
+  got = JSON.stringify(got);
+  expected = JSON.stringify(expected);
+  if (got!=expected) {
+    console.log(name, "got", got, "expected", expected);
+    ok = false;
+  }
+}
+
+var g = Graphics.createArrayBuffer(64,100,1);
+check("none", g.getModified(), undefined);
+g.setPixel(3,2);
+check("pixel", g.getModified(), {x1:3,y1:2,x2:3,y2:2});
+g.fillRect(10,5,20,12); // bands 0 and 1 - still one run
+check("one run", g.getModified(), {x1:3,y1:2,x2:20,y2:12});
+g.drawLine(0,50,40,52); // band 6
+check("two runs", g.getModified(true), {x1:0,y1:2,x2:40,y2:52,rows:[[2,15],[48,52]]});
+check("reset", g.getModified(), undefined);
+
+// clock in one corner, status icon in the other
+g.setFont("6x8").drawString("12:34",0,0);
+g.fillRect(56,92,63,99);
+check("corners", g.getModified(true), {x1:0,y1:1,x2:63,y2:99,rows:[[1,7],[88,99]]});
+
+// clipping applies before marking rows as modified
+g.setClipRect(0,40,63,59);
+g.fillRect(0,0,63,99);
+check("clipped", g.getModified(true), {x1:0,y1:40,x2:63,y2:59});
+g.reset();
+
+// three runs, and a scroll marks the whole area
+g.setPixel(0,0).setPixel(1,30).setPixel(2,99);
+check("three runs", g.getModified(true), {x1:0,y1:0,x2:2,y2:99,rows:[[0,7],[24,31],[96,99]]});
+g.scroll(0,1);
+check("scroll", g.getModified(true), {x1:0,y1:0,x2:63,y2:99});
+
+// drawing entirely above or below the screen doesn't mark any rows
+var img = Graphics.createArrayBuffer(8,8,1).fillRect(0,0,7,7).asImage();
+g.setPixel(0,0).setPixel(0,60);
+g.drawImage(img,10,-40);
+g.drawImage(img,10,140);
+check("offscreen", g.getModified(true).rows, [[0,7],[56,63]]);
+
+// rows past the last band are all covered by it
+var t = Graphics.createArrayBuffer(8,300,1);
+t.setPixel(0,0).setPixel(0,290);
+check("tall", t.getModified(true), {x1:0,y1:0,x2:0,y2:290,rows:[[0,7],[248,290]]});
+
+result = ok;
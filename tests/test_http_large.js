@@ -0,0 +1,27 @@
+// HTTP server and client test with a large response body (received in big chunks)
+
+var result = 0;
+var http = require("http");
+
+var payload = "";
+for (var i=0;i<200;i++) payload += "["+i+"]0123456789abcdef";
+
+var server = http.createServer(function (req, res) {
+  res.writeHead(200, {'Content-Type': 'text/plain', 'Content-Length': payload.length});
+  res.end(payload);
+});
+server.listen(8080);
+
+http.get("http://localhost:8080/large.html", function(res) {
+  var body = '';
+  var chunks = 0;
+  res.on('data', function(data) {
+    chunks++;
+    body += data;
+  });
+  res.on('close', function() {
+    console.log("Got "+body.length+" bytes in "+chunks+" chunks");
+    result = body==payload;
+    server.close();
+  });
+});
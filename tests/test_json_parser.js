@@ -0,0 +1,63 @@
+// JSONParser - parsing JSON that arrives in chunks
+
+var r = true;
+var got = [];
+var p = new JSONParser();
+p.on('value', function(v,k) { got.push([v,k]); });
+p.write('{"a":1');
+p.write(',"b":[2,3');
+p.write(']}[1,2,3]  "str');
+p.write('ing" 12');
+p.write('3 true\n');
+p.end();
+r = r && JSON.stringify(got)=='[[{"a":1,"b":[2,3]},null],[[1,2,3],null],["string",null],[123,null],[true,null]]';
+
+// values at depth 1 are passed to the event and not stored
+var items = [];
+var q = new JSONParser({depth:1});
+q.on('value', function(v,k) { items.push(k+"="+JSON.stringify(v)); });
+var s = '{"x":1,"list":[1,2],"longername":{"a":"b"}}';
+for (var i=0;i<s.length;i+=3) q.write(s.substr(i,3));
+q.end('[10,20,{"c":30}]');
+r = r && items.join(" ")=='x=1 list=[1,2] longername={"a":"b"} 0=10 1=20 2={"c":30}';
+
+// an error resets the parser
+var err = 0;
+try { p.write('[1,}'); } catch (e) { err++; }
+p.write('[5]');
+r = r && JSON.stringify(got[got.length-1][0])=='[5]';
+try { p.end('[1,'); } catch (e) { err++; }
+r = r && err==2;
+
+// deep nesting, split at every character
+var deep = '{"a":[[[[{"b":[[[[{"c":[1,[2,{"d":"x\\u00e9"}]]}]]]]}]]]],"z":{"y":[-1.5e3,0x10]}}';
+var last;
+var d = new JSONParser();
+d.on('value', function(v) { last = v; });
+for (var i=0;i<deep.length;i++) d.write(deep[i]);
+r = r && JSON.stringify(last)==JSON.stringify(JSON.parse(deep));
+r = r && last.a[0][0][0][0].b[0][0][0][0].c[1][1].d=="xé" && last.z.y[0]==-1500 && last.z.y[1]==16;
+
+// invalid input is still rejected by JSON.parse
+err = 0;
+["-", ".5", "[1,", "{\"a\"}", "tru"].forEach(function(s) {
+  try { JSON.parse(s); } catch (e) { err++; }
+});
+r = r && err==5;
+
+// strings and keys longer than the tokenizer's buffer, whole and split across writes
+var long = "";
+for (var i=0;i<150;i++) long += String.fromCharCode(97+(i%26));
+var longKey = {};
+longKey[long] = long;
+var longJSON = JSON.stringify([long, longKey, {"k":long}]);
+r = r && JSON.stringify(JSON.parse(longJSON))==longJSON;
+r = r && JSON.parse(JSON.stringify(long.substr(0,65)))==long.substr(0,65);
+var longGot;
+var l = new JSONParser();
+l.on('value', function(v) { longGot = v; });
+for (var i=0;i<longJSON.length;i+=7) l.write(longJSON.substr(i,7));
+r = r && JSON.stringify(longGot)==longJSON;
+
+p = q = d = l = undefined;
+result = r;
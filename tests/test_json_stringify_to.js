@@ -0,0 +1,35 @@
+// JSON.stringifyTo - writing JSON to a stream a chunk at a time
+
+var recs = [];
+for (var i=0;i<50;i++) recs.push({time:i, temp:i*1.5, name:"sensor "+i, flags:[1,2,3], ok:true, none:null});
+
+var chunks = [];
+var stream = { write : function(d) { chunks.push(d); } };
+JSON.stringifyTo(stream, recs);
+var r = chunks.join("")==JSON.stringify(recs);
+r = r && chunks.length>1 && chunks.every(function(c,i) { return c.length==256 || i==chunks.length-1; });
+
+chunks = [];
+JSON.stringifyTo(stream, recs, {space:2, chunkSize:100});
+r = r && chunks.join("")==JSON.stringify(recs, null, 2) && chunks[0].length==100;
+
+chunks = [];
+JSON.stringifyTo(stream, "hello");
+r = r && chunks.length==1 && chunks[0]=='"hello"';
+
+// keys and numbers are output without copying them
+var o = {"a long key name here":-1e-7, "é\n":[1.5,-2,3e20], 1:NaN};
+r = r && JSON.stringify(o)=='{"a long key name here":-1e-7,"\\u00E9\\n":[1.5,-2,300000000000000000000],"1":null}';
+
+// errors from write stop the output
+var calls = 0, err;
+try {
+  JSON.stringifyTo({ write : function(d) { calls++; throw new Error("Oops"); } }, recs, {chunkSize:10});
+} catch (e) { err = e; }
+r = r && calls==1 && err.message=="Oops";
+
+err = undefined;
+try { JSON.stringifyTo({}, recs); } catch (e) { err = e; }
+r = r && err!==undefined;
+
+result = r;
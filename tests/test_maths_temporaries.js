@@ -0,0 +1,23 @@
+// Check that results of maths ops reusing temporary vars don't corrupt variables
+
+var a = 3, b = 4, c = 5, d = 6;
+var r1 = a*b+c*d;
+var r2 = -a*b - -c;
+var x = 2147483647;
+var r3 = x+1+1; // int overflow to double
+var r4 = (a/b)*2+1;
+var r5 = 7%-3 + (-7%3)*10 + (5%0==5%0);
+var r6 = (1<<4) + (-16>>2) + (-1>>>28) + (5&3) + (5|3) + (5^3);
+var r7 = 1.5*2 == 3;
+var k = 10;
+k += 2*3;
+var j = 1;
+var jj = j++ + ++j; // 1 + 3
+var arr = [1,2,3];
+var s = 0;
+for (var i=0;i<arr.length;i++) s += arr[i]*arr[i]+1;
+
+result = r1==42 && a==3 && b==4 && c==5 && d==6 &&
+  r2==-7 && r3==2147483649 && r4==2.5 && r5==-9 &&
+  r6==(16-4+15+1+7+6) && r7===true && k==16 && j==3 && jj==4 &&
+  s==17 && arr.join()=="1,2,3" && -x==-2147483647;
@@ -0,0 +1,30 @@
+// Vars that survive in the nursery (the start of memory, where new vars go
+// first) get moved out when idle if the 'nursery' flag is set. Make sure
+// everything still works after.
+
+var objs = [];
+for (var i=0;i<300;i++) objs.push({n:i, s:"Str"+i});
+var big = {};
+for (var i=0;i<50;i++) big["key"+i] = i; // big enough to get a hash index
+var addrBefore = E.getAddressOf(objs[0],false);
+var nurseryEnd = process.memory().total/8;
+
+setTimeout(function() {
+  // nothing moves unless we ask for it
+  var notMoved = E.getAddressOf(objs[0],false)==addrBefore;
+  E.setFlags({nursery:true});
+  setTimeout(function() {
+    var addrAfter = E.getAddressOf(objs[0],false);
+    var ok = objs.length==300;
+    for (var i=0;i<300;i++)
+      if (objs[i].n!=i || objs[i].s!="Str"+i) ok = false;
+    for (var i=0;i<50;i++)
+      if (big["key"+i]!=i) ok = false;
+    big.key50 = 50;
+    ok = ok && big.key50==50 && Object.keys(big).length==51;
+    E.setFlags({nursery:false});
+    setTimeout(function() { // timers still work after being moved
+      result = ok && notMoved && addrAfter!=addrBefore && E.getFlags().nursery==0;
+    }, 10);
+  }, 200);
+}, 200);
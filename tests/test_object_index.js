@@ -0,0 +1,32 @@
+// Check that property lookups stay correct on objects big enough to get a hash index
+var o = {};
+for (var i=0;i<100;i++) o["key"+i] = i;
+var ok = true;
+for (i=0;i<100;i++) ok &= o["key"+i]==i;
+ok &= o.key99==99 && o.key0==0 && o.nothere===undefined;
+ok &= process.memory().indexedObjects>0;
+// add, delete and re-add while indexed
+delete o.key50;
+ok &= o.key50===undefined && !("key50" in o) && o.key51==51;
+o.key50 = "again";
+ok &= o.key50=="again";
+for (i=100;i<300;i++) o["key"+i] = i;
+for (i=0;i<300;i++) ok &= o["key"+i]==(i==50?"again":i);
+// long names, and names that differ only after the first 4 characters
+o.aVeryLongPropertyNameThatUsesStringExts = 1;
+o.aVeryLongPropertyNameThatUsesStringExtz = 2;
+ok &= o.aVeryLongPropertyNameThatUsesStringExts==1 && o.aVeryLongPropertyNameThatUsesStringExtz==2;
+// integer keys still work
+o[5] = "five";
+ok &= o[5]=="five" && o["5"]=="five";
+// iteration order is unaffected
+var k = Object.keys(o);
+ok &= k.length==303 && k[0]=="key0" && k[50]=="key51" && k[99]=="key50" && k[100]=="key100";
+// removing lots of keys
+for (i=0;i<300;i++) delete o["key"+i];
+ok &= Object.keys(o).length==3 && o.key10===undefined;
+// indices for freed objects get removed
+o = undefined;
+process.memory();
+var n = process.memory().indexedObjects;
+result = ok && n<8;
@@ -0,0 +1,17 @@
+// Integer literals in pretokenised code are stored as raw binary values
+
+function f() {
+  "ram";
+  var a = [0, 5, 255, 256, 65535, 65536, 0x10, 1.5, -3, 1e3, 0777];
+  var o = {300:"x"};
+  switch (a[4]) { case 65535: o.r = o[300]+a[0]; break; default: o.r = "bad"; }
+  return a.join(",")+"|"+o.r;
+}
+
+results = [
+  f() == "0,5,255,256,65535,65536,16,1.5,-3,1000,511|x0",
+  f["\xFFcod"].indexOf("\xD3,\xD4\5,\xD4\xFF,\xD5\0\1,\xD5\xFF\xFF,65536,0x10,1.5,-\xD4\3,1e3,0777")>=0,
+  f.toString().indexOf("[0,5,255,256,65535,65536,0x10,1.5,-3,1e3,0777]")>=0,
+  f.toString().indexOf("case 65535:")>=0
+];
+result = results.every(r=>r);
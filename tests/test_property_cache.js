@@ -0,0 +1,64 @@
+// Check that repeated lookups of fields in prototypes/built-ins stay correct when things change
+var ok = true;
+function A() {} A.prototype.f = function() { return "A"; };
+function B() {} B.prototype.f = function() { return "B"; };
+// objects get freed and their vars reused for objects with different prototypes
+for (var i=0;i<20;i++) {
+  var o = (i&1) ? new B() : new A();
+  ok &= o.f()==((i&1)?"B":"A");
+}
+var a = new A();
+for (i=0;i<3;i++) ok &= a.f()=="A";
+// change the value in the prototype
+A.prototype.f = function() { return "A2"; };
+ok &= a.f()=="A2";
+// shadow it in a prototype in between
+function C() {} C.prototype = Object.create(A.prototype);
+var c = new C();
+for (i=0;i<3;i++) ok &= c.f()=="A2";
+C.prototype.f = function() { return "C"; };
+ok &= c.f()=="C";
+delete C.prototype.f;
+ok &= c.f()=="A2";
+// change the prototype of an object
+Object.setPrototypeOf(c, B.prototype);
+ok &= c.f()=="B";
+c.__proto__ = A.prototype;
+ok &= c.f()=="A2";
+// built-in functions
+var arr = [];
+for (i=0;i<3;i++) arr.push(i);
+ok &= arr.length==3 && arr.join()=="0,1,2";
+Array.prototype.push = function(x) { return "overridden"; };
+ok &= arr.push(4)=="overridden";
+delete Array.prototype.push;
+ok &= arr.push(4)==4 && arr.length==4;
+arr.join = function() { return "own"; };
+ok &= arr.join()=="own";
+// replacing a class
+var s = "Hello";
+for (i=0;i<3;i++) ok &= s.indexOf("l")==2;
+var str = "World";
+String.prototype.indexOf = function() { return -99; };
+ok &= str.indexOf("l")==-99;
+// capitalised names that aren't classes used by arrays
+var nums = [1,2];
+for (i=0;i<3;i++) ok &= nums.join()=="1,2";
+Foo = 1;
+Global = {};
+ok &= nums.join()=="1,2";
+// replacing the class itself in root
+var RealArray = Array;
+Array = { prototype : { join : function() { return "fake"; } } };
+ok &= nums.join()=="fake";
+Array = RealArray;
+ok &= nums.join()=="1,2";
+// replacing Object affects every object
+var obj = {};
+for (i=0;i<3;i++) ok &= obj.hasOwnProperty("x")==false;
+var RealObject = Object;
+Object = { prototype : { hasOwnProperty : function() { return "fake"; } } };
+ok &= obj.hasOwnProperty("x")=="fake";
+Object = RealObject;
+ok &= obj.hasOwnProperty("x")==false;
+result = ok;
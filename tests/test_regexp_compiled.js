@@ -0,0 +1,55 @@
+// RegExps are compiled once and run by a non-recursive matcher
+tests=0;
+testPass=0;
+
+function test(a, b) {
+  tests++;
+  if (a==b) {
+    return testPass++;
+  }
+  console.log("Test "+tests+" failed - ",a,"vs",b);
+}
+
+function throws(src) {
+  try { new RegExp(src); } catch (e) { return e instanceof SyntaxError; }
+  return false;
+}
+
+// quantifiers
+test(JSON.stringify(/colou?r/.exec("my color")), '["color"]');
+test(JSON.stringify(/a{2,3}/.exec("caaaat")), '["aaa"]');
+test(JSON.stringify(/a{2}/.exec("caaaat")), '["aa"]');
+test(JSON.stringify(/a{2,}b/.exec("xaaaab")), '["aaaab"]');
+test(JSON.stringify(/<.+?>/.exec("<a><b>")), '["<a>"]');
+test(JSON.stringify(/<.+>/.exec("<a><b>")), '["<a><b>"]');
+// groups, alternation and non-capturing groups
+test(JSON.stringify(/(\d+)-(\d+)/.exec("on 12-34!")), '["12-34","12","34"]');
+test(JSON.stringify(/(?:ab)+(c)/.exec("xababcx")), '["ababc","c"]');
+test(JSON.stringify(/((a)|(b))+/.exec("ab")), '["ab","b",null,"b"]');
+test(/(a)|(b)/.exec("b")[1], undefined);
+test(/(a)|(b)/.exec("b").length, 3);
+test(JSON.stringify(/cat|dog|bird/g.exec("a bird")), '["bird"]');
+// word boundaries
+test(JSON.stringify("one two three".match(/\b\w/g)), '["o","t","t"]');
+test(/\Bwo/.test("two"), true);
+test(/\bwo/.test("two"), false);
+// classes and case folding
+test(JSON.stringify("A1b2_C".match(/[a-c\d]/gi)), '["A","1","b","2","C"]');
+test(JSON.stringify("x-y]z".match(/[\]\-]/g)), '["-","]"]');
+test(/^HELLO$/i.test("hello"), true);
+// nested quantifiers don't blow up
+var s = ""; for (var i=0;i<500;i++) s+="a";
+test(/(a*)*b/.test(s), false);
+test(/^(a|aa)+$/.test(s), true);
+// replace with unmatched groups
+test("ab".replace(/(a)|(b)/g, "[$1$2]"), "[a][b]");
+test("b".replace(/(a)|(b)/, function(m,a,b,idx) { return typeof a+","+b+","+idx; }), "undefined,b,0");
+// bad patterns are errors at construction
+test(throws("a**"), true);
+test(throws("(ab"), true);
+test(throws("ab)"), true);
+test(throws("[ab"), true);
+test(throws("(a)\\1"), true);
+
+result = tests==testPass;
+console.log(result?"Pass":"Fail",":",tests,"tests total");
@@ -0,0 +1,48 @@
+// Check that repeated variable lookups stay correct as scopes and variables change
+var ok = true;
+var G = 1;
+function readG() { return G; }
+for (var i=0;i<3;i++) ok &= readG()==1;
+// local shadows global
+function shadow(G) { return G; }
+for (i=0;i<3;i++) ok &= shadow(2)==2 && readG()==1;
+function shadowLater() {
+  var s = G;
+  var G = 2;
+  return s + G;
+}
+ok &= shadowLater()==3;
+ok &= readG()==1;
+// global deleted and re-created
+delete G;
+ok &= (function() { try { return G; } catch (e) { return "err"; } })()=="err";
+G = 3;
+ok &= readG()==3;
+// closures with different scopes calling each other
+function mk(v) { return function(x) { return x ? v+x : v; }; }
+var a = mk("a"), b = mk("b");
+for (i=0;i<3;i++) ok &= a()=="a" && b()=="b" && a(b())=="ab";
+// recursion - same name, different scopes
+function fact(n) { var r = n; if (n>1) r *= fact(n-1); return r; }
+ok &= fact(5)==120;
+// let scoping in blocks
+var L = "outer";
+function blocks() {
+  var res = L;
+  { let L = "inner"; res += L; }
+  return res + L;
+}
+ok &= blocks()=="outerinnerouter";
+// eval adding a variable in a function
+function ev() {
+  var r = typeof Q;
+  eval("var Q = 5");
+  return r=="undefined" && Q==5;
+}
+ok &= ev();
+// variable used after a function call that creates it as a global
+function makeGlobal() { NEWGLOBAL = 42; }
+ok &= typeof NEWGLOBAL=="undefined";
+makeGlobal();
+ok &= NEWGLOBAL==42;
+result = ok;
@@ -0,0 +1,42 @@
+// setWatch goes to the right watches for each pin, with batch:true, after watches are removed by a callback, and with more watches than the dispatch table holds
+// (on Linux without GPIO, digitalRead returns what was written and each write to a watched pin queues an edge)
+
+var got = [];
+setWatch(function(e) { got.push("5r"); }, D5, {repeat:true, edge:"rising"});
+setWatch(function(e) { got.push("6"+(e.state?"r":"f")); }, D6, {repeat:true, edge:"both"});
+setWatch(function(e) { got.push("5f"); }, D5, {repeat:true, edge:"falling"});
+var batches = [];
+setWatch(function(e) { batches.push(e.time.length+(e.state?"h":"l")); }, D7, {repeat:true, edge:"both", batch:true});
+// debounced watches don't batch edges, the debounce decides which one we get
+var debounced = [];
+setWatch(function(e) { debounced.push(typeof e.time+":"+e.state); }, D10, {repeat:true, edge:"both", batch:true, debounce:20});
+// the first removes the second before it can be called, so neither is left for the second rising edge
+var w9b;
+setWatch(function(e) { got.push("9a"); clearWatch(w9b); }, D9, {repeat:false, edge:"rising"});
+w9b = setWatch(function(e) { got.push("9b"); }, D9, {repeat:true, edge:"rising"});
+
+// all these edges are queued before any of them are handled
+digitalWrite(D5,1);
+digitalWrite(D6,1);
+digitalWrite(D5,0);
+digitalWrite(D9,1);
+digitalWrite(D7,1);
+digitalWrite(D7,0);
+digitalWrite(D7,1);
+digitalWrite(D10,1);
+digitalWrite(D10,0);
+digitalWrite(D10,1);
+
+var many = 0;
+setTimeout(function() {
+  // Now more watches than fit in the dispatch table
+  for (var i=0;i<20;i++)
+    setWatch(function(e) { many++; }, D8, {repeat:true, edge:"rising"});
+  digitalWrite(D8,1);
+  digitalWrite(D9,0);
+  digitalWrite(D9,1);
+  setTimeout(function() {
+    clearWatch();
+    result = got.join()=="5r,6r,5f,9a" && batches.join()=="3h" && debounced.join()=="number:true" && many==20;
+  }, 50);
+}, 50);
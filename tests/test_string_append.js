@@ -0,0 +1,52 @@
+// Check strings built by repeated appending stay correct (StringExts/end of string are cached)
+
+var results = [];
+
+// simple append loop
+var s = "";
+for (var i=0;i<500;i++) s += "X";
+results.push(s.length==500 && s[0]=="X" && s[499]=="X");
+
+// multi-char appends, checking contents
+var t = "", expected = [];
+for (var i=0;i<200;i++) { t += i+","; expected.push(i); }
+results.push(t == expected.join(",")+",");
+
+// alternate between two strings
+var a = "", b = "";
+for (var i=0;i<100;i++) { a += "a"+i; b += "b"+i; }
+var ea = "", eb = "";
+for (var i=0;i<100;i++) { ea = ea+"a"+i; eb = eb+"b"+i; }
+results.push(a==ea && b==eb);
+
+// free a string, then build new strings (which may reuse the same vars)
+a = undefined;
+var c = "";
+for (var i=0;i<100;i++) c += "c"+i;
+b += "!";
+results.push(c.length==290 && c.substr(0,4)=="c0c1" && b==eb+"!");
+
+// append after vars have been moved
+s = "";
+for (var i=0;i<100;i++) s += "Y";
+E.defrag();
+for (var i=0;i<100;i++) s += "Z";
+results.push(s.length==200 && s[99]=="Y" && s[100]=="Z" && s[199]=="Z");
+
+// append a string to itself, and use as an object key
+s = "hello world, ";
+s += s;
+s += s;
+var o = {};
+o[s] = 1;
+s += "end";
+results.push(s == "hello world, hello world, hello world, hello world, end" && o["hello world, hello world, hello world, hello world, "]==1);
+
+// append flat strings, and strings made with E.toString
+var f = E.toString(new Uint8Array(100).fill(65));
+s = "x";
+s += f;
+s += f;
+results.push(s.length==201 && s[1]=="A" && s[200]=="A");
+
+result = results.every(r=>r);
@@ -0,0 +1,23 @@
+// Lots of timers should all fire (and not early), with cleared/changed ones handled
+
+var start = getTime();
+var fired = 0, early = 0;
+var ids = [];
+for (var i=0;i<50;i++) {
+  var t = ((i*37)%50)*4; // 0..196ms, all different
+  ids.push(setTimeout(function(t) {
+    fired++;
+    if (getTime()-start < (t-1)/1000) early++;
+  }, t, t));
+}
+// clear every 5th one
+for (i=0;i<50;i+=5) clearTimeout(ids[i]);
+
+var ticks = 0;
+var iv = setInterval(function() { ticks++; }, 20);
+setTimeout(function() { changeInterval(iv, 1000); }, 110);
+
+setTimeout(function() {
+  clearInterval(iv);
+  result = fired==40 && early==0 && ticks>=4 && ticks<=6;
+}, 300);